@@ -0,0 +1,233 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/Arena.h>
+#include <apt/math.h>
+#include <apt/memory.h>
+#include <apt/MemoryInstrumentation.h>
+#include <apt/MemoryPool.h>
+#include <apt/ProxyAllocator.h>
+
+#include <EASTL/allocator.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// EASTL-compatible allocators which redirect container memory to apt's
+// allocators:
+//
+//    MemoryPoolAllocator  - Allocate from a MemoryPool, e.g. for node-based
+//                           containers (eastl::list, eastl::map, etc.).
+//    ArenaAllocator       - Allocate from an Arena.
+//    TaggedAllocator      - Allocate from the heap with a memory tag (see
+//                           MemoryInstrumentation.h).
+//    LargeAllocator       - Allocate via APT_MALLOC_LARGE, for big buffers
+//                           (see memory.h).
+//    ProxyAllocator       - Type-erased reference to any of the above, for
+//                           non-template classes (e.g. File). Declared in
+//                           ProxyAllocator.h, which is lighter to include.
+//
+// Usage:
+//
+//    Arena arena;
+//    eastl::vector<Foo, ArenaAllocator> v(ArenaAllocator(&arena));
+//
+//    Quadtree<uint32, Foo, TaggedAllocator> tree(8, Foo(), TaggedAllocator("Terrain"));
+//
+// All allocators (except TaggedAllocator and LargeAllocator) hold a ptr to the underlying
+// allocator which must outlive any container which references it. Allocators
+// compare equal if they refer to the same underlying allocator.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// MemoryPoolAllocator
+// Allocations which fit the pool's object size/alignment are serviced by the
+// pool, larger allocations (e.g. a vector's buffer) fall back to the heap.
+// Not thread safe (MemoryPool isn't thread safe).
+////////////////////////////////////////////////////////////////////////////////
+class MemoryPoolAllocator
+{
+public:
+	MemoryPoolAllocator(const char* _name = "MemoryPoolAllocator")                      : m_pool(nullptr), m_name(_name)    {}
+	MemoryPoolAllocator(MemoryPool* _pool, const char* _name = "MemoryPoolAllocator")  : m_pool(_pool), m_name(_name)      {}
+	MemoryPoolAllocator(const MemoryPoolAllocator& _rhs)                                : m_pool(_rhs.m_pool), m_name(_rhs.m_name) {}
+	MemoryPoolAllocator(const MemoryPoolAllocator& _rhs, const char* _name)             : m_pool(_rhs.m_pool), m_name(_name) {}
+
+	MemoryPoolAllocator& operator=(const MemoryPoolAllocator& _rhs)                     { m_pool = _rhs.m_pool; return *this; }
+
+	void* allocate(size_t _n, int = 0)
+	{
+		if (m_pool && _n <= m_pool->getObjectSize()) { // objects of the pool's type are naturally aligned
+			return m_pool->alloc();
+		}
+		return APT_MALLOC_ALIGNED(_n, EASTL_ALLOCATOR_MIN_ALIGNMENT);
+	}
+
+	void* allocate(size_t _n, size_t _alignment, size_t _offset, int = 0)
+	{
+		APT_ASSERT(_offset == 0);
+		if (m_pool && _n <= m_pool->getObjectSize()) {
+			APT_ASSERT(_alignment <= m_pool->getObjectAlignment()); // pool alignment is insufficient for the container's objects
+			return m_pool->alloc();
+		}
+		return APT_MALLOC_ALIGNED(_n, APT_MAX(_alignment, (size_t)EASTL_ALLOCATOR_MIN_ALIGNMENT));
+	}
+
+	void deallocate(void* _p, size_t _n)
+	{
+	 // allocate() routes by size only, hence so does deallocate()
+		if (m_pool && _n <= m_pool->getObjectSize()) {
+			APT_STRICT_ASSERT(m_pool->isFromPool(_p));
+			m_pool->free(_p);
+		} else {
+			APT_FREE_ALIGNED(_p);
+		}
+	}
+
+	const char* get_name() const                                                       { return m_name; }
+	void        set_name(const char* _name)                                            { m_name = _name; }
+	MemoryPool* getPool() const                                                        { return m_pool; }
+
+	friend bool operator==(const MemoryPoolAllocator& _a, const MemoryPoolAllocator& _b) { return _a.m_pool == _b.m_pool; }
+	friend bool operator!=(const MemoryPoolAllocator& _a, const MemoryPoolAllocator& _b) { return _a.m_pool != _b.m_pool; }
+
+private:
+	MemoryPool* m_pool;
+	const char* m_name;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ArenaAllocator
+// deallocate() is a no-op, memory is released via Arena::rewind()/reset().
+// Containers which grow repeatedly (e.g. eastl::vector) leave their old
+// buffers in the arena, prefer reserve(). Not thread safe.
+////////////////////////////////////////////////////////////////////////////////
+class ArenaAllocator
+{
+public:
+	ArenaAllocator(const char* _name = "ArenaAllocator")                                : m_arena(nullptr), m_name(_name)   {}
+	ArenaAllocator(Arena* _arena, const char* _name = "ArenaAllocator")                 : m_arena(_arena), m_name(_name)    {}
+	ArenaAllocator(const ArenaAllocator& _rhs)                                          : m_arena(_rhs.m_arena), m_name(_rhs.m_name) {}
+	ArenaAllocator(const ArenaAllocator& _rhs, const char* _name)                       : m_arena(_rhs.m_arena), m_name(_name) {}
+
+	ArenaAllocator& operator=(const ArenaAllocator& _rhs)                               { m_arena = _rhs.m_arena; return *this; }
+
+	void* allocate(size_t _n, int _flags = 0)
+	{
+		return allocate(_n, Arena::kDefaultAlignment, 0, _flags);
+	}
+
+	void* allocate(size_t _n, size_t _alignment, size_t _offset, int = 0)
+	{
+		APT_ASSERT(m_arena); // default constructed
+		APT_ASSERT(_offset == 0);
+		return m_arena->alloc((uint)_n, (uint)_alignment);
+	}
+
+	void deallocate(void* _p, size_t)
+	{
+		APT_STRICT_ASSERT(!_p || m_arena->isFromArena(_p));
+	}
+
+	const char* get_name() const                                                       { return m_name; }
+	void        set_name(const char* _name)                                            { m_name = _name; }
+	Arena*      getArena() const                                                       { return m_arena; }
+
+	friend bool operator==(const ArenaAllocator& _a, const ArenaAllocator& _b)          { return _a.m_arena == _b.m_arena; }
+	friend bool operator!=(const ArenaAllocator& _a, const ArenaAllocator& _b)          { return _a.m_arena != _b.m_arena; }
+
+private:
+	Arena*      m_arena;
+	const char* m_name;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// TaggedAllocator
+// Heap allocations made via APT_MALLOC_ALIGNED within a MemoryTagScope, hence
+// they are counted against the named tag when
+// APT_ENABLE_MEMORY_INSTRUMENTATION is defined (else equivalent to the default
+// EASTL allocator). _tagName must be a string literal. Thread safe.
+////////////////////////////////////////////////////////////////////////////////
+class TaggedAllocator
+{
+public:
+	TaggedAllocator(const char* _tagName = nullptr)                                     : m_tag(_tagName ? MemoryInstrumentation::FindOrAddTag(_tagName) : 0), m_name(_tagName) {}
+	TaggedAllocator(const TaggedAllocator& _rhs)                                        : m_tag(_rhs.m_tag), m_name(_rhs.m_name) {}
+	TaggedAllocator(const TaggedAllocator& _rhs, const char* _name)                     : m_tag(_rhs.m_tag), m_name(_name)  {} // _name doesn't change the tag
+
+	TaggedAllocator& operator=(const TaggedAllocator& _rhs)                             { m_tag = _rhs.m_tag; return *this; }
+
+	void* allocate(size_t _n, int _flags = 0)
+	{
+		return allocate(_n, EASTL_ALLOCATOR_MIN_ALIGNMENT, 0, _flags);
+	}
+
+	void* allocate(size_t _n, size_t _alignment, size_t _offset, int = 0)
+	{
+		APT_ASSERT(_offset == 0);
+		MemoryTagScope tagScope(m_tag);
+		return APT_MALLOC_ALIGNED(_n, APT_MAX(_alignment, (size_t)EASTL_ALLOCATOR_MIN_ALIGNMENT));
+	}
+
+	void deallocate(void* _p, size_t)
+	{
+		APT_FREE_ALIGNED(_p);
+	}
+
+	const char* get_name() const                                                       { return m_name; }
+	void        set_name(const char* _name)                                            { m_name = _name; }
+	int         getTag() const                                                         { return m_tag; }
+
+	// Memory is from the heap in all cases, hence all TaggedAllocators are interchangeable.
+	friend bool operator==(const TaggedAllocator&, const TaggedAllocator&)             { return true; }
+	friend bool operator!=(const TaggedAllocator&, const TaggedAllocator&)             { return false; }
+
+private:
+	int         m_tag;
+	const char* m_name;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LargeAllocator
+// Allocations are made via APT_MALLOC_LARGE, hence big buffers are allocated
+// directly from the OS (subject to LargeAllocScope). The alignment of OS
+// allocations is kLargePageSize, smaller allocations are aligned to
+// EASTL_ALLOCATOR_MIN_ALIGNMENT. Thread safe.
+////////////////////////////////////////////////////////////////////////////////
+class LargeAllocator
+{
+public:
+	LargeAllocator(const char* _name = "LargeAllocator")                                : m_name(_name)                     {}
+	LargeAllocator(const LargeAllocator& _rhs)                                          : m_name(_rhs.m_name)               {}
+	LargeAllocator(const LargeAllocator&, const char* _name)                            : m_name(_name)                     {}
+
+	LargeAllocator& operator=(const LargeAllocator&)                                    { return *this; }
+
+	void* allocate(size_t _n, int = 0)
+	{
+		return APT_MALLOC_LARGE(_n);
+	}
+
+	void* allocate(size_t _n, size_t _alignment, size_t _offset, int = 0)
+	{
+		APT_ASSERT(_offset == 0);
+		APT_ASSERT(_alignment <= EASTL_ALLOCATOR_MIN_ALIGNMENT); // APT_MALLOC_LARGE may fall back to APT_MALLOC
+		return APT_MALLOC_LARGE(_n);
+	}
+
+	void deallocate(void* _p, size_t)
+	{
+		APT_FREE_LARGE(_p);
+	}
+
+	const char* get_name() const                                                       { return m_name; }
+	void        set_name(const char* _name)                                            { m_name = _name; }
+
+	friend bool operator==(const LargeAllocator&, const LargeAllocator&)               { return true; }
+	friend bool operator!=(const LargeAllocator&, const LargeAllocator&)               { return false; }
+
+private:
+	const char* m_name;
+};
+
+} // namespace apt
@@ -0,0 +1,145 @@
+#include <apt/Arena.h>
+
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <cstring>
+
+namespace apt {
+
+thread_local Arena* Arena::s_threadArena = nullptr;
+
+static inline uint AlignUp(uint _x, uint _align)
+{
+	return (_x + _align - 1) & ~(_align - 1);
+}
+
+// PUBLIC
+
+Arena::Arena(uint _chunkSize)
+	: m_chunks(nullptr)
+	, m_chunkCount(0)
+	, m_current(0)
+	, m_offset(0)
+	, m_chunkSize(_chunkSize)
+{
+	APT_ASSERT(m_chunkSize > 0);
+}
+
+Arena::~Arena()
+{
+	APT_ASSERT(s_threadArena != this); // destroyed inside an ArenaScope which references it
+	ArenaScope suspend(nullptr); // chunks were allocated outside of any scope
+	for (uint i = 0; i < m_chunkCount; ++i) {
+		APT_FREE_ALIGNED(m_chunks[i].m_data);
+	}
+	APT_FREE(m_chunks);
+}
+
+void* Arena::alloc(uint _size, uint _align)
+{
+	APT_ASSERT(APT_IS_POW2(_align));
+	if_unlikely (m_current >= m_chunkCount) {
+		nextChunk(_size, _align);
+	}
+	Chunk* chunk = &m_chunks[m_current];
+	uint begin = AlignUp((uint)chunk->m_data + m_offset, _align) - (uint)chunk->m_data;
+	if_unlikely (begin + _size > chunk->m_size) {
+		nextChunk(_size, _align);
+		chunk = &m_chunks[m_current];
+		begin = AlignUp((uint)chunk->m_data, _align) - (uint)chunk->m_data;
+	}
+	m_offset = begin + _size;
+	return chunk->m_data + begin;
+}
+
+void* Arena::realloc(void* _ptr, uint _oldSize, uint _newSize, uint _align)
+{
+	if (!_ptr) {
+		return alloc(_newSize, _align);
+	}
+
+ // extend in place if _ptr was the most recent allocation
+	if (m_current < m_chunkCount) {
+		const Chunk& chunk = m_chunks[m_current];
+		char* p = (char*)_ptr;
+		if (p >= chunk.m_data && p + _oldSize == chunk.m_data + m_offset) {
+			uint begin = (uint)(p - chunk.m_data);
+			if (begin + _newSize <= chunk.m_size) {
+				m_offset = begin + _newSize;
+				return _ptr;
+			}
+		}
+	}
+
+	void* ret = alloc(_newSize, _align);
+	memcpy(ret, _ptr, APT_MIN(_oldSize, _newSize));
+	return ret;
+}
+
+void Arena::rewind(Marker _marker)
+{
+	APT_ASSERT(_marker.m_chunk < m_current || (_marker.m_chunk == m_current && _marker.m_offset <= m_offset)); // marker is ahead of the current position
+	m_current = _marker.m_chunk;
+	m_offset  = _marker.m_offset;
+}
+
+bool Arena::isFromArena(const void* _ptr) const
+{
+	const char* p = (const char*)_ptr;
+	for (uint i = 0; i < m_chunkCount; ++i) {
+		if (p >= m_chunks[i].m_data && p < m_chunks[i].m_data + m_chunks[i].m_size) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint Arena::getUsedSize() const
+{
+	uint ret = 0;
+	for (uint i = 0; i < m_current && i < m_chunkCount; ++i) {
+		ret += m_chunks[i].m_size;
+	}
+	if (m_current < m_chunkCount) {
+		ret += m_offset;
+	}
+	return ret;
+}
+
+uint Arena::getCapacity() const
+{
+	uint ret = 0;
+	for (uint i = 0; i < m_chunkCount; ++i) {
+		ret += m_chunks[i].m_size;
+	}
+	return ret;
+}
+
+// PRIVATE
+
+void Arena::nextChunk(uint _size, uint _align)
+{
+	ArenaScope suspend(nullptr); // chunk allocations must go to the heap
+
+	uint required = _size + _align; // worst case alignment padding
+	uint next = m_current < m_chunkCount ? m_current + 1 : m_current;
+	if (next < m_chunkCount) {
+	 // reuse the next chunk if it's big enough, else replace it
+		if (m_chunks[next].m_size < required) {
+			APT_FREE_ALIGNED(m_chunks[next].m_data);
+			m_chunks[next].m_data = (char*)APT_MALLOC_ALIGNED(required, kDefaultAlignment);
+			m_chunks[next].m_size = required;
+		}
+	} else {
+		uint size = APT_MAX(m_chunkSize, required);
+		m_chunks = (Chunk*)APT_REALLOC(m_chunks, sizeof(Chunk) * (m_chunkCount + 1));
+		m_chunks[next].m_data = (char*)APT_MALLOC_ALIGNED(size, kDefaultAlignment);
+		m_chunks[next].m_size = size;
+		++m_chunkCount;
+	}
+	m_current = next;
+	m_offset  = 0;
+}
+
+} // namespace apt
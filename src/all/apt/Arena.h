@@ -0,0 +1,117 @@
+#pragma once
+
+#include <apt/apt.h>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// Arena
+// Linear (bump) allocator. Memory is reserved in chunks of _chunkSize bytes
+// (larger allocations get a dedicated chunk); individual allocations can't be
+// freed, instead use getMarker()/rewind() or reset() to release everything
+// allocated since a given point. Chunks are retained for reuse until the Arena
+// is destroyed.
+// Usage:
+//
+//    Arena arena;
+//    Arena::Marker marker = arena.getMarker();
+//    float* tmp = (float*)arena.alloc(sizeof(float) * 1024, alignof(float));
+//    // ..
+//    arena.rewind(marker);
+//
+// Use ArenaScope to redirect APT_MALLOC/APT_MALLOC_ALIGNED (and hence global
+// new) on the current thread to an arena, e.g. for temporary allocations made
+// by code you don't control:
+//
+//    Arena frameArena;
+//    { APT_ARENA_SCOPE(&frameArena);
+//       Json json("data.json"); // DOM allocations are a pointer bump
+//       // ..
+//    }
+//    frameArena.reset();
+//
+// Within the scope APT_FREE is a no-op for memory from the arena and APT_REALLOC
+// grows the most recent allocation in place. Memory allocated in the scope must
+// not be freed after the scope ends, nor be used after the arena is reset.
+// Memory allocated outside the scope may be freed inside it as normal.
+////////////////////////////////////////////////////////////////////////////////
+class Arena: private non_copyable<Arena>
+{
+	friend class ArenaScope;
+public:
+	static const uint kDefaultChunkSize = 64 * 1024;
+	static const uint kDefaultAlignment = 16;
+
+	struct Marker
+	{
+		uint m_chunk;
+		uint m_offset;
+	};
+
+	Arena(uint _chunkSize = kDefaultChunkSize);
+
+	// Free all chunks.
+	~Arena();
+
+	// Return a ptr to _size bytes aligned to _align (which must be a power of 2).
+	void*  alloc(uint _size, uint _align = kDefaultAlignment);
+
+	// Resize an allocation of _oldSize bytes. If _ptr was the most recent allocation and there is space in the current chunk it is
+	// extended in place, else a new allocation is made and the old contents copied.
+	void*  realloc(void* _ptr, uint _oldSize, uint _newSize, uint _align = kDefaultAlignment);
+
+	// Release all allocations made since _marker was retrieved.
+	Marker getMarker() const                { return { m_current, m_offset }; }
+	void   rewind(Marker _marker);
+
+	// Release all allocations.
+	void   reset()                          { rewind({ 0, 0 }); }
+
+	// Return true if _ptr lies within one of the arena's chunks.
+	bool   isFromArena(const void* _ptr) const;
+
+	// Bytes allocated since the last reset (including alignment padding).
+	uint   getUsedSize() const;
+	// Total bytes reserved by chunks.
+	uint   getCapacity() const;
+
+	// Return the arena to which allocations are redirected on the calling thread, or nullptr.
+	static Arena* GetThreadArena()          { return s_threadArena; }
+
+private:
+	struct Chunk
+	{
+		char* m_data;
+		uint  m_size;
+	};
+
+	Chunk* m_chunks;
+	uint   m_chunkCount;
+	uint   m_current;      // Index of the current chunk.
+	uint   m_offset;       // Offset of the next allocation in the current chunk.
+	uint   m_chunkSize;
+
+	static thread_local Arena* s_threadArena;
+
+	// Move to the next chunk with at least _size + _align bytes, allocate a new chunk if required.
+	void nextChunk(uint _size, uint _align);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ArenaScope
+// Redirect APT_MALLOC/APT_MALLOC_ALIGNED on the calling thread to _arena for the
+// lifetime of the ArenaScope. Scopes may be nested; _arena may be nullptr to
+// suspend redirection within an outer scope.
+////////////////////////////////////////////////////////////////////////////////
+class ArenaScope: private non_copyable<ArenaScope>
+{
+public:
+	ArenaScope(Arena* _arena): m_prev(Arena::s_threadArena) { Arena::s_threadArena = _arena; }
+	~ArenaScope()                                            { Arena::s_threadArena = m_prev; }
+
+private:
+	Arena* m_prev;
+};
+#define APT_ARENA_SCOPE(_arena) apt::ArenaScope APT_UNIQUE_NAME(_arenaScope)(_arena)
+
+} // namespace apt
@@ -0,0 +1,141 @@
+#include <apt/ConcurrentMemoryPool.h>
+
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <new>
+
+namespace apt {
+
+// PUBLIC
+
+ConcurrentMemoryPool::ConcurrentMemoryPool(uint _objectSize, uint _objectAlignment, uint _blockSize, uint _maxBlockCount)
+	: m_objectSize(_objectSize)
+	, m_objectAlignment(APT_MAX(_objectAlignment, (uint)alignof(void*))) // the free list is stored in-place
+	, m_blockSize(_blockSize)
+	, m_head(0)
+	, m_usedCount(0)
+	, m_blocks(nullptr)
+	, m_blockCount(0)
+	, m_maxBlockCount(_maxBlockCount)
+{
+	APT_ASSERT(m_objectSize >= sizeof(void*)); // objects must be at least the size of a ptr
+	APT_ASSERT(m_blockSize > 0);
+	m_objectSize = (m_objectSize + m_objectAlignment - 1) & ~(m_objectAlignment - 1);
+
+	m_blocks = (std::atomic<void*>*)APT_MALLOC_ALIGNED(sizeof(std::atomic<void*>) * m_maxBlockCount, alignof(std::atomic<void*>));
+	for (uint i = 0; i < m_maxBlockCount; ++i) {
+		new(&m_blocks[i]) std::atomic<void*>(nullptr);
+	}
+}
+
+ConcurrentMemoryPool::~ConcurrentMemoryPool()
+{
+	APT_ASSERT(m_usedCount == 0); // not all objects were freed
+	for (uint i = 0, n = m_blockCount; i < n; ++i) {
+		APT_FREE_ALIGNED(m_blocks[i].load());
+	}
+	APT_FREE_ALIGNED(m_blocks);
+}
+
+void* ConcurrentMemoryPool::alloc()
+{
+	void* ret = pop();
+	if_unlikely (!ret) {
+		ret = allocBlock();
+		if_unlikely (!ret) {
+		 // the block table is full, another thread may have freed an object in the meantime
+			ret = pop();
+			if (!ret) {
+				return nullptr;
+			}
+		}
+	}
+	m_usedCount.fetch_add(1, std::memory_order_relaxed);
+	return ret;
+}
+
+void ConcurrentMemoryPool::free(void* _object)
+{
+	APT_ASSERT(_object);
+	APT_STRICT_ASSERT(isFromPool(_object));
+	APT_ASSERT(m_usedCount > 0);
+	push(_object, _object);
+	m_usedCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool ConcurrentMemoryPool::isFromPool(const void* _ptr) const
+{
+	uint p = (uint)_ptr;
+	uint blockBytes = m_blockSize * m_objectSize;
+	for (uint i = 0, n = m_blockCount.load(std::memory_order_acquire); i < n; ++i) {
+		uint block = (uint)m_blocks[i].load(std::memory_order_acquire);
+		if (block && p >= block && p < block + blockBytes) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ConcurrentMemoryPool::validate() const
+{
+	uint freeCount = 0;
+	void* p = GetPtr(m_head.load());
+	while (p != 0) {
+		++freeCount;
+		p = Next(p).load();
+	}
+	return m_usedCount == getCapacity() - freeCount;
+}
+
+// PRIVATE
+
+void ConcurrentMemoryPool::push(void* _first, void* _last)
+{
+	uint64 head = m_head.load(std::memory_order_relaxed);
+	do {
+		Next(_last).store(GetPtr(head), std::memory_order_relaxed);
+	} while (!m_head.compare_exchange_weak(head, Pack(_first, GetTag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+}
+
+void* ConcurrentMemoryPool::pop()
+{
+	uint64 head = m_head.load(std::memory_order_acquire);
+	for (;;) {
+		void* ret = GetPtr(head);
+		if (!ret) {
+			return nullptr;
+		}
+	 // ret may be popped and reused by another thread before the CAS, in which case next is garbage but the tag will have changed and the CAS fails
+		void* next = Next(ret).load(std::memory_order_relaxed);
+		if (m_head.compare_exchange_weak(head, Pack(next, GetTag(head) + 1), std::memory_order_acquire, std::memory_order_acquire)) {
+			return ret;
+		}
+	}
+}
+
+void* ConcurrentMemoryPool::allocBlock()
+{
+ // reserve a slot in the block table, m_blockCount never exceeds m_maxBlockCount
+	uint blockIndex = m_blockCount.load(std::memory_order_relaxed);
+	do {
+		if_unlikely (blockIndex >= m_maxBlockCount) {
+			return nullptr;
+		}
+	} while (!m_blockCount.compare_exchange_weak(blockIndex, blockIndex + 1, std::memory_order_relaxed));
+	char* block = (char*)APT_MALLOC_ALIGNED(m_objectSize * m_blockSize, m_objectAlignment);
+	m_blocks[blockIndex].store(block, std::memory_order_release);
+
+ // the first object is returned to the caller, link the remainder privately then publish them with a single CAS
+	if (m_blockSize > 1) {
+		char* first = block + m_objectSize;
+		char* last  = block + m_objectSize * (m_blockSize - 1);
+		for (char* p = first; p != last; p += m_objectSize) {
+			Next(p).store(p + m_objectSize, std::memory_order_relaxed);
+		}
+		push(first, last);
+	}
+	return block;
+}
+
+} // namespace apt
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/Pool.h>
+
+#include <atomic>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentMemoryPool
+// Lock-free variant of MemoryPool. Use ConcurrentPool for the templated
+// version.
+// Usage:
+//
+//    ConcurrentPool<Foo> pool(128);
+//    Foo* f = pool.alloc(); // from any thread
+//    pool.free(f);          // from any thread
+//
+// The free list is a Treiber stack; the head is a tagged pointer (48 bit
+// address + 16 bit tag) to avoid ABA. Growth is lock-free: a thread which finds
+// the free list empty allocates and initializes a new block privately, then
+// publishes it with a single CAS. Several threads may grow the pool at once,
+// in which case the capacity overshoots by at most one block per thread.
+//
+// The block table has a fixed capacity (_maxBlockCount) so that it is never
+// reallocated while other threads are reading it. Once all blocks are in use,
+// alloc() returns nullptr.
+////////////////////////////////////////////////////////////////////////////////
+class ConcurrentMemoryPool: private non_copyable<ConcurrentMemoryPool>
+{
+public:
+	static const uint kDefaultMaxBlockCount = 1024;
+
+	// _objectSize must be at least sizeof(void*). _blockSize is the number of new unused objects to allocate when alloc() cannot service a new request.
+	// _maxBlockCount is the max number of blocks which the pool may allocate.
+	ConcurrentMemoryPool(uint _objectSize, uint _objectAlignment, uint _blockSize, uint _maxBlockCount = kDefaultMaxBlockCount);
+
+	// Free all allocated memory. Any allocated objects should be released via free() before the ConcurrentMemoryPool is destroyed.
+	~ConcurrentMemoryPool();
+
+	// Return nullptr if the pool is exhausted (_maxBlockCount blocks are allocated and there are no free objects).
+	void* alloc();
+	void  free(void* _object);
+
+	// Return true if _ptr was allocated from the pool.
+	bool isFromPool(const void* _ptr) const;
+
+	// Return true if # used objects is consistent with # accessible free objects. Not thread safe.
+	bool validate() const;
+
+	uint getCapacity() const  { return m_blockSize * m_blockCount.load(std::memory_order_relaxed); }
+	uint getUsedCount() const { return m_usedCount.load(std::memory_order_relaxed); }
+	uint getFreeCount() const { return getCapacity() - getUsedCount(); }
+
+private:
+	static const uint64 kTagShift = 48;
+	static const uint64 kPtrMask  = (uint64(1) << kTagShift) - 1;
+
+	uint                m_objectSize, m_objectAlignment, m_blockSize;
+	std::atomic<uint64> m_head;          // Tagged ptr to the first free object.
+	std::atomic<uint>   m_usedCount;
+	std::atomic<void*>* m_blocks;        // m_maxBlockCount entries, null until a block is published.
+	std::atomic<uint>   m_blockCount;
+	uint                m_maxBlockCount;
+
+	static uint64 Pack(void* _ptr, uint64 _tag)  { return ((uint64)_ptr & kPtrMask) | (_tag << kTagShift); }
+	static void*  GetPtr(uint64 _tagged)         { return (void*)(_tagged & kPtrMask); }
+	static uint64 GetTag(uint64 _tagged)         { return _tagged >> kTagShift; }
+
+	// The 'next' ptr stored in a free object. Accessed atomically because a popping thread may read it while the object is concurrently reused.
+	static std::atomic<void*>& Next(void* _object) { return *(std::atomic<void*>*)_object; }
+
+	// Push the chain [_first, _last] onto the free list.
+	void  push(void* _first, void* _last);
+
+	// Pop an object from the free list, return nullptr if empty.
+	void* pop();
+
+	// Allocate and publish a new block, return one of its objects to the caller or nullptr if the block table is full.
+	void* allocBlock();
+};
+
+template <typename tType>
+using ConcurrentPool = Pool<tType, ConcurrentMemoryPool>;
+
+} // namespace apt
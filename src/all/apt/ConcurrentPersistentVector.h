@@ -0,0 +1,283 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <EASTL/allocator.h>
+
+#include <atomic>
+#include <new>         // placement new
+#include <utility>     // std::forward
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ConcurrentPersistentVector
+/// Multi-producer variant of PersistentVector. Any number of threads may
+/// append elements concurrently (without locking) while other threads read
+/// the committed elements. As with PersistentVector, elements are never moved.
+/// Usage:
+///
+///    ConcurrentPersistentVector<Result> results;
+///    // on any thread:
+///    results.push_back(Result(...));
+///    // on any thread, e.g. a consumer:
+///    results.forEachChunk([](const Result* _data, uint _count) { ... });
+///
+/// push_back() reserves a slot with a single atomic increment. The first
+/// thread to reserve a slot in an unallocated block allocates the block and
+/// publishes it with a CAS; if several threads race to do so the losers
+/// release their block. Hence tAllocator must be thread safe.
+///
+/// An element is committed when its constructor has returned. size() returns
+/// the length of the committed prefix: while writers are active this may lag
+/// behind the number of push_back() calls (elements may be committed out of
+/// order), once all writers are done size() == getReservedCount().
+///
+/// The block table has a fixed capacity (_maxBlockCount) so that it is never
+/// reallocated while other threads are reading it. push_back() fails and
+/// returns kInvalidIndex once getMaxSize() elements have been appended, in all
+/// builds. kBlockSize must be a power of 2.
+///
+/// clear() and the dtor are not thread safe.
+////////////////////////////////////////////////////////////////////////////////
+template <typename tType, typename tAllocator, uint kBlockSize>
+class ConcurrentPersistentVector: private non_copyable<ConcurrentPersistentVector<tType, tAllocator, kBlockSize> >
+{
+public:
+	static const uint kDefaultMaxBlockCount = 1024;
+	static const uint kInvalidIndex         = ~(uint)0;
+
+	typedef tType      value_type;
+	typedef uint       size_type;
+	typedef tAllocator allocator_type;
+
+	/// \param maxBlockCount Max number of blocks; the max size of the container
+	///    is _maxBlockCount * kBlockSize.
+	/// \param allocator EASTL allocator used for the block storage, must be
+	///    thread safe.
+	ConcurrentPersistentVector(uint _maxBlockCount = kDefaultMaxBlockCount, const tAllocator& _allocator = tAllocator());
+
+	/// Elements are destructed. Writers must not be active.
+	~ConcurrentPersistentVector();
+
+	/// Add a new element at the end of the container. Thread safe. Return the
+	/// index of the new element, or kInvalidIndex if the container is full (in
+	/// which case no element is constructed).
+	uint push_back(const tType& _v)                { return emplace_back(_v); }
+	uint push_back(tType&& _v)                     { return emplace_back(std::move(_v)); }
+	template <typename... tArgs>
+	uint emplace_back(tArgs&&... _args);
+
+	/// Remove all elements from the container. Element dtors are called. Not
+	/// thread safe.
+	void clear();
+
+	/// Number of committed elements (see class description). Thread safe.
+	uint size() const;
+
+	/// Number of elements for which push_back() was called, excluding calls
+	/// which failed. Thread safe.
+	uint getReservedCount() const                  { return APT_MIN(m_reserved.load(std::memory_order_relaxed), getMaxSize()); }
+
+	uint getMaxSize() const                        { return m_maxBlockCount * kBlockSize; }
+	static uint getBlockSize()                     { return kBlockSize; }
+
+	/// _i must be < size(), or an index returned by push_back() on the calling
+	/// thread.
+	tType&       operator[](uint _i)               { return getElement(_i); }
+	const tType& operator[](uint _i) const         { return getElement(_i); }
+
+	/// Call _func(tType* _data, uint _count) for each block of committed
+	/// elements, in order. Thread safe; elements appended during the call may
+	/// or may not be visited.
+	template <typename tFunc>
+	void forEachChunk(tFunc&& _func);
+	template <typename tFunc>
+	void forEachChunk(tFunc&& _func) const;
+
+	const tAllocator& get_allocator() const        { return m_allocator; }
+
+private:
+
+	struct Block
+	{
+		std::atomic<tType*> m_data;      ///< Null until the block is published.
+		std::atomic<uint>   m_committed; ///< Number of constructed elements.
+	};
+
+	tAllocator              m_allocator;
+	Block*                  m_blocks;        ///< m_maxBlockCount entries.
+	uint                    m_maxBlockCount;
+	std::atomic<uint>       m_reserved;      ///< Next free slot, may exceed getMaxSize() if push_back() failed.
+	mutable std::atomic<uint> m_fullBlocks;  ///< Number of leading blocks known to be fully committed (size() hint).
+
+	tType& getElement(uint _i) const;
+
+	/// Allocate and publish block _i, return the published block.
+	tType* allocBlock(uint _i);
+
+}; // class ConcurrentPersistentVector
+
+
+/*******************************************************************************
+
+                         ConcurrentPersistentVector
+
+*******************************************************************************/
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+const uint ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::kDefaultMaxBlockCount;
+template <typename tType, typename tAllocator, uint kBlockSize>
+const uint ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::kInvalidIndex;
+
+//	PUBLIC
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::ConcurrentPersistentVector(uint _maxBlockCount, const tAllocator& _allocator)
+	: m_allocator(_allocator)
+	, m_maxBlockCount(_maxBlockCount)
+	, m_reserved(0)
+	, m_fullBlocks(0)
+{
+	APT_STATIC_ASSERT(kBlockSize > 0 && (kBlockSize & (kBlockSize - 1)) == 0); // kBlockSize must be a power of 2
+	APT_ASSERT(m_maxBlockCount > 0);
+	m_blocks = (Block*)eastl::allocate_memory(m_allocator, sizeof(Block) * m_maxBlockCount, alignof(Block), 0);
+	for (uint i = 0; i < m_maxBlockCount; ++i) {
+		new(&m_blocks[i]) Block();
+		m_blocks[i].m_data.store(nullptr, std::memory_order_relaxed);
+		m_blocks[i].m_committed.store(0, std::memory_order_relaxed);
+	}
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::~ConcurrentPersistentVector()
+{
+	clear();
+	for (uint i = 0; i < m_maxBlockCount; ++i) {
+		tType* data = m_blocks[i].m_data.load(std::memory_order_relaxed);
+		if (data) {
+			m_allocator.deallocate(data, sizeof(tType) * kBlockSize);
+		}
+		m_blocks[i].~Block();
+	}
+	m_allocator.deallocate(m_blocks, sizeof(Block) * m_maxBlockCount);
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+template <typename... tArgs>
+inline uint ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::emplace_back(tArgs&&... _args)
+{
+	uint ret = m_reserved.fetch_add(1, std::memory_order_relaxed);
+	uint blockIndex = ret / kBlockSize;
+	if_unlikely (blockIndex >= m_maxBlockCount) {
+	 // the reservation isn't undone (other threads may have reserved since), getReservedCount() clamps instead
+		return kInvalidIndex;
+	}
+	Block& block = m_blocks[blockIndex];
+	tType* data = block.m_data.load(std::memory_order_acquire);
+	if_unlikely (!data) {
+		data = allocBlock(blockIndex);
+	}
+	new(&data[ret % kBlockSize]) tType(std::forward<tArgs>(_args)...);
+	block.m_committed.fetch_add(1, std::memory_order_release);
+	return ret;
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::clear()
+{
+	APT_ASSERT(size() == getReservedCount()); // writers are active
+	forEachChunk([](tType* _data, uint _count) {
+		for (uint i = 0; i < _count; ++i) {
+			_data[i].~tType();
+		}
+	});
+	for (uint i = 0; i < m_maxBlockCount; ++i) {
+		m_blocks[i].m_committed.store(0, std::memory_order_relaxed);
+	}
+	m_reserved.store(0, std::memory_order_relaxed);
+	m_fullBlocks.store(0, std::memory_order_relaxed);
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline uint ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::size() const
+{
+ // fully committed blocks never change, start from the hint
+	uint blockIndex = m_fullBlocks.load(std::memory_order_acquire);
+	uint committed = 0;
+	for (; blockIndex < m_maxBlockCount; ++blockIndex) {
+		committed = m_blocks[blockIndex].m_committed.load(std::memory_order_acquire);
+		if (committed != kBlockSize) {
+			break;
+		}
+	}
+
+ // update the hint
+	uint hint = m_fullBlocks.load(std::memory_order_relaxed);
+	while (hint < blockIndex && !m_fullBlocks.compare_exchange_weak(hint, blockIndex, std::memory_order_release, std::memory_order_relaxed)) {
+	}
+
+	uint ret = blockIndex * kBlockSize;
+	if (blockIndex == m_maxBlockCount) {
+		return ret;
+	}
+
+ // the partial block is committed iff its committed count equals its reserved count; m_reserved is read *after* the committed count
+ // hence the committed elements can only be a subset of the reserved slots
+	uint reserved = m_reserved.load(std::memory_order_acquire);
+	reserved = reserved > ret ? APT_MIN(reserved - ret, kBlockSize) : 0;
+	return committed == reserved ? ret + committed : ret;
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+template <typename tFunc>
+inline void ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::forEachChunk(tFunc&& _func)
+{
+	uint n = size();
+	for (uint i = 0; n > 0; ++i) {
+		uint count = APT_MIN(n, kBlockSize);
+		_func(m_blocks[i].m_data.load(std::memory_order_relaxed), count); // size() synchronizes with the block publication
+		n -= count;
+	}
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+template <typename tFunc>
+inline void ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::forEachChunk(tFunc&& _func) const
+{
+	uint n = size();
+	for (uint i = 0; n > 0; ++i) {
+		uint count = APT_MIN(n, kBlockSize);
+		_func((const tType*)m_blocks[i].m_data.load(std::memory_order_relaxed), count);
+		n -= count;
+	}
+}
+
+
+//	PRIVATE
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline tType& ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::getElement(uint _i) const
+{
+	APT_ASSERT(_i < getReservedCount());
+	tType* data = m_blocks[_i / kBlockSize].m_data.load(std::memory_order_relaxed); // see forEachChunk()
+	APT_ASSERT(data);
+	return data[_i % kBlockSize];
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline tType* ConcurrentPersistentVector<tType, tAllocator, kBlockSize>::allocBlock(uint _i)
+{
+	tType* data = (tType*)eastl::allocate_memory(m_allocator, sizeof(tType) * kBlockSize, alignof(tType), 0);
+	tType* expected = nullptr;
+	if (!m_blocks[_i].m_data.compare_exchange_strong(expected, data, std::memory_order_acq_rel, std::memory_order_acquire)) {
+	 // another thread published the block first
+		m_allocator.deallocate(data, sizeof(tType) * kBlockSize);
+		return expected;
+	}
+	return data;
+}
+
+} // namespace apt
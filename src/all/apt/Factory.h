@@ -3,8 +3,9 @@
 #include <apt/apt.h>
 #include <apt/memory.h>
 #include <apt/StringHash.h>
+#include <apt/StringHashMap.h>
 
-#include <EASTL/vector_map.h>
+#include <EASTL/vector.h>
 
 namespace apt {
 
@@ -80,11 +81,12 @@ public:
 			, destroy(_destroy)
 		{
 			if_unlikely (!s_registry) {
-				s_registry = new eastl::vector_map<StringHash, ClassRef*>;
+				s_registry = new Registry;
 			}
 			APT_ASSERT(m_nameHash != StringHash::kInvalidHash);
 			APT_ASSERT(FindClassRef(m_nameHash) == nullptr); // multiple registrations, or name was not unique
-			s_registry->insert(eastl::make_pair(m_nameHash, this));
+			s_registry->m_map.insert(eastl::make_pair(m_nameHash, this));
+			s_registry->m_list.push_back(this);
 		}
 
 		const char* getName() const        { return m_name;     }
@@ -112,8 +114,8 @@ public:
 	// Find ClassRef corresponding to _nameHash, or 0 if not found.
 	static const ClassRef* FindClassRef(StringHash _nameHash)
 	{
-		auto ret = s_registry->find(_nameHash);
-		if (ret != s_registry->end()) {
+		auto ret = s_registry->m_map.find(_nameHash);
+		if (ret != s_registry->m_map.end()) {
 			return ret->second;
 		}
 		return nullptr;
@@ -122,15 +124,15 @@ public:
 	// Get number of classes registered with the factory.
 	static int GetClassRefCount()
 	{
-		return (int)s_registry->size();
+		return (int)s_registry->m_list.size();
 	}
 
 	// Get _ith ClassRef registered with the factory.
-	// \note The result for a value of _i may change if more ClassRefs are registered.
+	// \note ClassRefs are returned in registration order, which depends on static initialization order.
 	static const ClassRef* GetClassRef(int _i)
 	{
 		APT_ASSERT(_i < GetClassRefCount());
-		return (s_registry->begin() + _i)->second;
+		return s_registry->m_list[_i];
 	}
 
 	// Return ptr to a new instance of the class specified by _name, or nullptr if an error occurred.
@@ -164,11 +166,17 @@ public:
 	const ClassRef* getClassRef() const { return m_cref; }
 
 private:
-	static eastl::vector_map<StringHash, ClassRef*>* s_registry;
+	struct Registry
+	{
+		StringHashMap<ClassRef*>  m_map;  // For lookup by name.
+		eastl::vector<ClassRef*>  m_list; // For GetClassRef().
+	};
+
+	static Registry* s_registry;
 	const ClassRef* m_cref;
 };
 #define APT_FACTORY_DEFINE(_baseClass) \
-	eastl::vector_map<apt::StringHash, apt::Factory<_baseClass>::ClassRef*>* apt::Factory<_baseClass>::s_registry
+	template <> apt::Factory<_baseClass>::Registry* apt::Factory<_baseClass>::s_registry = nullptr
 #define APT_FACTORY_REGISTER(_baseClass, _subClass, _createFunc, _destroyFunc) \
 	static apt::Factory<_baseClass>::ClassRef s_ ## _subClass(#_subClass, _createFunc, _destroyFunc);
 #define APT_FACTORY_REGISTER_DEFAULT(_baseClass, _subClass) \
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <apt/apt.h>
+#include <apt/ProxyAllocator.h>
 #include <apt/String.h>
 
 #include <EASTL/vector.h>
@@ -20,7 +21,11 @@ class File: private non_copyable<File>
 {
 public:
 
+	// The internal buffer is allocated via APT_MALLOC_LARGE (see memory.h), hence large files are read into memory allocated directly
+	// from the OS. Use LargeAllocScope to override this at a particular call site.
 	File();
+	// The internal buffer is allocated via _allocator (see Allocator.h), e.g. to read files into an Arena.
+	explicit File(const ProxyAllocator& _allocator);
 	~File();
 
 	// Return true if _path exists.
@@ -53,9 +58,11 @@ public:
 
 private:
 
+	typedef eastl::vector<char, ProxyAllocator> Data;
+
 	PathStr             m_path  = "";
 	void*               m_impl  = nullptr;
-	eastl::vector<char> m_data;
+	Data                m_data;
 };
 
 } // namespace apt
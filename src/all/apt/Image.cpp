@@ -309,7 +309,7 @@ void Image::setRawImage(uint _array, uint _mip, const void* _src, Layout _layout
 
 Image::~Image()
 {
-	free(m_data);
+	APT_FREE_LARGE(m_data);
 }
 
 void Image::init()
@@ -331,7 +331,8 @@ void Image::init()
 
 void Image::alloc()
 {
-	free(m_data);
+	APT_FREE_LARGE(m_data);
+	m_data = nullptr;
 
 	if (m_compression == Compression_None) {
 		m_bytesPerTexel = (float)(DataTypeSizeBytes(m_dataType) * GetComponentCount(m_layout));
@@ -367,7 +368,7 @@ void Image::alloc()
 	} while (i < lim);
 
 	uint imageCount = isCubemap() ? m_arrayCount * 6 : m_arrayCount;
-	m_data = (char*)APT_MALLOC(m_arrayLayerSize * imageCount);
+	m_data = (char*)APT_MALLOC_LARGE(m_arrayLayerSize * imageCount); // see LargeAllocScope to override
 	APT_ASSERT(m_data);
 }
 
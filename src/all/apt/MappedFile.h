@@ -0,0 +1,52 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/String.h>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedFile
+// Read-only memory mapped file. Views of any part of the file can be mapped
+// independently, the OS pages data in on access. Processes which map the same
+// file share the physical pages.
+//
+//    MappedFile f;
+//    if (f.open("data.bin")) {
+//       const char* data = f.map(offset, size);
+//       ...
+//       f.unmap(data, size);
+//    }
+////////////////////////////////////////////////////////////////////////////////
+class MappedFile: private non_copyable<MappedFile>
+{
+public:
+
+	MappedFile();
+	~MappedFile();
+
+	// Open _path for mapping. Return false if an error occurred. On success, any resources previously associated with the file are
+	// released.
+	bool        open(const char* _path);
+
+	// Release the file. All views should be unmapped first.
+	void        close();
+
+	// Map _size bytes at _offset (no alignment requirement), return a ptr to the data at _offset or nullptr if an error occurred. Each
+	// call to map() should be matched by a call to unmap() with the returned ptr and _size.
+	const char* map(uint64 _offset, uint64 _size);
+	void        unmap(const char* _data, uint64 _size);
+
+	bool        isOpen() const               { return m_mapping != nullptr; }
+	const char* getPath() const              { return (const char*)m_path; }
+	uint64      getSize() const              { return m_size; }
+
+private:
+
+	PathStr             m_path    = "";
+	void*               m_impl    = nullptr; // file handle
+	void*               m_mapping = nullptr; // mapping handle
+	uint64              m_size    = 0;
+};
+
+} // namespace apt
@@ -0,0 +1,139 @@
+#include <apt/MemoryInstrumentation.h>
+
+#include <apt/Json.h>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace apt {
+
+namespace {
+
+// Counters are zero-initialized static storage, so allocations made during static initialization are counted correctly.
+struct TagData
+{
+	const char*         m_name;
+	std::atomic<uint64> m_liveBytes;
+	std::atomic<uint64> m_peakBytes;
+	std::atomic<uint64> m_liveCount;
+	std::atomic<uint64> m_allocCount;
+	std::atomic<uint64> m_histogram[MemoryInstrumentation::kHistogramBucketCount];
+};
+TagData          s_tags[MemoryInstrumentation::kMaxTagCount];
+std::atomic<int> s_tagCount(1); // tag 0 is "Untagged"
+std::mutex       s_tagMutex;
+
+inline int GetHistogramBucket(size_t _size)
+{
+	int ret = 0;
+	while (_size > 1 && ret < MemoryInstrumentation::kHistogramBucketCount - 1) {
+		_size >>= 1;
+		++ret;
+	}
+	return ret;
+}
+
+} // namespace
+
+thread_local int MemoryInstrumentation::s_threadTag = 0;
+
+int MemoryInstrumentation::FindOrAddTag(const char* _name)
+{
+	APT_ASSERT(_name);
+	std::lock_guard<std::mutex> lock(s_tagMutex);
+	int tagCount = s_tagCount.load();
+	for (int i = 1; i < tagCount; ++i) {
+		if (strcmp(s_tags[i].m_name, _name) == 0) {
+			return i;
+		}
+	}
+	if (tagCount == kMaxTagCount) {
+		APT_ASSERT_MSG(false, "MemoryInstrumentation: kMaxTagCount (%d) exceeded, '%s' will be counted as 'Untagged'", kMaxTagCount, _name);
+		return 0;
+	}
+	s_tags[tagCount].m_name = _name;
+	s_tagCount.store(tagCount + 1);
+	return tagCount;
+}
+
+int MemoryInstrumentation::GetTagCount()
+{
+	return s_tagCount.load();
+}
+
+void MemoryInstrumentation::GetStats(int _tag, Stats& _stats_)
+{
+	APT_ASSERT(_tag >= 0 && _tag < GetTagCount());
+	const TagData& tag = s_tags[_tag];
+	_stats_.m_name       = _tag == 0 ? "Untagged" : tag.m_name;
+	_stats_.m_liveBytes  = tag.m_liveBytes.load(std::memory_order_relaxed);
+	_stats_.m_peakBytes  = tag.m_peakBytes.load(std::memory_order_relaxed);
+	_stats_.m_liveCount  = tag.m_liveCount.load(std::memory_order_relaxed);
+	_stats_.m_allocCount = tag.m_allocCount.load(std::memory_order_relaxed);
+	for (int i = 0; i < kHistogramBucketCount; ++i) {
+		_stats_.m_histogram[i] = tag.m_histogram[i].load(std::memory_order_relaxed);
+	}
+}
+
+void MemoryInstrumentation::ResetPeaks()
+{
+	for (int i = 0, n = GetTagCount(); i < n; ++i) {
+		s_tags[i].m_peakBytes.store(s_tags[i].m_liveBytes.load());
+	}
+}
+
+void MemoryInstrumentation::Snapshot(Json& _json_)
+{
+ // copy the counters first, writing to _json_ allocates
+	int tagCount = GetTagCount();
+	Stats* stats = new Stats[tagCount];
+	for (int i = 0; i < tagCount; ++i) {
+		GetStats(i, stats[i]);
+	}
+
+	_json_.beginArray("MemoryTags");
+	for (int i = 0; i < tagCount; ++i) {
+		_json_.beginObject();
+			_json_.setValue(stats[i].m_name,       "Name");
+			_json_.setValue(stats[i].m_liveBytes,  "LiveBytes");
+			_json_.setValue(stats[i].m_peakBytes,  "PeakBytes");
+			_json_.setValue(stats[i].m_liveCount,  "LiveCount");
+			_json_.setValue(stats[i].m_allocCount, "AllocCount");
+			_json_.beginArray("Histogram");
+				for (int j = 0; j < kHistogramBucketCount; ++j) {
+					_json_.pushValue(stats[i].m_histogram[j]);
+				}
+			_json_.endArray();
+		_json_.endObject();
+	}
+	_json_.endArray();
+
+	delete[] stats;
+}
+
+namespace internal {
+
+void RecordAlloc(int _tag, size_t _size)
+{
+	TagData& tag = s_tags[_tag];
+	uint64 live = tag.m_liveBytes.fetch_add(_size, std::memory_order_relaxed) + _size;
+	uint64 peak = tag.m_peakBytes.load(std::memory_order_relaxed);
+	while (live > peak && !tag.m_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+		;
+	}
+	tag.m_liveCount.fetch_add(1, std::memory_order_relaxed);
+	tag.m_allocCount.fetch_add(1, std::memory_order_relaxed);
+	tag.m_histogram[GetHistogramBucket(_size)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RecordFree(int _tag, size_t _size)
+{
+	TagData& tag = s_tags[_tag];
+	tag.m_liveBytes.fetch_sub(_size, std::memory_order_relaxed);
+	tag.m_liveCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+} // namespace internal
+
+} // namespace apt
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <apt/apt.h>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// MemoryInstrumentation
+// Opt-in tracking of allocations made via APT_MALLOC et al. (and hence global
+// new and EASTL containers). Define APT_ENABLE_MEMORY_INSTRUMENTATION to enable
+// (see config.h); when disabled APT_MEMORY_TAG compiles to nothing and no
+// counters are updated.
+//
+// Allocations are attributed to the memory tag which is active on the calling
+// thread:
+//
+//    { APT_MEMORY_TAG("Json");
+//       Json json("data.json"); // DOM allocations are counted against "Json"
+//    }
+//
+// Allocations made outside of any tag scope are counted against "Untagged".
+// Frees are always attributed to the tag active when the allocation was made.
+// Use GetStats() or Snapshot() to retrieve the counters.
+//
+// When enabled each allocation is prefixed by a 16 byte header which stores the
+// size and tag.
+////////////////////////////////////////////////////////////////////////////////
+class MemoryInstrumentation
+{
+	friend class MemoryTagScope;
+public:
+	static const int kMaxTagCount          = 64;
+	static const int kHistogramBucketCount = 32; // Bucket i counts allocations of [2^i, 2^(i+1)) bytes, the last bucket counts all larger allocations.
+
+	struct Stats
+	{
+		const char* m_name;
+		uint64      m_liveBytes;
+		uint64      m_peakBytes;
+		uint64      m_liveCount;
+		uint64      m_allocCount; // Total number of allocations since startup.
+		uint64      m_histogram[kHistogramBucketCount];
+	};
+
+	// Return the index of the tag _name, add a new tag if not found. _name must be a string literal (the ptr is stored). Return 0 ("Untagged")
+	// if kMaxTagCount is exceeded.
+	static int  FindOrAddTag(const char* _name);
+
+	static int  GetTagCount();
+
+	// Copy the current counters for _tag into _stats_. The counters for different tags are not read atomically with respect to each other.
+	static void GetStats(int _tag, Stats& _stats_);
+
+	// Reset the peak for all tags to the current live size.
+	static void ResetPeaks();
+
+	// Write the counters for all tags to _json_ as a "MemoryTags" array.
+	static void Snapshot(Json& _json_);
+
+	// Return the tag active on the calling thread.
+	static int  GetThreadTag()                { return s_threadTag; }
+
+private:
+	static thread_local int s_threadTag;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// MemoryTagScope
+// Set the active memory tag on the calling thread for the lifetime of the
+// MemoryTagScope. Use via APT_MEMORY_TAG().
+////////////////////////////////////////////////////////////////////////////////
+class MemoryTagScope: private non_copyable<MemoryTagScope>
+{
+public:
+	MemoryTagScope(int _tag): m_prev(MemoryInstrumentation::s_threadTag) { MemoryInstrumentation::s_threadTag = _tag; }
+	~MemoryTagScope()                                                     { MemoryInstrumentation::s_threadTag = m_prev; }
+
+private:
+	int m_prev;
+};
+
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	#define APT_MEMORY_TAG(_name) APT_MEMORY_TAG_(_name, APT_UNIQUE_NAME(_memoryTag))
+	#define APT_MEMORY_TAG_(_name, _id) \
+		static const int _id = apt::MemoryInstrumentation::FindOrAddTag(_name); \
+		apt::MemoryTagScope APT_TOKEN_CONCATENATE(_id, _scope)(_id)
+#else
+	#define APT_MEMORY_TAG(_name) do { APT_UNUSED(_name); } while (0)
+#endif
+
+} // namespace apt
+
+namespace apt { namespace internal {
+
+// Update the counters for _tag, called by the allocation functions in memory.cpp.
+void RecordAlloc(int _tag, size_t _size);
+void RecordFree(int _tag, size_t _size);
+
+} } // namespace apt::internal
@@ -1,23 +1,157 @@
 #include <apt/MemoryPool.h>
 
+#include <apt/Arena.h>
+#include <apt/math.h>
 #include <apt/memory.h>
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <new>
 #include <utility>
 
 using namespace apt;
 
+static const uint kReleased = ~(uint)0; // Block::m_freeCount for blocks to be released by trim()
+
+// Global block directory, all blocks from all pools sorted by address (see MemoryPool::FindPool()). Writers serialize on a mutex,
+// readers are lock-free: the entries are guarded by a sequence lock (odd while a write is in progress) and readers retry if the
+// sequence changed during the lookup. Entries are atomic so that racing reads are well defined, a torn read is simply discarded.
+struct DirectoryEntry
+{
+	std::atomic<uint>  m_begin;  // First object in the block.
+	std::atomic<uint>  m_end;    // End of the last object in the block.
+	std::atomic<void*> m_block;
+};
+
+struct DirectoryArray
+{
+	uint            m_capacity;
+	DirectoryArray* m_prev;      // Previous (smaller) array, retained because readers may still be accessing it.
+
+	DirectoryEntry* getEntries() { return (DirectoryEntry*)(this + 1); }
+};
+
+struct Directory
+{
+	std::mutex                   m_mutex;
+	std::atomic<uint>            m_sequence;
+	std::atomic<DirectoryArray*> m_array;
+	std::atomic<uint>            m_count;
+};
+
+static Directory& GetDirectory()
+{
+	static Directory s_directory; // function static, pools may allocate blocks during static initialization
+	return s_directory;
+}
+
+static void DirectoryBeginWrite(Directory& _dir)
+{
+	_dir.m_sequence.store(_dir.m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+static void DirectoryEndWrite(Directory& _dir)
+{
+	_dir.m_sequence.store(_dir.m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+static void DirectoryCopyEntry(DirectoryEntry& dst_, const DirectoryEntry& _src)
+{
+	dst_.m_begin.store(_src.m_begin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	dst_.m_end.store(_src.m_end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	dst_.m_block.store(_src.m_block.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+static void DirectoryInsert(void* _block, uint _begin, uint _end)
+{
+	Directory& dir = GetDirectory();
+	std::lock_guard<std::mutex> lock(dir.m_mutex);
+	DirectoryArray* arr = dir.m_array.load(std::memory_order_relaxed);
+	uint count = dir.m_count.load(std::memory_order_relaxed);
+	if (!arr || count == arr->m_capacity) {
+	 // grow; the new array is a copy of the old one so it can be published without entering the write section
+		ArenaScope suspend(nullptr); // the directory must outlive any thread arena
+		uint capacity = arr ? arr->m_capacity * 2 : 64;
+		DirectoryArray* newArr = (DirectoryArray*)APT_MALLOC(sizeof(DirectoryArray) + sizeof(DirectoryEntry) * capacity);
+		newArr->m_capacity = capacity;
+		newArr->m_prev = arr;
+		DirectoryEntry* entries = newArr->getEntries();
+		for (uint i = 0; i < capacity; ++i) {
+			new(entries + i) DirectoryEntry();
+		}
+		for (uint i = 0; i < count; ++i) {
+			DirectoryCopyEntry(entries[i], arr->getEntries()[i]);
+		}
+		dir.m_array.store(newArr, std::memory_order_release);
+		arr = newArr;
+	}
+
+	DirectoryEntry* entries = arr->getEntries();
+	uint pos = count;
+	while (pos > 0 && entries[pos - 1].m_begin.load(std::memory_order_relaxed) > _begin) {
+		--pos;
+	}
+	DirectoryBeginWrite(dir);
+	for (uint i = count; i > pos; --i) {
+		DirectoryCopyEntry(entries[i], entries[i - 1]);
+	}
+	entries[pos].m_begin.store(_begin, std::memory_order_relaxed);
+	entries[pos].m_end.store(_end, std::memory_order_relaxed);
+	entries[pos].m_block.store(_block, std::memory_order_relaxed);
+	dir.m_count.store(count + 1, std::memory_order_relaxed);
+	DirectoryEndWrite(dir);
+}
+
+// Remove _count blocks, which must be sorted by address. O(n) in the total number of blocks.
+static void DirectoryRemove(void* const* _blocks, uint _count)
+{
+	if (_count == 0) {
+		return;
+	}
+	Directory& dir = GetDirectory();
+	std::lock_guard<std::mutex> lock(dir.m_mutex);
+	DirectoryEntry* entries = dir.m_array.load(std::memory_order_relaxed)->getEntries();
+	uint count = dir.m_count.load(std::memory_order_relaxed);
+	DirectoryBeginWrite(dir);
+	uint n = 0;
+	uint j = 0;
+	for (uint i = 0; i < count; ++i) {
+		if (j < _count && entries[i].m_block.load(std::memory_order_relaxed) == _blocks[j]) {
+			++j;
+			continue;
+		}
+		if (n != i) {
+			DirectoryCopyEntry(entries[n], entries[i]);
+		}
+		++n;
+	}
+	APT_ASSERT(j == _count); // not all blocks were found, or _blocks isn't sorted
+	dir.m_count.store(n, std::memory_order_relaxed);
+	DirectoryEndWrite(dir);
+}
+
 void apt::swap(MemoryPool& _a, MemoryPool& _b)
 {
 	using std::swap;
 	swap(_a.m_objectSize,      _b.m_objectSize);
 	swap(_a.m_objectAlignment, _b.m_objectAlignment);
 	swap(_a.m_blockSize,       _b.m_blockSize);
+	swap(_a.m_objectOffset,    _b.m_objectOffset);
 	swap(_a.m_nextFree,        _b.m_nextFree);
 	swap(_a.m_usedCount,       _b.m_usedCount);
 	swap(_a.m_blocks,          _b.m_blocks);
 	swap(_a.m_blockCount,      _b.m_blockCount);
+	swap(_a.m_blockCapacity,   _b.m_blockCapacity);
+
+ // fix up the owning pool ptrs
+	for (uint i = 0; i < _a.m_blockCount; ++i) {
+		_a.m_blocks[i]->m_pool = &_a;
+	}
+	for (uint i = 0; i < _b.m_blockCount; ++i) {
+		_b.m_blocks[i]->m_pool = &_b;
+	}
 }
 
 // PUBLIC
@@ -26,17 +160,24 @@ MemoryPool::MemoryPool(uint _objectSize, uint _objectAlignment, uint _blockSize)
 	: m_objectSize(_objectSize)
 	, m_objectAlignment(_objectAlignment)
 	, m_blockSize(_blockSize)
+	, m_objectOffset(0)
 	, m_nextFree(0)
 	, m_usedCount(0)
 	, m_blocks(0)
 	, m_blockCount(0)
+	, m_blockCapacity(0)
 {
 	APT_ASSERT(m_objectSize >= sizeof(void*)); // objects must be at least the size of a ptr
+	APT_ASSERT(m_blockSize > 0);
+	m_objectAlignment = APT_MAX(m_objectAlignment, (uint)alignof(Block));
+	m_objectOffset = (sizeof(Block) + m_objectAlignment - 1) & ~(m_objectAlignment - 1);
 }
 
 MemoryPool::~MemoryPool()
 {
 	APT_ASSERT(m_usedCount == 0); // not all objects were freed
+	std::sort(m_blocks, m_blocks + m_blockCount);
+	DirectoryRemove((void* const*)m_blocks, m_blockCount);
 	for (uint i = 0; i < m_blockCount; ++i) {
 		APT_FREE_ALIGNED(m_blocks[i]);
 	}
@@ -45,7 +186,7 @@ MemoryPool::~MemoryPool()
 
 void* MemoryPool::alloc()
 {
-	if (m_nextFree == 0) {
+	if_unlikely (m_nextFree == 0) {
 		allocBlock();
 	}
 	void* ret = m_nextFree;
@@ -58,41 +199,139 @@ void MemoryPool::free(void* _object)
 {
 	APT_ASSERT(_object);
 	APT_ASSERT(m_usedCount > 0);
+	APT_STRICT_ASSERT(isFromPool(_object));
 	*((void**)_object) = m_nextFree;
 	m_nextFree = _object;
 	--m_usedCount;
 }
 
+void MemoryPool::allocBatch(void** _objects_, uint _count)
+{
+	for (uint i = 0; i < _count; ++i) {
+		if_unlikely (m_nextFree == 0) {
+			allocBlock();
+		}
+		_objects_[i] = m_nextFree;
+		m_nextFree = *((void**)m_nextFree);
+	}
+	m_usedCount += _count;
+}
 
-// PRIVATE
+void MemoryPool::freeBatch(void* const* _objects, uint _count)
+{
+	APT_ASSERT(m_usedCount >= _count);
+	if (_count == 0) {
+		return;
+	}
+ // link the objects into a chain and splice it onto the head of the free list
+	for (uint i = 0, n = _count - 1; i < n; ++i) {
+		APT_ASSERT(_objects[i]);
+		*((void**)_objects[i]) = _objects[i + 1];
+	}
+	APT_ASSERT(_objects[_count - 1]);
+	*((void**)_objects[_count - 1]) = m_nextFree;
+	m_nextFree = _objects[0];
+	m_usedCount -= _count;
+}
 
-void MemoryPool::allocBlock()
+uint MemoryPool::trim(uint _keepBlocks)
 {
-	m_blocks = (void**)APT_REALLOC_ALIGNED(m_blocks, sizeof(void*) * (m_blockCount + 1), alignof(void*));
-	m_blocks[m_blockCount] = APT_MALLOC_ALIGNED(m_objectSize * m_blockSize, m_objectAlignment);
+	if (m_blockCount == 0) {
+		return 0;
+	}
 
- // init free ptrs; if m_nextFree initially points to locX, after initializing the new block (starting new0) is initialized as follows:
- //  m_nextFree -> new0 -> new1 -> new2 -> new3 -> locX
-	uint p = (uint)m_blocks[m_blockCount];
-	for (uint i = 0, n = m_blockSize - 1; i < n; ++i) {
-		*((uint*)p) = p + m_objectSize;
-		p += m_objectSize;
+ // count free objects per block
+	std::sort(m_blocks, m_blocks + m_blockCount);
+	for (uint i = 0; i < m_blockCount; ++i) {
+		m_blocks[i]->m_freeCount = 0;
+	}
+	Block* block = 0;
+	for (void* p = m_nextFree; p != 0; p = *((void**)p)) {
+		if (!block || !isInBlock(block, p)) { // consecutive free objects are often from the same block
+			block = findBlock(p);
+			APT_ASSERT(block); // free list is corrupt
+		}
+		++block->m_freeCount;
+	}
+
+ // rebuild the free list from objects in partially used blocks, in their current order (empty blocks are appended below)
+	void** tail = &m_nextFree;
+	block = 0;
+	for (void* p = m_nextFree; p != 0; p = *((void**)p)) {
+		if (!block || !isInBlock(block, p)) {
+			block = findBlock(p);
+		}
+		if (block->m_freeCount != m_blockSize) {
+			*tail = p;
+			tail = (void**)p;
+		}
+	}
+	*tail = 0;
+
+ // append kept empty blocks to the free list so that partially used blocks fill up first, release the rest
+	uint keptCount = 0;
+	for (uint i = 0; i < m_blockCount; ++i) {
+		block = m_blocks[i];
+		if (block->m_freeCount == m_blockSize) {
+			if (keptCount == _keepBlocks) {
+				block->m_freeCount = kReleased;
+				continue;
+			}
+			++keptCount;
+			*tail = initBlock(block, 0);
+			tail = (void**)(getObjects(block) + m_objectSize * (m_blockSize - 1));
+		}
+	}
+	Block** released = std::partition(m_blocks, m_blocks + m_blockCount, [](Block* _block) { return _block->m_freeCount != kReleased; });
+	uint ret = (uint)(m_blocks + m_blockCount - released);
+	std::sort(released, m_blocks + m_blockCount);
+	DirectoryRemove((void* const*)released, ret);
+	for (uint i = 0; i < ret; ++i) {
+		APT_FREE_ALIGNED(released[i]);
 	}
-	*((uint*)p) = (uint)m_nextFree;
-	m_nextFree = m_blocks[m_blockCount];
-	
-	++m_blockCount;
+	m_blockCount -= ret;
+	return ret;
 }
 
 bool MemoryPool::isFromPool(const void* _ptr) const
 {
+	return FindPool(_ptr) == this;
+}
+
+MemoryPool* MemoryPool::FindPool(const void* _ptr)
+{
+	Directory& dir = GetDirectory();
 	uint p = (uint)_ptr;
-	for (uint i = 0; i < m_blockCount; ++i) {
-		if (p >= (uint)m_blocks[i] && p < ((uint)m_blocks[i] + m_blockSize * m_objectSize)) {
-			return true;
+	for (;;) {
+		uint sequence = dir.m_sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			continue; // write in progress
+		}
+		void* block = 0;
+		DirectoryArray* arr = dir.m_array.load(std::memory_order_acquire);
+		if (arr) {
+		 // find the last entry with m_begin <= p; the count may be stale relative to arr, the sequence check below catches this
+			const DirectoryEntry* entries = arr->getEntries();
+			uint lo = 0;
+			uint hi = APT_MIN(dir.m_count.load(std::memory_order_relaxed), arr->m_capacity);
+			while (lo < hi) {
+				uint mid = (lo + hi) / 2;
+				if (entries[mid].m_begin.load(std::memory_order_relaxed) <= p) {
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+			if (lo > 0 && p < entries[lo - 1].m_end.load(std::memory_order_relaxed)) {
+				block = entries[lo - 1].m_block.load(std::memory_order_relaxed);
+			}
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (dir.m_sequence.load(std::memory_order_relaxed) == sequence) {
+		 // the block can't be released while _ptr is live, hence it's safe to access the header
+			return block ? ((Block*)block)->m_pool : nullptr;
 		}
 	}
-	return false;
 }
 
 bool MemoryPool::validate() const
@@ -103,6 +342,52 @@ bool MemoryPool::validate() const
 		++freeCount;
 		p = *((void**)p);
 	}
-	uint totalObjects = m_blockSize * m_blockCount;
-	return m_usedCount == totalObjects - freeCount;
+	return m_usedCount == getCapacity() - freeCount;
+}
+
+
+// PRIVATE
+
+void MemoryPool::allocBlock()
+{
+	if (m_blockCount == m_blockCapacity) {
+		m_blockCapacity = APT_MAX(m_blockCapacity * 2, (uint)8);
+		m_blocks = (Block**)APT_REALLOC_ALIGNED(m_blocks, sizeof(Block*) * m_blockCapacity, alignof(Block*));
+	}
+	Block* block = (Block*)APT_MALLOC_ALIGNED(m_objectOffset + m_objectSize * m_blockSize, m_objectAlignment);
+	block->m_pool      = this;
+	block->m_freeCount = 0;
+	m_nextFree = initBlock(block, m_nextFree);
+	m_blocks[m_blockCount++] = block;
+	DirectoryInsert(block, (uint)getObjects(block), (uint)getObjects(block) + m_objectSize * m_blockSize);
+}
+
+void* MemoryPool::initBlock(Block* _block, void* _next)
+{
+ // init free ptrs; if _next points to locX, the block's objects are initialized as follows:
+ //  obj0 -> obj1 -> obj2 -> obj3 -> locX
+	uint p = (uint)getObjects(_block);
+	for (uint i = 0, n = m_blockSize - 1; i < n; ++i) {
+		*((uint*)p) = p + m_objectSize;
+		p += m_objectSize;
+	}
+	*((uint*)p) = (uint)_next;
+	return getObjects(_block);
+}
+
+MemoryPool::Block* MemoryPool::findBlock(const void* _ptr) const
+{
+ // find the last block with address <= _ptr
+	Block** pos = std::upper_bound(m_blocks, m_blocks + m_blockCount, (Block*)_ptr);
+	if (pos == m_blocks) {
+		return 0;
+	}
+	Block* block = *(pos - 1);
+	return isInBlock(block, _ptr) ? block : 0;
+}
+
+bool MemoryPool::isInBlock(const Block* _block, const void* _ptr) const
+{
+	const char* begin = (const char*)_block + m_objectOffset;
+	return (const char*)_ptr >= begin && (const char*)_ptr < begin + m_blockSize * m_objectSize;
 }
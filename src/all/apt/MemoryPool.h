@@ -7,7 +7,7 @@ namespace apt {
 ////////////////////////////////////////////////////////////////////////////////
 // MemoryPool
 // See Pool.h for a more user-friendly, templated version of this class.
-// Provides (de)allocations of objects with O(1) complexity given a fixed object 
+// Provides (de)allocations of objects with O(1) complexity given a fixed object
 // size/alignment.
 // Usage:	
 //
@@ -16,6 +16,10 @@ namespace apt {
 //    f->~Foo(); // explicit dtor call
 //    mp.free(f);
 //
+// Call trim() to release empty blocks. Per-block occupancy is only computed by
+// trim(), alloc()/free() don't pay for it. trim() also reorders the free list
+// so that partially used blocks are filled before any retained empty blocks.
+//
 // Any allocated objects should be released via free() before the MemoryPool is 
 // destroyed.
 ////////////////////////////////////////////////////////////////////////////////
@@ -31,26 +35,65 @@ public:
 	void* alloc();
 	void  free(void* _object);
 
-	// Return true if _ptr was allocated from the pool.
+	// Allocate _count objects, write the ptrs to _objects_. Cheaper than calling alloc() _count times.
+	void  allocBatch(void** _objects_, uint _count);
+	// Free _count objects. Cheaper than calling free() _count times.
+	void  freeBatch(void* const* _objects, uint _count);
+
+	// Release empty blocks, retaining at most _keepBlocks empty blocks for reuse. Return the number of blocks released. O(n log n) in
+	// the number of blocks + O(m log n) in the number of free objects.
+	uint  trim(uint _keepBlocks = 0);
+
+	// Return true if _ptr was allocated from the pool. O(log n) in the total number of blocks across all pools (see FindPool()).
 	bool isFromPool(const void* _ptr) const;
 
+	// Return the pool from which _ptr was allocated, or nullptr. O(log n) in the total number of blocks across all pools. Use to route
+	// frees when objects may come from one of several pools:
+	//
+	//    if (MemoryPool* pool = MemoryPool::FindPool(ptr)) {
+	//       pool->free(ptr);
+	//    }
+	//
+	// Lock-free and thread safe with respect to block (de)allocation by pools on other threads; block (de)allocation takes a global
+	// lock. The returned pool itself isn't synchronized. In particular, for objects allocated via ThreadCachedMemoryPool this returns
+	// the internal MemoryPool, which must not be used directly: free via the owning ThreadCachedMemoryPool instead.
+	static MemoryPool* FindPool(const void* _ptr);
+
 	// Return true if # used objects is consistent with # accessible free objects.
 	bool validate() const;
 
-	uint getCapacity() const  { return m_blockSize * m_blockCount; }
-	uint getUsedCount() const { return m_usedCount; }
-	uint getFreeCount() const { return getCapacity() - m_usedCount; }
+	uint getCapacity() const        { return m_blockSize * m_blockCount; }
+	uint getUsedCount() const       { return m_usedCount; }
+	uint getFreeCount() const       { return getCapacity() - m_usedCount; }
+	uint getBlockCount() const      { return m_blockCount; }
+	uint getObjectSize() const      { return m_objectSize; }
+	uint getObjectAlignment() const { return m_objectAlignment; }
 
 	friend void swap(MemoryPool& _a, MemoryPool& _b);
 	
 private:
-	uint   m_objectSize, m_objectAlignment, m_blockSize;
-	void*  m_nextFree;
-	uint   m_usedCount;
-	void** m_blocks;
-	uint   m_blockCount;
+	// Block header, precedes the block's objects.
+	struct Block
+	{
+		MemoryPool* m_pool;         // Owning pool (see FindPool()).
+		uint        m_freeCount;    // Only valid during trim().
+	};
+
+	uint    m_objectSize, m_objectAlignment, m_blockSize;
+	uint    m_objectOffset;    // Offset of the first object from the block header.
+	void*   m_nextFree;
+	uint    m_usedCount;
+	Block** m_blocks;          // Unordered, sorted by trim().
+	uint    m_blockCount;
+	uint    m_blockCapacity;   // Size of m_blocks, grows geometrically.
 
-	void allocBlock();
+	void   allocBlock();
+	// Link _block's objects into a free list which ends at _next, return the first object.
+	void*  initBlock(Block* _block, void* _next);
+	// Return the block containing _ptr, or nullptr if _ptr isn't from the pool. m_blocks must be sorted (see trim()).
+	Block* findBlock(const void* _ptr) const;
+	char*  getObjects(Block* _block) const { return (char*)_block + m_objectOffset; }
+	bool   isInBlock(const Block* _block, const void* _ptr) const;
 
 };
 
@@ -0,0 +1,145 @@
+#include <apt/Morton.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define APT_MORTON_BMI2 1
+	#include <immintrin.h> // _pdep_u64, _pext_u64
+	#if APT_COMPILER_MSVC
+		#include <intrin.h> // __cpuidex
+		#define APT_MORTON_TARGET_BMI2
+	#else
+		#include <cpuid.h>  // __cpuid_count
+		#define APT_MORTON_TARGET_BMI2 __attribute__((target("bmi2")))
+	#endif
+#endif
+
+using namespace apt;
+
+namespace {
+
+#if APT_MORTON_BMI2
+
+constexpr uint64 kMask2[2] = { 0x5555555555555555ull, 0xaaaaaaaaaaaaaaaaull };
+constexpr uint64 kMask3[3] = { 0x1249249249249249ull, 0x2492492492492492ull, 0x4924924924924924ull };
+
+void Cpuid(uint32 _leaf, uint32 regs_[4])
+{
+#if APT_COMPILER_MSVC
+	__cpuidex((int*)regs_, (int)_leaf, 0);
+#else
+	__cpuid_count(_leaf, 0, regs_[0], regs_[1], regs_[2], regs_[3]);
+#endif
+}
+
+bool DetectBmi2()
+{
+	uint32 regs[4]; // eax, ebx, ecx, edx
+	Cpuid(0, regs);
+	if (regs[0] < 7) {
+		return false;
+	}
+	bool isAmd = regs[1] == 0x68747541; // "Auth"enticAMD
+	Cpuid(1, regs);
+	uint32 family = ((regs[0] >> 8) & 0xf) + ((regs[0] >> 20) & 0xff);
+	Cpuid(7, regs);
+	bool hasBmi2 = (regs[1] & (1u << 8)) != 0;
+ // pdep/pext are microcoded on AMD prior to Zen 3 (family 19h) and much slower than the magic bits
+	return hasBmi2 && !(isAmd && family < 0x19);
+}
+
+APT_MORTON_TARGET_BMI2 void Encode2Bmi2(const uvec2* _coords, uint64* out_, uint _count)
+{
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = _pdep_u64(_coords[i].x, kMask2[0]) | _pdep_u64(_coords[i].y, kMask2[1]);
+	}
+}
+
+APT_MORTON_TARGET_BMI2 void Encode3Bmi2(const uvec3* _coords, uint64* out_, uint _count)
+{
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = _pdep_u64(_coords[i].x, kMask3[0]) | _pdep_u64(_coords[i].y, kMask3[1]) | _pdep_u64(_coords[i].z, kMask3[2]);
+	}
+}
+
+APT_MORTON_TARGET_BMI2 void Decode2Bmi2(const uint64* _codes, uvec2* out_, uint _count)
+{
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = uvec2((uint32)_pext_u64(_codes[i], kMask2[0]), (uint32)_pext_u64(_codes[i], kMask2[1]));
+	}
+}
+
+APT_MORTON_TARGET_BMI2 void Decode3Bmi2(const uint64* _codes, uvec3* out_, uint _count)
+{
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = uvec3((uint32)_pext_u64(_codes[i], kMask3[0]), (uint32)_pext_u64(_codes[i], kMask3[1]), (uint32)_pext_u64(_codes[i], kMask3[2]));
+	}
+}
+
+#endif // APT_MORTON_BMI2
+
+} // namespace
+
+bool apt::MortonUseBmi2()
+{
+#if APT_MORTON_BMI2
+	static bool s_useBmi2 = DetectBmi2();
+	return s_useBmi2;
+#else
+	return false;
+#endif
+}
+
+void apt::MortonEncode2(const uvec2* _coords, uint64* out_, uint _count)
+{
+	APT_ASSERT(_coords && out_);
+#if APT_MORTON_BMI2
+	if (MortonUseBmi2()) {
+		Encode2Bmi2(_coords, out_, _count);
+		return;
+	}
+#endif
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = MortonEncode2<uint64>(_coords[i].x, _coords[i].y);
+	}
+}
+
+void apt::MortonEncode3(const uvec3* _coords, uint64* out_, uint _count)
+{
+	APT_ASSERT(_coords && out_);
+#if APT_MORTON_BMI2
+	if (MortonUseBmi2()) {
+		Encode3Bmi2(_coords, out_, _count);
+		return;
+	}
+#endif
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = MortonEncode3<uint64>(_coords[i].x, _coords[i].y, _coords[i].z);
+	}
+}
+
+void apt::MortonDecode2(const uint64* _codes, uvec2* out_, uint _count)
+{
+	APT_ASSERT(_codes && out_);
+#if APT_MORTON_BMI2
+	if (MortonUseBmi2()) {
+		Decode2Bmi2(_codes, out_, _count);
+		return;
+	}
+#endif
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = MortonDecode2<uint64>(_codes[i]);
+	}
+}
+
+void apt::MortonDecode3(const uint64* _codes, uvec3* out_, uint _count)
+{
+	APT_ASSERT(_codes && out_);
+#if APT_MORTON_BMI2
+	if (MortonUseBmi2()) {
+		Decode3Bmi2(_codes, out_, _count);
+		return;
+	}
+#endif
+	for (uint i = 0; i < _count; ++i) {
+		out_[i] = MortonDecode3<uint64>(_codes[i]);
+	}
+}
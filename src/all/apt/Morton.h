@@ -0,0 +1,170 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+
+#include <type_traits> // std::conditional
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// Morton
+// Morton (Z-order) codes, i.e. bit interleaving of 2d/3d coordinates:
+//
+//    MortonEncode2(x, y)    = ... y1 x1 y0 x0
+//    MortonEncode3(x, y, z) = ... z1 y1 x1 z0 y0 x0
+//
+// tCode is the code type (uint16, uint32, uint64); it determines the max
+// coordinate bits (bits/2 for 2d, bits/3 for 3d). Coordinate bits above this
+// are discarded. The scalar functions are constexpr and use 'magic bits'
+// (https://graphics.stanford.edu/~seander/bithacks.html#InterleaveBMN).
+//
+// The batch functions (which take arrays) use the BMI2 pdep/pext instructions
+// if the CPU supports them (and they are fast), selected at runtime, else the
+// magic bits.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace internal {
+
+	// Spread the low 16/32 bits of _x to the even bits.
+	constexpr uint32 MortonSpread2(uint32 _x)
+	{
+		_x &= 0x0000ffffu;
+		_x = (_x | (_x << 8)) & 0x00ff00ffu;
+		_x = (_x | (_x << 4)) & 0x0f0f0f0fu;
+		_x = (_x | (_x << 2)) & 0x33333333u;
+		_x = (_x | (_x << 1)) & 0x55555555u;
+		return _x;
+	}
+	constexpr uint64 MortonSpread2(uint64 _x)
+	{
+		_x &= 0x00000000ffffffffull;
+		_x = (_x | (_x << 16)) & 0x0000ffff0000ffffull;
+		_x = (_x | (_x << 8))  & 0x00ff00ff00ff00ffull;
+		_x = (_x | (_x << 4))  & 0x0f0f0f0f0f0f0f0full;
+		_x = (_x | (_x << 2))  & 0x3333333333333333ull;
+		_x = (_x | (_x << 1))  & 0x5555555555555555ull;
+		return _x;
+	}
+
+	// Inverse of MortonSpread2: gather the even bits of _x.
+	constexpr uint32 MortonCompact2(uint32 _x)
+	{
+		_x &= 0x55555555u;
+		_x = (_x ^ (_x >> 1)) & 0x33333333u;
+		_x = (_x ^ (_x >> 2)) & 0x0f0f0f0fu;
+		_x = (_x ^ (_x >> 4)) & 0x00ff00ffu;
+		_x = (_x ^ (_x >> 8)) & 0x0000ffffu;
+		return _x;
+	}
+	constexpr uint64 MortonCompact2(uint64 _x)
+	{
+		_x &= 0x5555555555555555ull;
+		_x = (_x ^ (_x >> 1))  & 0x3333333333333333ull;
+		_x = (_x ^ (_x >> 2))  & 0x0f0f0f0f0f0f0f0full;
+		_x = (_x ^ (_x >> 4))  & 0x00ff00ff00ff00ffull;
+		_x = (_x ^ (_x >> 8))  & 0x0000ffff0000ffffull;
+		_x = (_x ^ (_x >> 16)) & 0x00000000ffffffffull;
+		return _x;
+	}
+
+	// Spread the low 10/21 bits of _x to every 3rd bit.
+	constexpr uint32 MortonSpread3(uint32 _x)
+	{
+		_x &= 0x000003ffu;
+		_x = (_x | (_x << 16)) & 0x030000ffu;
+		_x = (_x | (_x << 8))  & 0x0300f00fu;
+		_x = (_x | (_x << 4))  & 0x030c30c3u;
+		_x = (_x | (_x << 2))  & 0x09249249u;
+		return _x;
+	}
+	constexpr uint64 MortonSpread3(uint64 _x)
+	{
+		_x &= 0x00000000001fffffull;
+		_x = (_x | (_x << 32)) & 0x001f00000000ffffull;
+		_x = (_x | (_x << 16)) & 0x001f0000ff0000ffull;
+		_x = (_x | (_x << 8))  & 0x100f00f00f00f00full;
+		_x = (_x | (_x << 4))  & 0x10c30c30c30c30c3ull;
+		_x = (_x | (_x << 2))  & 0x1249249249249249ull;
+		return _x;
+	}
+
+	// Inverse of MortonSpread3: gather every 3rd bit of _x.
+	constexpr uint32 MortonCompact3(uint32 _x)
+	{
+		_x &= 0x09249249u;
+		_x = (_x ^ (_x >> 2))  & 0x030c30c3u;
+		_x = (_x ^ (_x >> 4))  & 0x0300f00fu;
+		_x = (_x ^ (_x >> 8))  & 0x030000ffu;
+		_x = (_x ^ (_x >> 16)) & 0x000003ffu;
+		return _x;
+	}
+	constexpr uint64 MortonCompact3(uint64 _x)
+	{
+		_x &= 0x1249249249249249ull;
+		_x = (_x ^ (_x >> 2))  & 0x10c30c30c30c30c3ull;
+		_x = (_x ^ (_x >> 4))  & 0x100f00f00f00f00full;
+		_x = (_x ^ (_x >> 8))  & 0x001f0000ff0000ffull;
+		_x = (_x ^ (_x >> 16)) & 0x001f00000000ffffull;
+		_x = (_x ^ (_x >> 32)) & 0x00000000001fffffull;
+		return _x;
+	}
+
+	// 32 bit arithmetic for codes <= 32 bits, else 64 bit.
+	template <typename tCode>
+	using MortonWord = typename std::conditional<sizeof(tCode) <= 4, uint32, uint64>::type;
+
+} // namespace internal
+
+// Interleave the bits of _x, _y.
+template <typename tCode>
+constexpr tCode MortonEncode2(tCode _x, tCode _y)
+{
+	typedef internal::MortonWord<tCode> Word;
+	return (tCode)(internal::MortonSpread2((Word)_x) | (internal::MortonSpread2((Word)_y) << 1));
+}
+
+// Interleave the bits of _x, _y, _z.
+template <typename tCode>
+constexpr tCode MortonEncode3(tCode _x, tCode _y, tCode _z)
+{
+	typedef internal::MortonWord<tCode> Word;
+	return (tCode)(internal::MortonSpread3((Word)_x) | (internal::MortonSpread3((Word)_y) << 1) | (internal::MortonSpread3((Word)_z) << 2));
+}
+
+// Extract a single coordinate from a 2d code, i.e. MortonCompact2(_code) = x, MortonCompact2(_code >> 1) = y.
+template <typename tCode>
+constexpr tCode MortonCompact2(tCode _code)
+{
+	return (tCode)internal::MortonCompact2((internal::MortonWord<tCode>)_code);
+}
+
+// Extract a single coordinate from a 3d code, i.e. MortonCompact3(_code) = x, MortonCompact3(_code >> 1) = y, MortonCompact3(_code >> 2) = z.
+template <typename tCode>
+constexpr tCode MortonCompact3(tCode _code)
+{
+	return (tCode)internal::MortonCompact3((internal::MortonWord<tCode>)_code);
+}
+
+// Deinterleave _code.
+template <typename tCode>
+inline uvec2 MortonDecode2(tCode _code)
+{
+	return uvec2((uint32)MortonCompact2(_code), (uint32)MortonCompact2((tCode)(_code >> 1)));
+}
+template <typename tCode>
+inline uvec3 MortonDecode3(tCode _code)
+{
+	return uvec3((uint32)MortonCompact3(_code), (uint32)MortonCompact3((tCode)(_code >> 1)), (uint32)MortonCompact3((tCode)(_code >> 2)));
+}
+
+// Batch encode/decode _count 64 bit codes. 3d coordinates must be < 2^21.
+void MortonEncode2(const uvec2* _coords, uint64* out_, uint _count);
+void MortonEncode3(const uvec3* _coords, uint64* out_, uint _count);
+void MortonDecode2(const uint64* _codes, uvec2* out_, uint _count);
+void MortonDecode3(const uint64* _codes, uvec3* out_, uint _count);
+
+// Return true if the batch functions use BMI2.
+bool MortonUseBmi2();
+
+} // namespace apt
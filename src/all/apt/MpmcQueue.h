@@ -0,0 +1,189 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <atomic>
+#include <new>         // placement new
+#include <thread>      // std::this_thread::yield
+#include <utility>     // std::move, std::forward
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// MpmcQueue
+// Lock-free, bounded, multi-producer multi-consumer FIFO (after Dmitry Vyukov's
+// bounded MPMC queue). Any thread may push or pop. Usage:
+//
+//    MpmcQueue<Job*> queue(1024);
+//    // producers:
+//    queue.push(job);             // blocks while full
+//    if (!queue.tryPush(job)) {}  // non-blocking
+//    // consumers:
+//    Job* jobs[16];
+//    uint n = queue.tryPop(jobs, 16);
+//
+// Each cell carries a sequence number which encodes whether it is ready to be
+// written (seq == pos) or read (seq == pos + 1) for a given enqueue/dequeue
+// position; producers and consumers claim positions with a CAS on their
+// respective index and then synchronize only on the cell. The enqueue and
+// dequeue indices are on separate cache lines.
+//
+// The capacity is rounded up to a power of 2. The blocking functions spin
+// briefly before yielding the thread; they are intended for cases where the
+// queue is rarely full/empty for long.
+////////////////////////////////////////////////////////////////////////////////
+template <typename tType>
+class MpmcQueue: public aligned<MpmcQueue<tType>, APT_DCACHE_LINE_SIZE>, private non_copyable<MpmcQueue<tType> >
+{
+public:
+	MpmcQueue(uint _capacity)
+	{
+		APT_ASSERT(_capacity >= 2);
+		uint capacity = 2;
+		while (capacity < _capacity) {
+			capacity <<= 1;
+		}
+		m_mask = capacity - 1;
+		m_cells = (Cell*)APT_MALLOC_ALIGNED(sizeof(Cell) * capacity, alignof(Cell));
+		for (uint i = 0; i < capacity; ++i) {
+			new(&m_cells[i].m_seq) std::atomic<uint>(i);
+		}
+		m_enqueuePos.store(0, std::memory_order_relaxed);
+		m_dequeuePos.store(0, std::memory_order_relaxed);
+	}
+
+	// Remaining elements are destructed. Producers and consumers must not be active.
+	~MpmcQueue()
+	{
+		uint enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+		for (uint pos = m_dequeuePos.load(std::memory_order_relaxed); pos != enqueuePos; ++pos) {
+			((tType*)m_cells[pos & m_mask].m_value)->~tType();
+		}
+		APT_FREE_ALIGNED(m_cells);
+	}
+
+	// Return false if the queue is full. _v is only moved from on success.
+	bool tryPush(const tType& _v)             { return tryEmplace(_v); }
+	bool tryPush(tType&& _v)                  { return tryEmplace(std::move(_v)); }
+
+	// Block while the queue is full.
+	void push(const tType& _v)                { for (uint i = 0; !tryEmplace(_v); ++i) Backoff(i); }
+	void push(tType&& _v)                     { for (uint i = 0; !tryEmplace(std::move(_v)); ++i) Backoff(i); }
+
+	// Return false if the queue is empty, else move the front element to out_.
+	bool tryPop(tType& out_)                  { return tryPop(&out_, 1) == 1; }
+
+	// Pop up to _count elements into out_, return the number of elements popped. Consecutive ready elements are claimed with a single
+	// CAS.
+	uint tryPop(tType* out_, uint _count);
+
+	// Block while the queue is empty.
+	void pop(tType& out_)                     { for (uint i = 0; !tryPop(out_); ++i) Backoff(i); }
+
+	// Block until at least 1 element is available, pop up to _count elements into out_. Return the number of elements popped.
+	uint pop(tType* out_, uint _count)
+	{
+		uint ret;
+		for (uint i = 0; (ret = tryPop(out_, _count)) == 0; ++i) {
+			Backoff(i);
+		}
+		return ret;
+	}
+
+	// Approximate if called while producers or consumers are active.
+	uint size() const
+	{
+		uint enqueuePos = m_enqueuePos.load(std::memory_order_acquire);
+		uint dequeuePos = m_dequeuePos.load(std::memory_order_acquire);
+		return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+	}
+	bool empty() const                        { return size() == 0; }
+	uint capacity() const                     { return m_mask + 1; }
+
+private:
+	struct Cell
+	{
+		std::atomic<uint> m_seq;
+		storage<tType>    m_value;
+	};
+
+	alignas(APT_DCACHE_LINE_SIZE) Cell* m_cells;
+	uint                          m_mask;
+	alignas(APT_DCACHE_LINE_SIZE) std::atomic<uint> m_enqueuePos;
+	alignas(APT_DCACHE_LINE_SIZE) std::atomic<uint> m_dequeuePos;
+
+	template <typename tValue>
+	bool tryEmplace(tValue&& _v);
+
+	static void Backoff(uint _iteration)
+	{
+		if (_iteration >= 64) {
+			std::this_thread::yield();
+		}
+	}
+};
+
+template <typename tType>
+template <typename tValue>
+inline bool MpmcQueue<tType>::tryEmplace(tValue&& _v)
+{
+	uint pos = m_enqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		Cell& cell = m_cells[pos & m_mask];
+		uint seq = cell.m_seq.load(std::memory_order_acquire);
+		sint diff = (sint)seq - (sint)pos;
+		if (diff == 0) {
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				new((tType*)cell.m_value) tType(std::forward<tValue>(_v));
+				cell.m_seq.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false; // full
+		} else {
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template <typename tType>
+inline uint MpmcQueue<tType>::tryPop(tType* out_, uint _count)
+{
+	if (_count == 0) {
+		return 0;
+	}
+	uint pos = m_dequeuePos.load(std::memory_order_relaxed);
+	for (;;) {
+	 // count the consecutive cells which are ready to be read
+		uint n = 0;
+		sint diff = 0;
+		for (; n < _count; ++n) {
+			uint seq = m_cells[(pos + n) & m_mask].m_seq.load(std::memory_order_acquire);
+			diff = (sint)seq - (sint)(pos + n + 1);
+			if (diff != 0) {
+				break;
+			}
+		}
+		if (n == 0) {
+			if (diff < 0) {
+				return 0; // empty
+			}
+			pos = m_dequeuePos.load(std::memory_order_relaxed); // another consumer claimed pos
+			continue;
+		}
+		if (m_dequeuePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+			for (uint i = 0; i < n; ++i) {
+				Cell& cell = m_cells[(pos + i) & m_mask];
+				tType* v = (tType*)cell.m_value;
+				out_[i] = std::move(*v);
+				v->~tType();
+				cell.m_seq.store(pos + i + m_mask + 1, std::memory_order_release);
+			}
+			return n;
+		}
+	}
+}
+
+} // namespace apt
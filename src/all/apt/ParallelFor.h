@@ -0,0 +1,115 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+
+#include <EASTL/fixed_vector.h>
+
+#include <atomic>
+#include <thread>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// ParallelFor
+// Call _fn(i) for each i in [0, _count) across up to _threadCount threads
+// (including the calling thread, 0 = std::thread::hardware_concurrency()).
+// Return when all calls have completed.
+//
+//    ParallelFor(items.size(), [&](uint _i) { process(items[_i]); });
+//
+// [0, _count) is split into contiguous ranges, 1 per thread. A thread takes
+// indices from the front of its own range; when its range is empty it steals
+// indices from the back of the other threads' ranges, hence uneven per-index
+// costs are balanced. Each range is a single atomic (begin, end) pair updated
+// via CAS.
+//
+// Worker threads are created per call; use for coarse-grained work (e.g. a
+// per-frame pass over a large data set), not for many small loops.
+////////////////////////////////////////////////////////////////////////////////
+template <typename tFunc>
+void ParallelFor(uint _count, tFunc&& _fn, uint _threadCount = 0);
+
+
+namespace internal {
+
+class ParallelForRange
+{
+public:
+	void init(uint32 _begin, uint32 _end)         { m_range.store(Pack(_begin, _end), std::memory_order_relaxed); }
+
+	// Take an index from the front (owner) or back (thief) of the range. Return false if the range is empty.
+	bool popFront(uint32& out_)                   { return pop(out_, true); }
+	bool popBack(uint32& out_)                    { return pop(out_, false); }
+
+private:
+	alignas(APT_DCACHE_LINE_SIZE) std::atomic<uint64> m_range;
+
+	static uint64 Pack(uint32 _begin, uint32 _end) { return ((uint64)_end << 32) | _begin; }
+
+	bool pop(uint32& out_, bool _front)
+	{
+		uint64 range = m_range.load(std::memory_order_relaxed);
+		for (;;) {
+			uint32 begin = (uint32)range;
+			uint32 end   = (uint32)(range >> 32);
+			if (begin >= end) {
+				return false;
+			}
+			uint64 next = _front ? Pack(begin + 1, end) : Pack(begin, end - 1);
+			if (m_range.compare_exchange_weak(range, next, std::memory_order_relaxed)) {
+				out_ = _front ? begin : end - 1;
+				return true;
+			}
+		}
+	}
+};
+
+} // namespace internal
+
+template <typename tFunc>
+inline void ParallelFor(uint _count, tFunc&& _fn, uint _threadCount)
+{
+	APT_ASSERT(_count <= ~uint32(0));
+	if (_threadCount == 0) {
+		_threadCount = APT_MAX(std::thread::hardware_concurrency(), 1u);
+	}
+	_threadCount = (uint)APT_MIN((uint)_threadCount, _count);
+	if (_threadCount <= 1) {
+		for (uint i = 0; i < _count; ++i) {
+			_fn(i);
+		}
+		return;
+	}
+
+	const uint kMaxThreads = 64;
+	_threadCount = APT_MIN(_threadCount, kMaxThreads);
+	internal::ParallelForRange ranges[kMaxThreads];
+	for (uint i = 0; i < _threadCount; ++i) {
+		ranges[i].init((uint32)(_count * i / _threadCount), (uint32)(_count * (i + 1) / _threadCount));
+	}
+
+	auto worker = [&](uint _threadIndex) {
+			uint32 i;
+			while (ranges[_threadIndex].popFront(i)) {
+				_fn((uint)i);
+			}
+			for (uint k = 1; k < _threadCount; ++k) {
+				internal::ParallelForRange& victim = ranges[(_threadIndex + k) % _threadCount];
+				while (victim.popBack(i)) {
+					_fn((uint)i);
+				}
+			}
+		};
+
+	eastl::fixed_vector<std::thread, kMaxThreads, false> threads;
+	for (uint i = 1; i < _threadCount; ++i) {
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+} // namespace apt
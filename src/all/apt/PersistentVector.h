@@ -1,9 +1,13 @@
 #pragma once
 
 #include <apt/apt.h>
+#include <apt/math.h>
 #include <apt/memory.h>
 
+#include <EASTL/allocator.h>
+
 #include <algorithm>   // std::copy
+#include <memory>      // std::uninitialized_copy
 #include <new>         // placement new
 #include <type_traits> // std::conditional
 #include <utility>     // std::move
@@ -19,48 +23,56 @@ namespace apt {
 /// operations which can be performed: the container is non-movable, elements 
 /// may only be added/removed at the back of the container.
 /// \note Iterating over elements in the container by index is significantly
-///    slower than using iterators in optimized builds.
+///    slower than using iterators in optimized builds, unless kBlockSize is
+///    specified. The fastest way to iterate is forEachChunk(), which visits
+///    each block as a contiguous array.
+/// \param kBlockSize If non-zero, the block size is a compile time constant
+///    (must be a power of 2) so that index access is a shift and a mask. If
+///    0 the block size is specified at construction.
 /// \todo Move some of the larger private functions to a .cpp (use a privately
 ///    inherited base class).
 ////////////////////////////////////////////////////////////////////////////////
-template <typename tType>
+template <typename tType, typename tAllocator, uint kBlockSize>
 class PersistentVector
 {
 public:
-	static const uint kDefaultBlockSize = 64;
+	static const uint kDefaultBlockSize = kBlockSize ? kBlockSize : 64;
 
-	typedef tType value_type;
-	typedef uint  size_type;
+	typedef tType      value_type;
+	typedef uint       size_type;
+	typedef tAllocator allocator_type;
 	
 	template<bool is_const> class iterator_base;
 	typedef iterator_base<false>  iterator;
 	typedef iterator_base<true>   const_iterator;
 
 	/// \param blockSize The number of elements by which the container will
-	///    grow when push_back is called and the container is full.
-	PersistentVector(uint _blockSize = kDefaultBlockSize);
+	///    grow when push_back is called and the container is full. Must be
+	///    kBlockSize if kBlockSize is non-zero.
+	/// \param allocator EASTL allocator used for the block storage (see Allocator.h).
+	PersistentVector(uint _blockSize = kDefaultBlockSize, const tAllocator& _allocator = tAllocator());
 
 	/// Initialize n elements by copy constructing from v.
 	/// \param n Number of elements to initialize from v.
 	/// \param v Value from which to copy construct elements.
 	/// \param blockSize The number of elements by which the container will
 	///   grow when push_back is called and the container is full.
-	PersistentVector(uint _n, const tType& _v, uint _blockSize = kDefaultBlockSize);
+	PersistentVector(uint _n, const tType& _v, uint _blockSize = kDefaultBlockSize, const tAllocator& _allocator = tAllocator());
 
 	/// Initialize from elements in [first,last) (last is excluded).
 	/// \param blockSize The number of elements by which the container will
 	///   grow when push_back is called and the container is full.
 	template <typename tIterator>
-	PersistentVector(tIterator _first, tIterator _last, uint _blockSize = kDefaultBlockSize);
+	PersistentVector(tIterator _first, tIterator _last, uint _blockSize = kDefaultBlockSize, const tAllocator& _allocator = tAllocator());
 
 	/// Copy ctor. Elements are copy-constructed from _rhs.
-	explicit PersistentVector(const PersistentVector<tType>& _rhs);
+	explicit PersistentVector(const PersistentVector<tType, tAllocator, kBlockSize>& _rhs);
 
 	/// Move copy/assign, swap.
-	PersistentVector(PersistentVector<tType>&& _rhs);
-	PersistentVector<tType>& operator=(PersistentVector<tType>&& _rhs);
-	template <typename tType>
-	friend void swap(PersistentVector<tType>& _a, PersistentVector<tType>& _b);
+	PersistentVector(PersistentVector<tType, tAllocator, kBlockSize>&& _rhs);
+	PersistentVector<tType, tAllocator, kBlockSize>& operator=(PersistentVector<tType, tAllocator, kBlockSize>&& _rhs);
+	template <typename tType_, typename tAllocator_, uint kBlockSize_>
+	friend void swap(PersistentVector<tType_, tAllocator_, kBlockSize_>& _a, PersistentVector<tType_, tAllocator_, kBlockSize_>& _b);
 
 	/// Empty the container (elements are destructed).
 	~PersistentVector();
@@ -93,7 +105,8 @@ public:
 
 
 	uint           size() const              { return m_size; }
-	uint           capacity() const          { return m_blockCount * m_blockSize; }
+	uint           capacity() const          { return m_blockCount * getBlockSize(); }
+	uint           getBlockSize() const      { return kBlockSize ? kBlockSize : m_blockSize; }
 	
 	bool           empty() const             { return m_size == 0; }
 	bool           full() const              { return m_size == capacity(); }
@@ -113,14 +126,25 @@ public:
 	tType&         operator[](uint _i)       { return getElement(_i); }
 	const tType&   operator[](uint _i) const { return getElement(_i); }
 
+	const tAllocator& get_allocator() const  { return m_allocator; }
+
+	/// Call _func(tType* _data, uint _count) for each block, in order. Each
+	/// block is a contiguous array of _count elements; all blocks except the
+	/// last contain getBlockSize() elements.
+	template <typename tFunc>
+	void forEachChunk(tFunc&& _func);
+	template <typename tFunc>
+	void forEachChunk(tFunc&& _func) const;
+
 private:
 
-	tType** m_blocks;
-	uint    m_blockCount; ///< Number of allocated blocks
-	uint    m_blockSize;  ///< Elements per block
-	uint    m_size;       ///< Number of stored elements
-	uint    m_back;       ///< Index of back block
-	uint    m_backSize;   ///< Size of back block
+	tAllocator m_allocator;
+	tType**    m_blocks;
+	uint       m_blockCount; ///< Number of allocated blocks
+	uint       m_blockSize;  ///< Elements per block
+	uint       m_size;       ///< Number of stored elements
+	uint       m_back;       ///< Index of back block
+	uint       m_backSize;   ///< Size of back block
 
 
 	/// \return reference to the ith element;
@@ -144,15 +168,17 @@ private:
 
 //	PUBLIC
 
-template <typename tType>
-inline PersistentVector<tType>::PersistentVector(uint _blockSize)
-	: m_blocks(0)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline PersistentVector<tType, tAllocator, kBlockSize>::PersistentVector(uint _blockSize, const tAllocator& _allocator)
+	: m_allocator(_allocator)
+	, m_blocks(0)
 	, m_blockCount(0)
 	, m_size(0)
 	, m_blockSize(_blockSize)
 	, m_back(0)
 	, m_backSize(0)
 {
+	APT_ASSERT(kBlockSize == 0 || _blockSize == kBlockSize);
 	// Can avoid allocBlock() here if you set m_backsSize = m_blockSize (so that
 	// the first allocation happens during the first call to push_back). HOWEVER 
 	// this requires end() to be more complex as it must explicitly detect an 
@@ -160,15 +186,17 @@ inline PersistentVector<tType>::PersistentVector(uint _blockSize)
 	allocBlock();
 }
 
-template <typename tType>
-inline PersistentVector<tType>::PersistentVector(uint _n, const tType& _v, uint _blockSize)
-	: m_blocks(0)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline PersistentVector<tType, tAllocator, kBlockSize>::PersistentVector(uint _n, const tType& _v, uint _blockSize, const tAllocator& _allocator)
+	: m_allocator(_allocator)
+	, m_blocks(0)
 	, m_blockCount(0)
 	, m_size(0)
 	, m_blockSize(_blockSize)
 	, m_back(0)
 	, m_backSize(0)
 {
+	APT_ASSERT(kBlockSize == 0 || _blockSize == kBlockSize);
 	reserve(_n);
 	while (_n) {
 		push_back(_v);
@@ -176,16 +204,18 @@ inline PersistentVector<tType>::PersistentVector(uint _n, const tType& _v, uint
 	}
 }
 
-template <typename tType>
+template <typename tType, typename tAllocator, uint kBlockSize>
 template <typename tIterator>
-inline PersistentVector<tType>::PersistentVector(tIterator _first, tIterator _last, uint _blockSize)
-	: m_blocks(0)
+inline PersistentVector<tType, tAllocator, kBlockSize>::PersistentVector(tIterator _first, tIterator _last, uint _blockSize, const tAllocator& _allocator)
+	: m_allocator(_allocator)
+	, m_blocks(0)
 	, m_blockCount(0)
 	, m_size(0)
 	, m_blockSize(_blockSize)
 	, m_back(0)
 	, m_backSize(0)
 {
+	APT_ASSERT(kBlockSize == 0 || _blockSize == kBlockSize);
 	APT_ASSERT(_last > _first);
 	reserve(_last - _first);
 	while (_first != _last) {
@@ -194,23 +224,25 @@ inline PersistentVector<tType>::PersistentVector(tIterator _first, tIterator _la
 	}
 }
 
-template <typename tType>
-inline PersistentVector<tType>::PersistentVector(const PersistentVector<tType>& _rhs)
-	: m_blockCount(_rhs.m_blockCount)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline PersistentVector<tType, tAllocator, kBlockSize>::PersistentVector(const PersistentVector<tType, tAllocator, kBlockSize>& _rhs)
+	: m_allocator(_rhs.m_allocator)
+	, m_blockCount(_rhs.m_blockCount)
 	, m_blockSize(_rhs.m_blockSize)
 	, m_size(_rhs.m_size)
 	, m_back(_rhs.m_back)
 	, m_backSize(_rhs.m_backSize)
 {
-	m_blocks = new tType*[m_blockCount];
+	m_blocks = (tType**)m_allocator.allocate(sizeof(tType*) * m_blockCount);
 	for (uint i = 0; i < m_blockCount; ++i) {
-		m_blocks[i] = (tType*)apt::malloc_aligned(sizeof(tType) * m_blockSize, APT_ALIGNOF(tType));
-		std::copy(_rhs.m_blocks[i], _rhs.m_blocks[i] + m_blockSize, m_blocks[i]);
+		m_blocks[i] = (tType*)eastl::allocate_memory(m_allocator, sizeof(tType) * getBlockSize(), alignof(tType), 0);
+		uint n = i * getBlockSize() < m_size ? APT_MIN(getBlockSize(), m_size - i * getBlockSize()) : 0;
+		std::uninitialized_copy(_rhs.m_blocks[i], _rhs.m_blocks[i] + n, m_blocks[i]);
 	}
 }
 
-template <typename tType>
-inline PersistentVector<tType>::PersistentVector(PersistentVector<tType>&& _rhs)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline PersistentVector<tType, tAllocator, kBlockSize>::PersistentVector(PersistentVector<tType, tAllocator, kBlockSize>&& _rhs)
 	: m_blocks(0)
 	, m_blockCount(0)
 	, m_size(0)
@@ -220,16 +252,17 @@ inline PersistentVector<tType>::PersistentVector(PersistentVector<tType>&& _rhs)
 {
 	swap(*this, _rhs);
 }
-template <typename tType>
-inline PersistentVector<tType>& PersistentVector<tType>::operator=(PersistentVector<tType>&& _rhs)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline PersistentVector<tType, tAllocator, kBlockSize>& PersistentVector<tType, tAllocator, kBlockSize>::operator=(PersistentVector<tType, tAllocator, kBlockSize>&& _rhs)
 {
 	swap(*this, _rhs);
 	return *this;
 }
-template <typename tType>
-inline void swap(PersistentVector<tType>& _a, PersistentVector<tType>& _b)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void swap(PersistentVector<tType, tAllocator, kBlockSize>& _a, PersistentVector<tType, tAllocator, kBlockSize>& _b)
 {
 	using std::swap;
+	swap(_a.m_allocator, _b.m_allocator);
 	swap(_a.m_blocks, _b.m_blocks);
 	swap(_a.m_blockCount, _b.m_blockCount);
 	swap(_a.m_size, _b.m_size);
@@ -238,18 +271,20 @@ inline void swap(PersistentVector<tType>& _a, PersistentVector<tType>& _b)
 	swap(_a.m_backSize, _b.m_backSize);
 }
 
-template <typename tType>
-inline PersistentVector<tType>::~PersistentVector()
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline PersistentVector<tType, tAllocator, kBlockSize>::~PersistentVector()
 {
 	clear(); // call dtors on elements
 	for (uint i = 0; i < m_blockCount; ++i) {
-		apt::free_aligned(m_blocks[i]);
+		m_allocator.deallocate(m_blocks[i], sizeof(tType) * getBlockSize());
+	}
+	if (m_blocks) {
+		m_allocator.deallocate(m_blocks, sizeof(tType*) * m_blockCount);
 	}
-	delete[] m_blocks;
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::push_back(const tType& _v)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::push_back(const tType& _v)
 {
 	allocElement();
 	new(&m_blocks[m_back][m_backSize]) tType(_v);
@@ -257,8 +292,8 @@ inline void PersistentVector<tType>::push_back(const tType& _v)
 	++m_size;
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::push_back(tType&& _v)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::push_back(tType&& _v)
 {
 	allocElement();
 	new(&m_blocks[m_back][m_backSize]) tType(std::move(_v));
@@ -266,8 +301,8 @@ inline void PersistentVector<tType>::push_back(tType&& _v)
 	++m_size;
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::pop_back()
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::pop_back()
 {
 	APT_ASSERT(m_size != 0);
 	if (m_size == 0) {
@@ -280,37 +315,29 @@ inline void PersistentVector<tType>::pop_back()
 	if (m_backSize == 0 && m_back != 0) {
 		--m_back;
 		if (m_backSize == 0) {
-			m_backSize = m_blockSize;
+			m_backSize = getBlockSize();
 		}
 	}
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::clear()
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::clear()
 {
 	if (m_size == 0) {
 		return;
 	}
-#ifndef APT_DEBUG
- // in release, the operator[] can be very well optimized
-	for (uint i = 0; i < m_size; ++i) {
-		(*this)[i].~tType();
-	}
-#else
- // in debug, using a double loop is faster
-	for (uint i = 0, j = 0; i < m_blockCount; ++i) {
-		for (uint k = 0; k < m_blockSize && j < m_size; ++k, ++j) {
-			m_blocks[i][k].~tType();
+	forEachChunk([](tType* _data, uint _count) {
+		for (uint i = 0; i < _count; ++i) {
+			_data[i].~tType();
 		}
-	}
-#endif
+	});
 	m_size     = 0;
 	m_back     = 0;
 	m_backSize = 0;
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::resize(uint _n)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::resize(uint _n)
 {
 	uint s = size();
 	for (uint i = s; i < _n; ++i) {
@@ -321,8 +348,8 @@ inline void PersistentVector<tType>::resize(uint _n)
 	}
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::resize(uint _n, const tType& _v)
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::resize(uint _n, const tType& _v)
 {
 	uint s = size();
 	for (uint i = s; i < _n; ++i) {
@@ -333,20 +360,46 @@ inline void PersistentVector<tType>::resize(uint _n, const tType& _v)
 	}
 }
 
+template <typename tType, typename tAllocator, uint kBlockSize>
+template <typename tFunc>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::forEachChunk(tFunc&& _func)
+{
+	if (m_size == 0) {
+		return;
+	}
+	for (uint i = 0; i < m_back; ++i) {
+		_func(m_blocks[i], getBlockSize());
+	}
+	_func(m_blocks[m_back], m_backSize);
+}
+
+template <typename tType, typename tAllocator, uint kBlockSize>
+template <typename tFunc>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::forEachChunk(tFunc&& _func) const
+{
+	if (m_size == 0) {
+		return;
+	}
+	for (uint i = 0; i < m_back; ++i) {
+		_func((const tType*)m_blocks[i], getBlockSize());
+	}
+	_func((const tType*)m_blocks[m_back], m_backSize);
+}
+
 
 //	PRIVATE
 
-template <typename tType>
-inline tType& PersistentVector<tType>::getElement(uint _i) const
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline tType& PersistentVector<tType, tAllocator, kBlockSize>::getElement(uint _i) const
 {
 	APT_ASSERT(_i < size());
-	return m_blocks[_i / m_blockSize][_i % m_blockSize];
+	return m_blocks[_i / getBlockSize()][_i % getBlockSize()];
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::allocElement()
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::allocElement()
 {
-	if (m_backSize == m_blockSize) {
+	if (m_backSize == getBlockSize()) {
 		if (m_blockCount != 0) {
 			++m_back;
 		}
@@ -357,17 +410,19 @@ inline void PersistentVector<tType>::allocElement()
 	}
 }
 
-template <typename tType>
-inline void PersistentVector<tType>::allocBlock()
+template <typename tType, typename tAllocator, uint kBlockSize>
+inline void PersistentVector<tType, tAllocator, kBlockSize>::allocBlock()
 {
-	tType** tmp = new tType*[m_blockCount + 1];
+	APT_STATIC_ASSERT((kBlockSize & (kBlockSize - 1)) == 0); // kBlockSize must be a power of 2
+
+	tType** tmp = (tType**)m_allocator.allocate(sizeof(tType*) * (m_blockCount + 1));
 	if (m_blocks) {
 		std::copy(m_blocks, m_blocks + m_blockCount, tmp);
-		delete[] m_blocks;
+		m_allocator.deallocate(m_blocks, sizeof(tType*) * m_blockCount);
 	}
 	m_blocks = tmp;
 	
-	m_blocks[m_blockCount] = (tType*)apt::malloc_aligned(sizeof(tType) * m_blockSize, APT_ALIGNOF(tType));
+	m_blocks[m_blockCount] = (tType*)eastl::allocate_memory(m_allocator, sizeof(tType) * getBlockSize(), alignof(tType), 0);
 	++m_blockCount;
 }
 
@@ -378,11 +433,11 @@ inline void PersistentVector<tType>::allocBlock()
 
 *******************************************************************************/
 
-template <typename tType>
+template <typename tType, typename tAllocator, uint kBlockSize>
 template <bool is_const>
-class PersistentVector<tType>::iterator_base
+class PersistentVector<tType, tAllocator, kBlockSize>::iterator_base
 {
-	friend class PersistentVector<tType>;
+	friend class PersistentVector<tType, tAllocator, kBlockSize>;
 public:
 	typedef typename std::conditional<is_const, const tType, tType>::type value_type;
 	typedef sint         difference_type;
@@ -401,16 +456,16 @@ public:
 	{
 		if (_rhs >= 0) {
 			m_offset += (uint)_rhs;
-			m_block  += m_offset / m_parent->m_blockSize;
-			m_offset  = m_offset % m_parent->m_blockSize;
+			m_block  += m_offset / m_parent->getBlockSize();
+			m_offset  = m_offset % m_parent->getBlockSize();
 		} else {
-			m_block -= (uint)-_rhs / m_parent->m_blockSize;
-			uint off = (uint)-_rhs % m_parent->m_blockSize;
+			m_block -= (uint)-_rhs / m_parent->getBlockSize();
+			uint off = (uint)-_rhs % m_parent->getBlockSize();
 			if (m_offset || !off) {
 				m_offset -= off;
 			} else {
 				--m_block;
-				m_offset = m_parent->m_blockSize - off;
+				m_offset = m_parent->getBlockSize() - off;
 			}
 		}
 		return *this;
@@ -435,7 +490,7 @@ public:
 
 	sint operator-(iterator_base _rhs)
 	{
-		sint ret = ((sint)m_block - (sint)_rhs.m_block) * (sint)m_parent->m_blockSize;
+		sint ret = ((sint)m_block - (sint)_rhs.m_block) * (sint)m_parent->getBlockSize();
 		ret += (sint)m_offset - (sint)_rhs.m_offset;
 		return ret;
 	}
@@ -444,7 +499,7 @@ public:
 	{
 		APT_ASSERT(*this != m_parent->end()); // can't increment the end iterator
 		++m_offset;
-		if (m_offset == m_parent->m_blockSize) {
+		if (m_offset == m_parent->getBlockSize()) {
 			++m_block;
 			m_offset = 0;
 		}
@@ -462,7 +517,7 @@ public:
 		APT_ASSERT(*this != m_parent->begin()); // can't decrement the begin iterator
 		if (m_offset == 0) {
 			--m_block;
-			m_offset = m_parent->m_blockSize;
+			m_offset = m_parent->getBlockSize();
 		}
 		--m_offset;
 		return *this;
@@ -499,7 +554,7 @@ public:
 
 	value_type& operator*() const 
 	{
-		APT_ASSERT(m_block < m_parent->m_blockCount && m_offset < m_parent->m_blockSize);
+		APT_ASSERT(m_block < m_parent->m_blockCount && m_offset < m_parent->getBlockSize());
 		return m_parent->m_blocks[m_block][m_offset]; 
 	}
 
@@ -509,8 +564,8 @@ public:
 	}
 
 private:
-	typedef PersistentVector<tType> PersistentVector;
-	typedef typename std::conditional<is_const, const PersistentVector, PersistentVector>::type parent_type;
+	typedef PersistentVector<tType, tAllocator, kBlockSize> Parent;
+	typedef typename std::conditional<is_const, const Parent, Parent>::type parent_type;
 	parent_type* m_parent; // access to constraints
 
 	uint m_block;          // index to current block
@@ -521,7 +576,7 @@ private:
 		, m_block(_block)
 		, m_offset(_offset)
 	{
-		if (m_offset == m_parent->m_blockSize) {
+		if (m_offset == m_parent->getBlockSize()) {
 			++m_block;
 			m_offset = 0;
 		}
@@ -2,48 +2,63 @@
 
 #include <apt/MemoryPool.h>
 
-#include <utility> // std::move
+#include <utility> // std::move, std::forward
 
 namespace apt {
 
 ////////////////////////////////////////////////////////////////////////////////
 // Pool
 // Templated MemoryPool.
+// tMemoryPool is the underlying pool implementation, e.g. use 
+// ThreadCachedMemoryPool for a thread safe pool:
+//
+//    Pool<Foo, ThreadCachedMemoryPool> pool(128);
+//
+// The default (MemoryPool) is not thread safe. alloc() returns nullptr if
+// tMemoryPool::alloc() does (e.g. ConcurrentMemoryPool when exhausted).
 ////////////////////////////////////////////////////////////////////////////////
-template <typename tType>
-class Pool: public MemoryPool
+template <typename tType, typename tMemoryPool>
+class Pool: public tMemoryPool
 {
 public:
-	Pool(uint _blockSize)
-		: MemoryPool(sizeof(tType), alignof(tType), _blockSize)
+	// Any additional arguments are forwarded to the tMemoryPool ctor.
+	template <typename... tArgs>
+	Pool(uint _blockSize, tArgs&&... _args)
+		: tMemoryPool(sizeof(tType), alignof(tType), _blockSize, std::forward<tArgs>(_args)...)
 	{
 	}
 
 	tType* alloc()
 	{
-		tType* ret = (tType*)MemoryPool::alloc();
-		new(ret) tType();
+		tType* ret = (tType*)tMemoryPool::alloc();
+		if_likely (ret) {
+			new(ret) tType();
+		}
 		return ret;
 	}
 
 	tType* alloc(const tType& _v)
 	{
-		tType* ret = (tType*)MemoryPool::alloc();
-		new(ret) tType(_v);
+		tType* ret = (tType*)tMemoryPool::alloc();
+		if_likely (ret) {
+			new(ret) tType(_v);
+		}
 		return ret;
 	}
 
 	tType* alloc(tType&& _v)
 	{
-		tType* ret = (tType*)MemoryPool::alloc();
-		new(ret) tType(std::move(_v));
+		tType* ret = (tType*)tMemoryPool::alloc();
+		if_likely (ret) {
+			new(ret) tType(std::move(_v));
+		}
 		return ret;
 	}
 
 	void free(tType* _object)
 	{
 		_object->~tType();
-		MemoryPool::free(_object);
+		tMemoryPool::free(_object);
 	}
 
 }; // class Pool
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <EASTL/allocator.h>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// ProxyAllocator
+// EASTL-compatible type-erased reference to another allocator (e.g. one of
+// those in Allocator.h). A default constructed ProxyAllocator allocates from
+// the heap via APT_MALLOC_ALIGNED.
+////////////////////////////////////////////////////////////////////////////////
+class ProxyAllocator
+{
+public:
+	ProxyAllocator(const char* _name = "ProxyAllocator")
+		: m_allocator(nullptr)
+		, m_allocate(&DefaultAllocate)
+		, m_deallocate(&DefaultDeallocate)
+		, m_name(_name)
+	{
+	}
+
+	// _allocator must outlive the ProxyAllocator and any copies.
+	template <typename tAllocator>
+	ProxyAllocator(tAllocator* _allocator, const char* _name = "ProxyAllocator")
+		: m_allocator(_allocator)
+		, m_allocate(&Allocate<tAllocator>)
+		, m_deallocate(&Deallocate<tAllocator>)
+		, m_name(_name)
+	{
+		APT_ASSERT(_allocator);
+	}
+
+	ProxyAllocator(const ProxyAllocator& _rhs)                                          = default;
+	ProxyAllocator(const ProxyAllocator& _rhs, const char* _name)                       : ProxyAllocator(_rhs) { m_name = _name; }
+
+	ProxyAllocator& operator=(const ProxyAllocator& _rhs)
+	{
+		m_allocator  = _rhs.m_allocator;
+		m_allocate   = _rhs.m_allocate;
+		m_deallocate = _rhs.m_deallocate;
+		return *this;
+	}
+
+	void* allocate(size_t _n, int = 0)                                                 { return m_allocate(m_allocator, _n, EASTL_ALLOCATOR_MIN_ALIGNMENT); }
+	void* allocate(size_t _n, size_t _alignment, size_t _offset, int = 0)              { APT_ASSERT(_offset == 0); return m_allocate(m_allocator, _n, _alignment); }
+	void  deallocate(void* _p, size_t _n)                                              { m_deallocate(m_allocator, _p, _n); }
+
+	const char* get_name() const                                                       { return m_name; }
+	void        set_name(const char* _name)                                            { m_name = _name; }
+
+	friend bool operator==(const ProxyAllocator& _a, const ProxyAllocator& _b)          { return _a.m_allocator == _b.m_allocator && _a.m_allocate == _b.m_allocate; }
+	friend bool operator!=(const ProxyAllocator& _a, const ProxyAllocator& _b)          { return !(_a == _b); }
+
+private:
+	typedef void* (AllocateFunc)(void* _allocator, size_t _n, size_t _alignment);
+	typedef void  (DeallocateFunc)(void* _allocator, void* _p, size_t _n);
+
+	void*           m_allocator;
+	AllocateFunc*   m_allocate;
+	DeallocateFunc* m_deallocate;
+	const char*     m_name;
+
+	static void* DefaultAllocate(void*, size_t _n, size_t _alignment)                  { return APT_MALLOC_ALIGNED(_n, APT_MAX(_alignment, (size_t)EASTL_ALLOCATOR_MIN_ALIGNMENT)); }
+	static void  DefaultDeallocate(void*, void* _p, size_t)                            { APT_FREE_ALIGNED(_p); }
+
+	template <typename tAllocator>
+	static void* Allocate(void* _allocator, size_t _n, size_t _alignment)              { return ((tAllocator*)_allocator)->allocate(_n, _alignment, 0); }
+	template <typename tAllocator>
+	static void  Deallocate(void* _allocator, void* _p, size_t _n)                     { ((tAllocator*)_allocator)->deallocate(_p, _n); }
+};
+
+} // namespace apt
@@ -4,8 +4,13 @@
 #include <apt/memory.h>
 #include <apt/types.h>
 #include <apt/math.h>
+#include <apt/Morton.h>
+#include <apt/ParallelFor.h>
+#include <apt/SpatialQuery.h>
 
+#include <EASTL/algorithm.h>
 #include <EASTL/fixed_vector.h>
+#include <EASTL/sort.h>
 #include <EASTL/vector.h>
 
 namespace apt {
@@ -15,13 +20,16 @@ namespace apt {
 // Generic linear quadtree.
 //
 // tIndex is the type used for indexing nodes and determines the absolute max
-// level of subdivision possible. This should be a uint* type (uint8, uint16, 
+// level of subdivision possible. This should be a uint* type (uint8, uint16,
 // uint32, uint64).
 //
 // tNode is the node type. Typically this will be a pointer or index into a
 // separate node data pool. Use the _init arg of the ctor to init the quadtree
 // with 'invalid' nodes.
 //
+// tAllocator is the EASTL allocator used for the node storage (see
+// Allocator.h), the default is eastl::allocator.
+//
 // Internally each level is stored sequentially with the root level at index 0.
 // Within each level, nodes are laid out in Morton order:
 //  +---+---+
@@ -29,45 +37,53 @@ namespace apt {
 //  +---+---+
 //  | 1 | 3 |
 //  +---+---+
-// Use linearize()/delinearize() functions to convert to/from a linear layout
-// e.g. for conversion to a texture.
+// Use linearize()/delinearize() functions to convert to/from a linear (row-
+// major, x fastest) layout e.g. for conversion to a texture.
+//
+// Quadtree<tIndex, bool> is specialized as a bitmap (1 bit per node), see
+// below.
 //
 // \todo (also applies to Octree.h)
-// - Split out the bit interleaving code into a Morton helper (fast path for index sizes that case use magic bits https://graphics.stanford.edu/~seander/bithacks.html).
-// - Implement linearize/delinearize.
-// - Bitmap specialization for tNode == bool.
 // - Make static functions private.
-// - Better implementation of FindNeighbor()?
 ///////////////////////////////////////////////////////////////////////////////
-template <typename tIndex, typename tNode>
-class Quadtree
+
+namespace internal {
+
+// Index arithmetic common to all Quadtree specializations.
+template <typename tIndex>
+class QuadtreeBase
 {
-	int                  m_levelCount;
-	eastl::vector<tNode> m_nodes;
+protected:
+	int m_levelCount;
+
+	QuadtreeBase(int _levelCount);
 
 public:
 	typedef tIndex Index;
-	typedef tNode  Node;
 	static constexpr Index Index_Invalid  = ~Index(0);
 
 	// Absolute max number of levels given number of index bits = bits/2.
 	static constexpr int    GetAbsoluteMaxLevelCount()                                        { return (int)(sizeof(Index) * CHAR_BIT) / 2; }
 
 	// Node count at _level = 4^_level.
-	static constexpr Index  GetNodeCount(int _level)                                          { return 1 << (2 * _level); }
+	static constexpr Index  GetNodeCount(int _level)                                          { return Index(1) << (2 * _level); }
 
 	// Width (in nodes) at _level = sqrt(GetNodeCount(_level)).
-	static constexpr Index  GetWidth(int _level)                                              { return 1 << _level; }
+	static constexpr Index  GetWidth(int _level)                                              { return Index(1) << _level; }
 
 	// Total node count = 4*(leafCount - 1)/3+1.
 	static constexpr Index  GetTotalNodeCount(int _levelCount)                                { return 4 * (GetNodeCount(_levelCount - 1) - 1) / 3 + 1; }
 
 	// Index of first node at _level.
-	static constexpr Index  GetLevelStartIndex(int _level)                                    { return (_level == 0) ? 0 : GetTotalNodeCount(_level); } 
+	static constexpr Index  GetLevelStartIndex(int _level)                                    { return (_level == 0) ? 0 : GetTotalNodeCount(_level); }
 
 	// Neighbor at signed offset from _nodeIndex (or Index_Invalid if offset is outside the quadtree).
 	static           Index  FindNeighbor(Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY);
 
+	// Find the 4 edge neighbors of each of _nodeIndices, write them to out_ as (-x, +x, -y, +y) per node (Index_Invalid if outside the
+	// quadtree). Nodes may be at different levels, each neighbor is at the same level as the node.
+	static           void   FindEdgeNeighbors(const Index* _nodeIndices, Index* out_, uint _count);
+
 	// Given _index, find the quadtree level.
 	static           int    FindLevel(Index _nodeIndex);
 
@@ -77,93 +93,325 @@ public:
 	// Convert Cartesian coordinates to an index.
 	static           Index  ToIndex(Index _x, Index _y, int _nodeLevel);
 
+	// Width of a node in leaf nodes at _levelIndex (e.g. quadtree width at level 0, 1 at max level).
+	Index       getNodeWidth(int _levelIndex) const                                          { return GetWidth(APT_MAX(m_levelCount - _levelIndex - 1, 0)); }
+
+	int         getTotalNodeCount() const                                                    { return GetTotalNodeCount(m_levelCount); }
+	Index       getParentIndex(Index _childIndex, int _childLevel) const;
+	Index       getFirstChildIndex(Index _parentIndex, int _parentLevel) const;
+	Index       getNodeCount(int _levelIndex) const                                          { return GetNodeCount(_levelIndex); }
+	int         getLevelCount() const                                                        { return m_levelCount; }
+
+	// Spatial queries. Write the indices of the nodes at _level which intersect the query volume to out_ in index order, return the
+	// total number of intersecting nodes (only the first _maxCount are written, call again with a larger buffer if the return value
+	// exceeds _maxCount). _rootMin, _rootMax are the bounds of the root node.
+	// Child bounds are computed incrementally during the traversal and all 4 children of a node are tested at once (see
+	// SpatialQuery.h); subtrees which are entirely inside the volume aren't tested further.
+	// These functions treat all nodes as present; the Quadtree<bool> specialization only returns set nodes.
+	Index       queryAabb(const vec2& _rootMin, const vec2& _rootMax, const vec2& _min, const vec2& _max, int _level, Index* out_, Index _maxCount) const;
+	Index       querySphere(const vec2& _rootMin, const vec2& _rootMax, const vec2& _center, float _radius, int _level, Index* out_, Index _maxCount) const;
+	// _planes are (normal, offset) such that dot(normal, p) + offset >= 0 is inside, e.g. the 4 side planes of a view frustum. The test is
+	// conservative: nodes near the edges of the volume may be returned without intersecting it.
+	Index       queryFrustum(const vec2& _rootMin, const vec2& _rootMax, const vec3* _planes, int _planeCount, int _level, Index* out_, Index _maxCount) const;
+
+protected:
+	// Call _fn(_mortonOffset, _linearOffset) for each node at _levelIndex, where the offsets are relative to the level start. Nodes are
+	// processed in tiles of 8^2 nodes which are contiguous in Morton order, hence reads from the Morton order side stay within a tile
+	// and writes to the linear side are runs of 8 consecutive nodes. Tiles are distributed across _threadCount threads via ParallelFor().
+	template <typename tFunc>
+	static void ForEachNodeLinear(int _levelIndex, tFunc&& _fn, uint _threadCount);
+
+	// Call _recompute(_parentIndex, _parentLevel) once for each ancestor of _nodeIndices, deepest level first and in index order within
+	// a level, such that the children of a node are final before the node is recomputed.
+	template <typename tRecompute>
+	void        forEachDirtyAncestor(const Index* _nodeIndices, uint _count, tRecompute&& _recompute) const;
+
+	// Traverse nodes which overlap _test down to _level. _childMask(_parentIndex, _parentLevel) returns the mask of children to consider.
+	// If kDense, all nodes are present and the descendants of a node entirely inside _test are written as a range without traversal.
+	template <bool kDense, typename tTest, typename tChildMask>
+	Index       query(const tTest& _test, const vec2& _rootMin, const vec2& _rootMax, int _level, tChildMask&& _childMask, Index* out_, Index _maxCount) const;
+};
+
+} // namespace internal
+
+template <typename tIndex, typename tNode, typename tAllocator>
+class Quadtree: public internal::QuadtreeBase<tIndex>
+{
+	typedef internal::QuadtreeBase<tIndex> Base;
+	using Base::m_levelCount;
+
+	eastl::vector<tNode, tAllocator> m_nodes;
+
+	// Combine the 4 children at _children via _op, see reduce().
+	template <typename tOp>
+	static tNode ReduceChildren(const tNode* _children, tOp& _op);
+
+public:
+	typedef tIndex     Index;
+	typedef tNode      Node;
+	typedef tAllocator Allocator;
+	using Base::Index_Invalid;
+	using Base::GetAbsoluteMaxLevelCount;
+	using Base::GetTotalNodeCount;
+	using Base::GetLevelStartIndex;
+	using Base::GetNodeCount;
+	using Base::FindNeighbor;
+	using Base::FindLevel;
+	using Base::getParentIndex;
+	using Base::getFirstChildIndex;
 
-	Quadtree(int _levelCount = GetAbsoluteMaxLevelCount(), Node _init = Node());
+	Quadtree(int _levelCount = GetAbsoluteMaxLevelCount(), Node _init = Node(), const Allocator& _allocator = Allocator());
 	~Quadtree();
 
-	// Depth-first traversal of the quadtree starting at _root, call _onVisit for each node. 
+	// Depth-first traversal of the quadtree starting at _root, call _onVisit for each node.
 	// _onVisit should be of the form ()(tIndex _nodeIndex, int _nodeLevel) -> bool.
 	// Traversal proceeds to a node's children only if _onVisit returns true.
 	template<typename OnVisit>
 	void        traverse(OnVisit&& _onVisit, Index _rootIndex = 0);
 
+	// Parallel traversal. Nodes above _grainLevel are visited on the calling thread as per traverse(), then the subtrees rooted at
+	// _grainLevel are traversed in parallel via ParallelFor() (_threadCount = 0 uses all hardware threads). Each subtree is traversed
+	// by a single thread, hence _onVisit may be called concurrently for nodes in different subtrees but never for 2 nodes in the same
+	// subtree. The visit order between subtrees is unspecified.
+	template<typename OnVisit>
+	void        traverseParallel(OnVisit&& _onVisit, int _grainLevel, uint _threadCount = 0);
+
 	// Find a valid neighbor at _offsetX, _offsetY from the given node.
 	Index       findValidNeighbor(Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY, Node _invalidNode = Node());
 
-	// Width of a node in leaf nodes at _levelIndex (e.g. quadtree width at level 0, 1 at max level).
-	Index       getNodeWidth(int _levelIndex) const                                          { return GetWidth(APT_MAX(m_levelCount - _levelIndex - 1, 0)); }
-
 	// Node access.
 	Node&       operator[](Index _index)                                                     { APT_STRICT_ASSERT(_index < GetTotalNodeCount(m_levelCount)); return m_nodes[_index]; }
 	const Node& operator[](Index _index) const                                               { APT_STRICT_ASSERT(_index < GetTotalNodeCount(m_levelCount)); return m_nodes[_index]; }
-	int         getTotalNodeCount() const                                                    { return GetTotalNodeCount(m_levelCount); }
-	Index       getIndex(const Node& _node) const                                            { return &_node - m_nodes; }
-	Index       getParentIndex(Index _childIndex, int _childLevel) const;
-	Index       getFirstChildIndex(Index _parentIndex, int _parentLevel) const;
+	Index       getIndex(const Node& _node) const                                            { return (Index)(&_node - m_nodes.data()); }
 
 	// Level access.
-	const Node* getLevel(int _levelIndex) const                                              { APT_STRICT_ASSERT(_levelIndex < m_levelCount); return m_nodes + GetLevelStartIndex(_level); }
-	Node*       getLevel(int _levelIndex)                                                    { APT_STRICT_ASSERT(_levelIndex < m_levelCount); return m_nodes + GetLevelStartIndex(_level); }
-	Index       getNodeCount(int _levelIndex) const                                          { return GetNodeCount(_levelIndex); }
-	int         getLevelCount() const                                                        { return m_levelCount; }
+	const Node* getLevel(int _levelIndex) const                                              { APT_STRICT_ASSERT(_levelIndex < m_levelCount); return m_nodes.data() + GetLevelStartIndex(_levelIndex); }
+	Node*       getLevel(int _levelIndex)                                                    { APT_STRICT_ASSERT(_levelIndex < m_levelCount); return m_nodes.data() + GetLevelStartIndex(_levelIndex); }
+
+	// Linearize/delinearize nodes for a level. This is useful e.g. when converting to/from a texture representation. out_/_in must
+	// contain getNodeCount(_levelIndex) nodes. _threadCount > 1 distributes the work across threads (0 = all hardware threads), which
+	// is worthwhile for large levels only.
+	void        linearize(int _levelIndex, Node* out_, uint _threadCount = 1) const;
+	void        delinearize(int _levelIndex, const Node* _in, uint _threadCount = 1);
+
+	// Fill every parent node from its 4 children, from the deepest level up. _op should be of the form ()(const Node&, const Node&) -> Node
+	// (e.g. min, max, sum); the children of a node are combined as _op(_op(c0, c1), _op(c2, c3)). Within a level, parents are computed
+	// in a single pass over contiguous memory and distributed across _threadCount threads (0 = all hardware threads).
+	template <typename tOp>
+	void        reduce(tOp&& _op, uint _threadCount = 1);
 
-	// Linearize/delinearize nodes for a level. This is useful e.g. when converting to/from a texture representation.
-	void        linearize(int _levelIndex, Node* out_) const                                 { APT_ASSERT(false); } // \todo
-	void        delinearize(int _levelIndex, const Node* _in)                                { APT_ASSERT(false); } // \todo
+	// As reduce() but only recompute the ancestors of _nodeIndices (e.g. leaves which changed since the last reduce()).
+	template <typename tOp>
+	void        reduceDirty(tOp&& _op, const Index* _nodeIndices, uint _count);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Quadtree<tIndex, bool>
+// Bitmap quadtree, e.g. for occupancy. Each node is 1 bit; node i is stored at
+// bit i + 3 so that the 4 children of a node (which start at 4i + 1) occupy an
+// aligned nibble and can be tested with a single mask via getChildMask().
+//
+// Nodes are read via operator[] and written via set(). traverse() only visits
+// set nodes, hence unset nodes are treated as empty subtrees and are skipped
+// without being visited. forEachSet() visits all set nodes in a level, skipping
+// empty regions 64 nodes at a time.
+///////////////////////////////////////////////////////////////////////////////
+template <typename tIndex, typename tAllocator>
+class Quadtree<tIndex, bool, tAllocator>: public internal::QuadtreeBase<tIndex>
+{
+	typedef internal::QuadtreeBase<tIndex> Base;
+	using Base::m_levelCount;
+
+	static constexpr tIndex kBitOffset = 3;
+
+	// Apply _op to the lanes of 4 bits in _bits, i.e. bit 4i of the result is the reduction of bits [4i, 4i + 3] (other bits are undefined).
+	template <typename tOp>
+	static uint64 ReduceLanes(uint64 _bits, tOp& _op);
+
+	// Gather every 4th bit of _bits into the low 16 bits.
+	static uint64 CompactLanes(uint64 _bits);
+
+	// Return 64 bits starting at bit _bit (bits past the end of the bitmap are 0).
+	uint64      readBits(tIndex _bit) const;
+
+	// Recompute the parent bits [_bitBegin, _bitEnd) which must be within a single word. _parentBegin is the first parent bit of the
+	// level, _childBegin the first child bit.
+	template <typename tOp>
+	void        reduceBits(tIndex _bitBegin, tIndex _bitEnd, tIndex _parentBegin, tIndex _childBegin, tOp& _op);
+
+	eastl::vector<uint64, tAllocator> m_bits;
+
+public:
+	typedef tIndex     Index;
+	typedef bool       Node;
+	typedef tAllocator Allocator;
+	using Base::Index_Invalid;
+	using Base::GetAbsoluteMaxLevelCount;
+	using Base::GetTotalNodeCount;
+	using Base::GetLevelStartIndex;
+	using Base::GetNodeCount;
+	using Base::FindNeighbor;
+	using Base::FindLevel;
+	using Base::getParentIndex;
+	using Base::getFirstChildIndex;
+
+	Quadtree(int _levelCount = GetAbsoluteMaxLevelCount(), bool _init = false, const Allocator& _allocator = Allocator());
+
+	// Depth-first traversal of the set nodes in the quadtree starting at _root (which is visited only if set), call _onVisit for each
+	// set node. _onVisit should be of the form ()(tIndex _nodeIndex, int _nodeLevel) -> bool.
+	// Traversal proceeds to a node's set children only if _onVisit returns true.
+	template<typename OnVisit>
+	void        traverse(OnVisit&& _onVisit, Index _rootIndex = 0) const;
+
+	// Parallel traversal of the set nodes, see the generic traverseParallel().
+	template<typename OnVisit>
+	void        traverseParallel(OnVisit&& _onVisit, int _grainLevel, uint _threadCount = 0) const;
+
+	// Call _onVisit for each set node at _levelIndex in index order. _onVisit should be of the form ()(tIndex _nodeIndex).
+	template<typename OnVisit>
+	void        forEachSet(int _levelIndex, OnVisit&& _onVisit) const;
+
+	// Number of set nodes at _levelIndex.
+	Index       countSet(int _levelIndex) const;
+
+	// Spatial queries, as per the generic Quadtree but only set nodes (whose ancestors are all set) are returned.
+	Index       queryAabb(const vec2& _rootMin, const vec2& _rootMax, const vec2& _min, const vec2& _max, int _level, Index* out_, Index _maxCount) const;
+	Index       querySphere(const vec2& _rootMin, const vec2& _rootMax, const vec2& _center, float _radius, int _level, Index* out_, Index _maxCount) const;
+	Index       queryFrustum(const vec2& _rootMin, const vec2& _rootMax, const vec3* _planes, int _planeCount, int _level, Index* out_, Index _maxCount) const;
+
+	// Find a set neighbor at _offsetX, _offsetY from the given node (search up the tree until a set node is found).
+	Index       findValidNeighbor(Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY) const;
+
+	// Node access.
+	bool        operator[](Index _index) const                                               { APT_STRICT_ASSERT(_index < GetTotalNodeCount(m_levelCount)); return (m_bits[(_index + kBitOffset) >> 6] >> ((_index + kBitOffset) & 63)) & 1; }
+	void        set(Index _index, bool _value);
+
+	// Return a mask with bit i set if child i of _parentIndex is set (0 if _parentLevel is the last level).
+	uint32      getChildMask(Index _parentIndex, int _parentLevel) const;
+
+	// Raw bitmap (node i is bit i + 3).
+	const uint64* getBits() const                                                            { return m_bits.data(); }
+	uint        getBitsCount() const                                                         { return (uint)m_bits.size(); }
+
+	// Linearize/delinearize nodes for a level, see the generic Quadtree. delinearize() is single threaded as adjacent tiles may share
+	// words of the bitmap.
+	void        linearize(int _levelIndex, bool* out_, uint _threadCount = 1) const;
+	void        delinearize(int _levelIndex, const bool* _in);
+
+	// Fill every parent node from its 4 children, see the generic reduce(). _op should be a bitwise operation of the form
+	// ()(uint64, uint64) -> uint64, e.g. | to set a node if any child is set or & to set a node if all children are set. _op is applied to
+	// 64 bits at a time.
+	template <typename tOp>
+	void        reduce(tOp&& _op, uint _threadCount = 1);
+
+	// As reduce() but only recompute the ancestors of _nodeIndices.
+	template <typename tOp>
+	void        reduceDirty(tOp&& _op, const Index* _nodeIndices, uint _count);
 };
 
 
 /*******************************************************************************
 
-                                  Quadtree
+                                  QuadtreeBase
 
 *******************************************************************************/
 
-#define APT_QUADTREE_TEMPLATE_DECL template <typename tIndex, typename tNode>
-#define APT_QUADTREE_CLASS_DECL    Quadtree<tIndex, tNode>
+#define APT_QUADTREE_TEMPLATE_DECL template <typename tIndex>
+#define APT_QUADTREE_CLASS_DECL    internal::QuadtreeBase<tIndex>
+
+APT_QUADTREE_TEMPLATE_DECL
+constexpr tIndex APT_QUADTREE_CLASS_DECL::Index_Invalid;
 
-APT_QUADTREE_TEMPLATE_DECL 
+APT_QUADTREE_TEMPLATE_DECL
+APT_QUADTREE_CLASS_DECL::QuadtreeBase(int _levelCount)
+	: m_levelCount(_levelCount)
+{
+	APT_STATIC_ASSERT(!DataTypeIsSigned(APT_DATA_TYPE_TO_ENUM(Index))); // use an unsigned type
+	APT_ASSERT(_levelCount <= GetAbsoluteMaxLevelCount()); // not enough bits in tIndex
+}
+
+APT_QUADTREE_TEMPLATE_DECL
 tIndex APT_QUADTREE_CLASS_DECL::FindNeighbor(Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY)
 {
 	if (_nodeIndex == Index_Invalid)
 	{
 		return Index_Invalid;
 	}
-	uvec2 offset = ToCartesian(_nodeIndex, _nodeLevel) + uvec2(_offsetX, _offsetY);
-	return ToIndex(offset.x, offset.y, _nodeLevel);
+	Index width = GetWidth(_nodeLevel);
+	if ((Index)(_offsetX < 0 ? -_offsetX : _offsetX) >= width || (Index)(_offsetY < 0 ? -_offsetY : _offsetY) >= width)
+	{
+		return Index_Invalid;
+	}
+
+ // add the offsets directly to the Morton code: setting the bits of the other axis propagates carries across them, negative offsets
+ // are two's complement in the dilated lanes
+	const Index maskY = apt::MortonEncode2<Index>(Index_Invalid, 0); // y in the low bit, see ToIndex()
+	const Index maskX = (Index)~maskY;
+	Index code = _nodeIndex - GetLevelStartIndex(_nodeLevel);
+	Index y = (Index)(((code | maskX) + apt::MortonEncode2<Index>((Index)_offsetY, 0)) & maskY);
+	Index x = (Index)(((code | maskY) + apt::MortonEncode2<Index>(0, (Index)_offsetX)) & maskX);
+	code = x | y;
+
+ // over/underflow sets bits above the level's range
+	if ((code >> (2 * _nodeLevel)) != 0)
+	{
+		return Index_Invalid;
+	}
+	return code + GetLevelStartIndex(_nodeLevel);
 }
 
-APT_QUADTREE_TEMPLATE_DECL 
-int APT_QUADTREE_CLASS_DECL::FindLevel(Index _nodeIndex)
+APT_QUADTREE_TEMPLATE_DECL
+void APT_QUADTREE_CLASS_DECL::FindEdgeNeighbors(const Index* _nodeIndices, Index* out_, uint _count)
 {
-	for (int i = 0, n = GetAbsoluteMaxLevelCount(); i < n; ++i)
+	APT_ASSERT((_nodeIndices && out_) || _count == 0);
+	const Index maskY = apt::MortonEncode2<Index>(Index_Invalid, 0);
+	const Index maskX = (Index)~maskY;
+	const Index oneY  = 1; // lowest bit of each lane
+	const Index oneX  = 2;
+	for (uint i = 0; i < _count; ++i)
 	{
-		if (_nodeIndex < GetLevelStartIndex(i + 1))
+		Index nodeIndex  = _nodeIndices[i];
+		int   level      = FindLevel(nodeIndex);
+		APT_ASSERT(level >= 0);
+		Index levelStart = GetLevelStartIndex(level);
+		Index code       = nodeIndex - levelStart;
+		Index x          = code & maskX;
+		Index y          = code & maskY;
+		Index neighbors[4] =
 		{
-			return i;
+			(Index)(((x - oneX) & maskX) | y),
+			(Index)(((x + maskY + oneX) & maskX) | y),
+			(Index)(((y - oneY) & maskY) | x),
+			(Index)(((y + maskX + oneY) & maskY) | x),
+		};
+		for (int j = 0; j < 4; ++j)
+		{
+			out_[i * 4 + j] = (neighbors[j] >> (2 * level)) != 0 ? Index_Invalid : neighbors[j] + levelStart;
 		}
 	}
-	return -1;
 }
 
-APT_QUADTREE_TEMPLATE_DECL 
-uvec2 APT_QUADTREE_CLASS_DECL::ToCartesian(Index _nodeIndex, int _nodeLevel)
+APT_QUADTREE_TEMPLATE_DECL
+int APT_QUADTREE_CLASS_DECL::FindLevel(Index _nodeIndex)
 {
- // traverse the index LSB -> MSB summing node width (node width = number of leaf nodes covered, start at 1) 
-	_nodeIndex -= GetLevelStartIndex(_nodeLevel);
-	Index width = 1;
-	uvec2 ret = uvec2(0u);
-	for (int i = 0; i < _nodeLevel; ++i, width *= 2)
+ // level l starts at (4^l - 1)/3, hence level = floor(log4(3 * _nodeIndex + 1))
+	uint64 x = (uint64)_nodeIndex;
+	if (x > (~uint64(0) - 1) / 3)
 	{
-		ret.y += (_nodeIndex & 1) * width; 
-		_nodeIndex = _nodeIndex >> 1;
-		ret.x += (_nodeIndex & 1) * width;
-		_nodeIndex = _nodeIndex >> 1;
+		return -1;
 	}
-	return ret;
+	int ret = (int)FindLastSet(3 * x + 1) / 2;
+	return ret < GetAbsoluteMaxLevelCount() ? ret : -1;
 }
 
-APT_QUADTREE_TEMPLATE_DECL 
+APT_QUADTREE_TEMPLATE_DECL
+uvec2 APT_QUADTREE_CLASS_DECL::ToCartesian(Index _nodeIndex, int _nodeLevel)
+{
+	_nodeIndex -= GetLevelStartIndex(_nodeLevel);
+	return uvec2((uint32)apt::MortonCompact2<Index>(_nodeIndex >> 1), (uint32)apt::MortonCompact2<Index>(_nodeIndex));
+}
+
+APT_QUADTREE_TEMPLATE_DECL
 tIndex APT_QUADTREE_CLASS_DECL::ToIndex(Index _x, Index _y, int _nodeLevel)
 {
  // _x or _y are outside the quadtree
@@ -173,64 +421,242 @@ tIndex APT_QUADTREE_CLASS_DECL::ToIndex(Index _x, Index _y, int _nodeLevel)
 		return Index_Invalid;
 	}
 
- // interleave _x and _y to produce the Morton code, add level offset
-	Index ret = 0;
-	for (Index i = 0; i < (sizeof(Index) * CHAR_BIT); ++i)
+ // interleave _x and _y to produce the Morton code (y in the low bit, see the layout above), add level offset
+	return apt::MortonEncode2<Index>(_y, _x) + GetLevelStartIndex(_nodeLevel);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::getParentIndex(Index _childIndex, int _childLevel) const
+{
+	if (_childLevel == 0)
 	{
-		const Index mask = 1 << i;
-		const Index base = i;
-		ret = ret 
-			| (_y & mask) << (base + 0) 
-			| (_x & mask) << (base + 1)
-			;
+		return Index_Invalid;
 	}
-	return ret + GetLevelStartIndex(_nodeLevel);
+	Index  childOffset  = GetLevelStartIndex(_childLevel);
+	Index  parentOffset = GetLevelStartIndex(APT_MAX(_childLevel - 1, 0));
+	return parentOffset + ((_childIndex - childOffset) >> 2);
 }
 
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::getFirstChildIndex(Index _parentIndex, int _parentLevel) const
+{
+	if (_parentLevel >= m_levelCount -1)
+	{
+		return Index_Invalid;
+	}
+	Index  parentOffset = GetLevelStartIndex(_parentLevel);
+	Index  childOffset  = GetLevelStartIndex(_parentLevel + 1);
+	return childOffset + ((_parentIndex - parentOffset) << 2);
+}
 
-APT_QUADTREE_TEMPLATE_DECL 
-APT_QUADTREE_CLASS_DECL::Quadtree(int _levelCount, Node _init)
-	: m_levelCount(_levelCount)
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::queryAabb(const vec2& _rootMin, const vec2& _rootMax, const vec2& _min, const vec2& _max, int _level, Index* out_, Index _maxCount) const
 {
-	APT_STATIC_ASSERT(!DataTypeIsSigned(APT_DATA_TYPE_TO_ENUM(Index))); // use an unsigned type
-	APT_ASSERT(_levelCount <= GetAbsoluteMaxLevelCount()); // not enough bits in tIndex
+	return query<true>(internal::SpatialAabb<2>(_min, _max), _rootMin, _rootMax, _level, [](Index, int) { return 0xfu; }, out_, _maxCount);
+}
 
-	Index totalNodeCount = GetTotalNodeCount(_levelCount);
-	m_nodes.reserve(totalNodeCount);
-	for (Index i = 0, n = GetTotalNodeCount(_levelCount); i < n; ++i) 
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::querySphere(const vec2& _rootMin, const vec2& _rootMax, const vec2& _center, float _radius, int _level, Index* out_, Index _maxCount) const
+{
+	return query<true>(internal::SpatialSphere<2>(_center, _radius), _rootMin, _rootMax, _level, [](Index, int) { return 0xfu; }, out_, _maxCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::queryFrustum(const vec2& _rootMin, const vec2& _rootMax, const vec3* _planes, int _planeCount, int _level, Index* out_, Index _maxCount) const
+{
+	return query<true>(internal::SpatialPlanes<2, vec3>(_planes, _planeCount), _rootMin, _rootMax, _level, [](Index, int) { return 0xfu; }, out_, _maxCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <bool kDense, typename tTest, typename tChildMask>
+tIndex APT_QUADTREE_CLASS_DECL::query(const tTest& _test, const vec2& _rootMin, const vec2& _rootMax, int _level, tChildMask&& _childMask, Index* out_, Index _maxCount) const
+{
+	APT_ASSERT(_level >= 0 && _level < m_levelCount);
+	APT_ASSERT(out_ || _maxCount == 0);
+
+	vec2 nodeSize[GetAbsoluteMaxLevelCount()]; // node size per level
+	nodeSize[0] = _rootMax - _rootMin;
+	for (int i = 1; i <= _level; ++i)
+	{
+		nodeSize[i] = nodeSize[i - 1] * 0.5f;
+	}
+
+	Index ret = 0;
+	struct NodeAddr { Index m_index; int m_level; bool m_inside; vec2 m_min; };
+	eastl::fixed_vector<NodeAddr, GetAbsoluteMaxLevelCount() * 4> tstack; // depth-first traversal has a small upper limit on the stack size
+
+ // test the root as child 0 of a parent with the same min
+	uint32 overlap, inside;
+	internal::SpatialTestChildren<2>(_test, &_rootMin.x, &nodeSize[0].x, overlap, inside);
+	if (overlap & 1)
 	{
-		m_nodes.emplace_back(_init);	
+		tstack.push_back({ 0, 0, (inside & 1) != 0, _rootMin });
 	}
+	while (!tstack.empty())
+	{
+		NodeAddr node = tstack.back();
+		tstack.pop_back();
+		if (node.m_level == _level)
+		{
+			if (ret < _maxCount)
+			{
+				out_[ret] = node.m_index;
+			}
+			++ret;
+			continue;
+		}
+
+		if (kDense && node.m_inside)
+		{
+		 // descendants at _level are a contiguous range of indices
+			int   shift = 2 * (_level - node.m_level);
+			Index first = GetLevelStartIndex(_level) + ((node.m_index - GetLevelStartIndex(node.m_level)) << shift);
+			Index count = Index(1) << shift;
+			for (Index i = 0; i < count && ret + i < _maxCount; ++i)
+			{
+				out_[ret + i] = first + i;
+			}
+			ret += count;
+			continue;
+		}
+
+		uint32 childMask = _childMask(node.m_index, node.m_level);
+		if (node.m_inside)
+		{
+			inside = childMask;
+		}
+		else
+		{
+			internal::SpatialTestChildren<2>(_test, &node.m_min.x, &nodeSize[node.m_level + 1].x, overlap, inside);
+			childMask &= overlap;
+		}
+
+	 // push in reverse order so that nodes are visited (and written to out_) in index order
+		const vec2& childSize = nodeSize[node.m_level + 1];
+		Index firstChildIndex = getFirstChildIndex(node.m_index, node.m_level);
+		while (childMask != 0)
+		{
+			uint32 i = FindLastSet(childMask);
+			childMask &= ~(1u << i);
+			vec2 childMin = node.m_min + vec2((float)((i >> 1) & 1), (float)(i & 1)) * childSize;
+			tstack.push_back({ firstChildIndex + (Index)i, node.m_level + 1, ((inside >> i) & 1) != 0, childMin });
+		}
+	}
+	return ret;
 }
 
-APT_QUADTREE_TEMPLATE_DECL 
-APT_QUADTREE_CLASS_DECL::~Quadtree()
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tFunc>
+void APT_QUADTREE_CLASS_DECL::ForEachNodeLinear(int _levelIndex, tFunc&& _fn, uint _threadCount)
 {
-	m_nodes.clear();
+	const Index width = GetWidth(_levelIndex);
+	if (width < 8)
+	{
+	 // level smaller than a tile, convert per node
+		ParallelFor((uint)GetNodeCount(_levelIndex), [&](uint _mortonOffset)
+			{
+				uvec2 c = apt::MortonDecode2<Index>((Index)_mortonOffset);
+				_fn((Index)_mortonOffset, (Index)c.x * width + c.y);
+			},
+			_threadCount);
+		return;
+	}
+
+ // Morton offsets within a tile per axis; the axes occupy disjoint bits hence a node's offset is offsetX[x] + offsetY[y]
+	Index offsetX[8], offsetY[8];
+	for (Index i = 0; i < 8; ++i)
+	{
+		offsetX[i] = apt::MortonEncode2<Index>(0, i);
+		offsetY[i] = apt::MortonEncode2<Index>(i, 0);
+	}
+
+ // the tile index is the Morton code of the tile coordinates
+	ParallelFor((uint)(GetNodeCount(_levelIndex) / 64), [&](uint _tileIndex)
+		{
+			Index tile         = (Index)_tileIndex;
+			Index mortonOffset = tile * 64;
+			Index tileX        = apt::MortonCompact2<Index>(tile >> 1) * 8;
+			Index tileY        = apt::MortonCompact2<Index>(tile) * 8;
+			for (Index y = 0; y < 8; ++y)
+			{
+				Index rowMortonOffset = mortonOffset + offsetY[y];
+				Index rowLinearOffset = (tileY + y) * width + tileX;
+				for (Index x = 0; x < 8; ++x)
+				{
+					_fn(rowMortonOffset + offsetX[x], rowLinearOffset + x);
+				}
+			}
+		},
+		_threadCount);
 }
 
-APT_QUADTREE_TEMPLATE_DECL 
-tIndex APT_QUADTREE_CLASS_DECL::getParentIndex(Index _childIndex, int _childLevel) const
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tRecompute>
+void APT_QUADTREE_CLASS_DECL::forEachDirtyAncestor(const Index* _nodeIndices, uint _count, tRecompute&& _recompute) const
 {
-	if (_childLevel == 0) 
+	APT_ASSERT(_nodeIndices || _count == 0);
+	eastl::vector<Index> dirty(_nodeIndices, _nodeIndices + _count);
+	eastl::sort(dirty.begin(), dirty.end());
+	for (int level = m_levelCount - 1; level > 0; --level)
 	{
-		return Index_Invalid;
+	 // levels are stored sequentially, hence the dirty nodes at level are at the end of the sorted list
+		uint first = (uint)(eastl::lower_bound(dirty.begin(), dirty.end(), GetLevelStartIndex(level)) - dirty.begin());
+		if (first == dirty.size())
+		{
+			continue;
+		}
+		APT_ASSERT(dirty.back() < GetLevelStartIndex(level + 1));
+
+	 // replace the dirty nodes by their parents, which are sorted since the parent index increases with the child index
+		uint  last = first;
+		Index prev = Index_Invalid;
+		for (uint i = first; i < dirty.size(); ++i)
+		{
+			Index parent = getParentIndex(dirty[i], level);
+			if (parent != prev)
+			{
+				_recompute(parent, level - 1);
+				dirty[last++] = parent;
+				prev = parent;
+			}
+		}
+		dirty.resize(last);
+
+	 // merge with the dirty nodes which were already at level - 1
+		eastl::sort(eastl::lower_bound(dirty.begin(), dirty.end(), GetLevelStartIndex(level - 1)), dirty.end());
 	}
-	Index  childOffset  = GetLevelStartIndex(_childLevel);
-	Index  parentOffset = GetLevelStartIndex(APT_MAX(_childLevel - 1, 0));
-	return parentOffset + ((_childIndex - childOffset) >> 2);
 }
 
-APT_QUADTREE_TEMPLATE_DECL 
-tIndex APT_QUADTREE_CLASS_DECL::getFirstChildIndex(Index _parentIndex, int _parentLevel) const
+#undef APT_QUADTREE_TEMPLATE_DECL
+#undef APT_QUADTREE_CLASS_DECL
+
+
+/*******************************************************************************
+
+                                  Quadtree
+
+*******************************************************************************/
+
+#define APT_QUADTREE_TEMPLATE_DECL template <typename tIndex, typename tNode, typename tAllocator>
+#define APT_QUADTREE_CLASS_DECL    Quadtree<tIndex, tNode, tAllocator>
+
+APT_QUADTREE_TEMPLATE_DECL
+APT_QUADTREE_CLASS_DECL::Quadtree(int _levelCount, Node _init, const Allocator& _allocator)
+	: Base(_levelCount)
+	, m_nodes(_allocator)
 {
-	if (_parentLevel >= m_levelCount -1)
+	Index totalNodeCount = GetTotalNodeCount(_levelCount);
+	m_nodes.reserve(totalNodeCount);
+	for (Index i = 0, n = GetTotalNodeCount(_levelCount); i < n; ++i)
 	{
-		return Index_Invalid;
+		m_nodes.emplace_back(_init);
 	}
-	Index  parentOffset = GetLevelStartIndex(_parentLevel);
-	Index  childOffset  = GetLevelStartIndex(_parentLevel + 1);
-	return childOffset + ((_parentIndex - parentOffset) << 2);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+APT_QUADTREE_CLASS_DECL::~Quadtree()
+{
+	m_nodes.clear();
 }
 
 APT_QUADTREE_TEMPLATE_DECL
@@ -244,18 +670,18 @@ tIndex APT_QUADTREE_CLASS_DECL::findValidNeighbor(Index _nodeIndex, int _nodeLev
 	return ret;
 }
 
-APT_QUADTREE_TEMPLATE_DECL 
+APT_QUADTREE_TEMPLATE_DECL
 template<typename OnVisit>
 void APT_QUADTREE_CLASS_DECL::traverse(OnVisit&& _onVisit, Index _root)
 {
 	struct NodeAddr { Index m_index; int m_level; }; // store level in the stack, avoid calling FindLevel()
 	eastl::fixed_vector<NodeAddr, GetAbsoluteMaxLevelCount() * 4> tstack; // depth-first traversal has a small upper limit on the stack size
 	tstack.push_back({ _root, FindLevel(_root) });
-	while (!tstack.empty()) 
+	while (!tstack.empty())
 	{
 		NodeAddr node = tstack.back();
 		tstack.pop_back();
-		if (eastl::forward<OnVisit>(_onVisit)(node.m_index, node.m_level) && node.m_level < m_levelCount - 1) 
+		if (eastl::forward<OnVisit>(_onVisit)(node.m_index, node.m_level) && node.m_level < m_levelCount - 1)
 		{
 			Index firstChildIndex = getFirstChildIndex(node.m_index, node.m_level);
 			tstack.push_back({ firstChildIndex + 0u, node.m_level + 1 });
@@ -266,6 +692,379 @@ void APT_QUADTREE_CLASS_DECL::traverse(OnVisit&& _onVisit, Index _root)
 	}
 }
 
+APT_QUADTREE_TEMPLATE_DECL
+template<typename OnVisit>
+void APT_QUADTREE_CLASS_DECL::traverseParallel(OnVisit&& _onVisit, int _grainLevel, uint _threadCount)
+{
+	APT_ASSERT(_grainLevel >= 0 && _grainLevel < m_levelCount);
+	eastl::vector<Index> subtrees;
+	traverse([&](Index _nodeIndex, int _nodeLevel)
+		{
+			if (_nodeLevel == _grainLevel)
+			{
+				subtrees.push_back(_nodeIndex);
+				return false;
+			}
+			return (bool)_onVisit(_nodeIndex, _nodeLevel);
+		});
+	ParallelFor((uint)subtrees.size(), [&](uint _i) { traverse(_onVisit, subtrees[_i]); }, _threadCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+void APT_QUADTREE_CLASS_DECL::linearize(int _levelIndex, Node* out_, uint _threadCount) const
+{
+	APT_ASSERT(_levelIndex >= 0 && _levelIndex < m_levelCount);
+	const Node* level = getLevel(_levelIndex);
+	Base::ForEachNodeLinear(_levelIndex, [level, out_](Index _mortonOffset, Index _linearOffset) { out_[_linearOffset] = level[_mortonOffset]; }, _threadCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+void APT_QUADTREE_CLASS_DECL::delinearize(int _levelIndex, const Node* _in, uint _threadCount)
+{
+	APT_ASSERT(_levelIndex >= 0 && _levelIndex < m_levelCount);
+	Node* level = getLevel(_levelIndex);
+	Base::ForEachNodeLinear(_levelIndex, [level, _in](Index _mortonOffset, Index _linearOffset) { level[_mortonOffset] = _in[_linearOffset]; }, _threadCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tOp>
+void APT_QUADTREE_CLASS_DECL::reduce(tOp&& _op, uint _threadCount)
+{
+	const Index kBlockSize = 1024; // parents per ParallelFor() index
+	for (int level = m_levelCount - 1; level > 0; --level)
+	{
+		const Node* children    = getLevel(level);
+		Node*       parents     = getLevel(level - 1);
+		Index       parentCount = GetNodeCount(level - 1);
+		ParallelFor((uint)((parentCount + kBlockSize - 1) / kBlockSize), [&](uint _block)
+			{
+				Index begin = (Index)_block * kBlockSize;
+				Index end   = APT_MIN(begin + kBlockSize, parentCount);
+				for (Index i = begin; i < end; ++i)
+				{
+					parents[i] = ReduceChildren(children + (i << 2), _op);
+				}
+			},
+			_threadCount);
+	}
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tOp>
+void APT_QUADTREE_CLASS_DECL::reduceDirty(tOp&& _op, const Index* _nodeIndices, uint _count)
+{
+	Base::forEachDirtyAncestor(_nodeIndices, _count, [&](Index _parentIndex, int _parentLevel)
+		{
+			m_nodes[_parentIndex] = ReduceChildren(&m_nodes[getFirstChildIndex(_parentIndex, _parentLevel)], _op);
+		});
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tOp>
+tNode APT_QUADTREE_CLASS_DECL::ReduceChildren(const Node* _children, tOp& _op)
+{
+	return _op(_op(_children[0], _children[1]), _op(_children[2], _children[3]));
+}
+
+#undef APT_QUADTREE_TEMPLATE_DECL
+#undef APT_QUADTREE_CLASS_DECL
+
+
+/*******************************************************************************
+
+                                  Quadtree<bool>
+
+*******************************************************************************/
+
+#define APT_QUADTREE_TEMPLATE_DECL template <typename tIndex, typename tAllocator>
+#define APT_QUADTREE_CLASS_DECL    Quadtree<tIndex, bool, tAllocator>
+
+APT_QUADTREE_TEMPLATE_DECL
+APT_QUADTREE_CLASS_DECL::Quadtree(int _levelCount, bool _init, const Allocator& _allocator)
+	: Base(_levelCount)
+	, m_bits(_allocator)
+{
+	uint64 bitCount = (uint64)GetTotalNodeCount(_levelCount) + kBitOffset;
+	m_bits.resize((size_t)((bitCount + 63) / 64), _init ? ~uint64(0) : uint64(0));
+	if (_init)
+	{
+	 // clear the leading offset bits and any trailing bits in the last word so that countSet() is correct
+		m_bits.front() &= ~((uint64(1) << kBitOffset) - 1);
+		if (bitCount & 63)
+		{
+			m_bits.back() &= (uint64(1) << (bitCount & 63)) - 1;
+		}
+	}
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+void APT_QUADTREE_CLASS_DECL::set(Index _index, bool _value)
+{
+	APT_STRICT_ASSERT(_index < GetTotalNodeCount(m_levelCount));
+	uint64& word = m_bits[(_index + kBitOffset) >> 6];
+	uint64  mask = uint64(1) << ((_index + kBitOffset) & 63);
+	word = _value ? (word | mask) : (word & ~mask);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+uint32 APT_QUADTREE_CLASS_DECL::getChildMask(Index _parentIndex, int _parentLevel) const
+{
+	if (_parentLevel >= m_levelCount - 1)
+	{
+		return 0;
+	}
+	Index bit = getFirstChildIndex(_parentIndex, _parentLevel) + kBitOffset; // 4-aligned, never straddles a word
+	return (uint32)(m_bits[bit >> 6] >> (bit & 63)) & 0xf;
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::countSet(int _levelIndex) const
+{
+	APT_STRICT_ASSERT(_levelIndex < m_levelCount);
+	uint64 beg = (uint64)GetLevelStartIndex(_levelIndex) + kBitOffset;
+	uint64 end = beg + GetNodeCount(_levelIndex);
+	Index ret = 0;
+	for (uint64 i = beg; i < end; )
+	{
+		uint64 word = m_bits[(size_t)(i >> 6)] >> (i & 63);
+		uint64 n = APT_MIN(64 - (i & 63), end - i);
+		if (n < 64)
+		{
+			word &= (uint64(1) << n) - 1;
+		}
+		ret += (Index)CountBits(word);
+		i += n;
+	}
+	return ret;
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::findValidNeighbor(Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY) const
+{
+	Index ret = FindNeighbor(_nodeIndex, _nodeLevel, _offsetX, _offsetY); // get neighbor index at the same level
+	while (ret != Index_Invalid && !(*this)[ret]) // search up the tree until a set node is found
+	{
+		ret = getParentIndex(ret, _nodeLevel--);
+	}
+	return ret;
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template<typename OnVisit>
+void APT_QUADTREE_CLASS_DECL::traverse(OnVisit&& _onVisit, Index _root) const
+{
+	if (!(*this)[_root])
+	{
+		return;
+	}
+	struct NodeAddr { Index m_index; int m_level; }; // store level in the stack, avoid calling FindLevel()
+	eastl::fixed_vector<NodeAddr, GetAbsoluteMaxLevelCount() * 4> tstack; // depth-first traversal has a small upper limit on the stack size
+	tstack.push_back({ _root, FindLevel(_root) });
+	while (!tstack.empty())
+	{
+		NodeAddr node = tstack.back();
+		tstack.pop_back();
+		if (eastl::forward<OnVisit>(_onVisit)(node.m_index, node.m_level) && node.m_level < m_levelCount - 1)
+		{
+		 // push only the set children, empty subtrees are skipped
+			Index firstChildIndex = getFirstChildIndex(node.m_index, node.m_level);
+			for (uint32 mask = getChildMask(node.m_index, node.m_level); mask != 0; mask &= mask - 1)
+			{
+				tstack.push_back({ firstChildIndex + (Index)FindFirstSet(mask), node.m_level + 1 });
+			}
+		}
+	}
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template<typename OnVisit>
+void APT_QUADTREE_CLASS_DECL::forEachSet(int _levelIndex, OnVisit&& _onVisit) const
+{
+	APT_STRICT_ASSERT(_levelIndex < m_levelCount);
+	uint64 beg = (uint64)GetLevelStartIndex(_levelIndex) + kBitOffset;
+	uint64 end = beg + GetNodeCount(_levelIndex);
+	for (uint64 i = beg & ~uint64(63); i < end; i += 64)
+	{
+		uint64 word = m_bits[(size_t)(i >> 6)];
+		if (i < beg)
+		{
+			word &= ~uint64(0) << (beg - i);
+		}
+		if (end - i < 64)
+		{
+			word &= (uint64(1) << (end - i)) - 1;
+		}
+		for (; word != 0; word &= word - 1)
+		{
+			eastl::forward<OnVisit>(_onVisit)((Index)(i + FindFirstSet(word) - kBitOffset));
+		}
+	}
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template<typename OnVisit>
+void APT_QUADTREE_CLASS_DECL::traverseParallel(OnVisit&& _onVisit, int _grainLevel, uint _threadCount) const
+{
+	APT_ASSERT(_grainLevel >= 0 && _grainLevel < m_levelCount);
+	eastl::vector<Index> subtrees;
+	traverse([&](Index _nodeIndex, int _nodeLevel)
+		{
+			if (_nodeLevel == _grainLevel)
+			{
+				subtrees.push_back(_nodeIndex);
+				return false;
+			}
+			return (bool)_onVisit(_nodeIndex, _nodeLevel);
+		});
+	ParallelFor((uint)subtrees.size(), [&](uint _i) { traverse(_onVisit, subtrees[_i]); }, _threadCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::queryAabb(const vec2& _rootMin, const vec2& _rootMax, const vec2& _min, const vec2& _max, int _level, Index* out_, Index _maxCount) const
+{
+	if (!(*this)[0])
+	{
+		return 0;
+	}
+	return Base::template query<false>(internal::SpatialAabb<2>(_min, _max), _rootMin, _rootMax, _level, [this](Index _nodeIndex, int _nodeLevel) { return getChildMask(_nodeIndex, _nodeLevel); }, out_, _maxCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::querySphere(const vec2& _rootMin, const vec2& _rootMax, const vec2& _center, float _radius, int _level, Index* out_, Index _maxCount) const
+{
+	if (!(*this)[0])
+	{
+		return 0;
+	}
+	return Base::template query<false>(internal::SpatialSphere<2>(_center, _radius), _rootMin, _rootMax, _level, [this](Index _nodeIndex, int _nodeLevel) { return getChildMask(_nodeIndex, _nodeLevel); }, out_, _maxCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+tIndex APT_QUADTREE_CLASS_DECL::queryFrustum(const vec2& _rootMin, const vec2& _rootMax, const vec3* _planes, int _planeCount, int _level, Index* out_, Index _maxCount) const
+{
+	if (!(*this)[0])
+	{
+		return 0;
+	}
+	return Base::template query<false>(internal::SpatialPlanes<2, vec3>(_planes, _planeCount), _rootMin, _rootMax, _level, [this](Index _nodeIndex, int _nodeLevel) { return getChildMask(_nodeIndex, _nodeLevel); }, out_, _maxCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+void APT_QUADTREE_CLASS_DECL::linearize(int _levelIndex, bool* out_, uint _threadCount) const
+{
+	APT_ASSERT(_levelIndex >= 0 && _levelIndex < m_levelCount);
+	const Index levelStart = GetLevelStartIndex(_levelIndex);
+	Base::ForEachNodeLinear(_levelIndex, [this, levelStart, out_](Index _mortonOffset, Index _linearOffset) { out_[_linearOffset] = (*this)[levelStart + _mortonOffset]; }, _threadCount);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+void APT_QUADTREE_CLASS_DECL::delinearize(int _levelIndex, const bool* _in)
+{
+	APT_ASSERT(_levelIndex >= 0 && _levelIndex < m_levelCount);
+	const Index levelStart = GetLevelStartIndex(_levelIndex);
+	Base::ForEachNodeLinear(_levelIndex, [this, levelStart, _in](Index _mortonOffset, Index _linearOffset) { set(levelStart + _mortonOffset, _in[_linearOffset]); }, 1);
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tOp>
+void APT_QUADTREE_CLASS_DECL::reduce(tOp&& _op, uint _threadCount)
+{
+	const Index kBlockSize = 16; // words per ParallelFor() index
+	for (int level = m_levelCount - 1; level > 0; --level)
+	{
+		const Index parentBegin = GetLevelStartIndex(level - 1) + kBitOffset;
+		const Index parentEnd   = GetLevelStartIndex(level) + kBitOffset;
+		const Index childBegin  = parentEnd;
+		const Index wordBegin   = parentBegin >> 6;
+		const Index wordEnd     = ((parentEnd - 1) >> 6) + 1;
+
+	 // interior words contain only parent bits and can be written concurrently
+		if (wordEnd - wordBegin > 2)
+		{
+			const Index interiorCount = wordEnd - wordBegin - 2;
+			ParallelFor((uint)((interiorCount + kBlockSize - 1) / kBlockSize), [&](uint _block)
+				{
+					Index begin = wordBegin + 1 + (Index)_block * kBlockSize;
+					Index end   = APT_MIN(begin + kBlockSize, wordEnd - 1);
+					for (Index word = begin; word < end; ++word)
+					{
+						reduceBits(word << 6, (word + 1) << 6, parentBegin, childBegin, _op);
+					}
+				},
+				_threadCount);
+		}
+
+	 // first/last words may be shared with the adjacent levels
+		reduceBits(parentBegin, APT_MIN((wordBegin + 1) << 6, parentEnd), parentBegin, childBegin, _op);
+		if (wordEnd - wordBegin > 1)
+		{
+			reduceBits((wordEnd - 1) << 6, parentEnd, parentBegin, childBegin, _op);
+		}
+	}
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tOp>
+void APT_QUADTREE_CLASS_DECL::reduceDirty(tOp&& _op, const Index* _nodeIndices, uint _count)
+{
+	Base::forEachDirtyAncestor(_nodeIndices, _count, [&](Index _parentIndex, int _parentLevel)
+		{
+			set(_parentIndex, (ReduceLanes((uint64)getChildMask(_parentIndex, _parentLevel), _op) & 1) != 0);
+		});
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tOp>
+uint64 APT_QUADTREE_CLASS_DECL::ReduceLanes(uint64 _bits, tOp& _op)
+{
+	return _op(_op(_bits, _bits >> 1), _op(_bits >> 2, _bits >> 3));
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+uint64 APT_QUADTREE_CLASS_DECL::CompactLanes(uint64 _bits)
+{
+	_bits &= 0x1111111111111111ull;
+	_bits = (_bits | (_bits >> 3))  & 0x0303030303030303ull;
+	_bits = (_bits | (_bits >> 6))  & 0x000f000f000f000full;
+	_bits = (_bits | (_bits >> 12)) & 0x000000ff000000ffull;
+	_bits = (_bits | (_bits >> 24)) & 0x000000000000ffffull;
+	return _bits;
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+uint64 APT_QUADTREE_CLASS_DECL::readBits(Index _bit) const
+{
+	Index  word  = _bit >> 6;
+	uint32 shift = (uint32)(_bit & 63);
+	uint64 ret   = m_bits[word] >> shift;
+	if (shift != 0 && word + 1 < (Index)m_bits.size())
+	{
+		ret |= m_bits[word + 1] << (64 - shift);
+	}
+	return ret;
+}
+
+APT_QUADTREE_TEMPLATE_DECL
+template <typename tOp>
+void APT_QUADTREE_CLASS_DECL::reduceBits(Index _bitBegin, Index _bitEnd, Index _parentBegin, Index _childBegin, tOp& _op)
+{
+	APT_STRICT_ASSERT(_bitBegin < _bitEnd && (_bitBegin >> 6) == ((_bitEnd - 1) >> 6));
+	const Index count = _bitEnd - _bitBegin;
+	const Index childBit = _childBegin + ((_bitBegin - _parentBegin) << 2);
+
+ // each 64 child bits produce 16 parent bits
+	uint64 value = 0;
+	for (Index i = 0; i * 16 < count; ++i)
+	{
+		value |= CompactLanes(ReduceLanes(readBits(childBit + i * 64), _op)) << (i * 16);
+	}
+
+	uint32  shift = (uint32)(_bitBegin & 63);
+	uint64  mask  = (count == 64 ? ~uint64(0) : ((uint64(1) << count) - 1)) << shift;
+	uint64& word  = m_bits[_bitBegin >> 6];
+	word = (word & ~mask) | ((value << shift) & mask);
+}
+
 #undef APT_QUADTREE_TEMPLATE_DECL
 #undef APT_QUADTREE_CLASS_DECL
 
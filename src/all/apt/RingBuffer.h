@@ -1,9 +1,11 @@
 #pragma once
 
 #include <apt/apt.h>
+#include <apt/math.h>
 #include <apt/memory.h>
 
-#include <cstring>
+#include <new>         // placement new
+#include <utility>     // std::move, std::forward
 
 namespace apt {
 
@@ -12,68 +14,109 @@ namespace apt {
 // New items are added to the back of the buffer via push_back(), overwriting
 // items at the front if size() == capacity().
 // Access via operator[] returns items between front() and back() in order. Use
-// data() to access the underying buffer.
+// getSpans() to access the items as (at most) 2 contiguous arrays, e.g.
+//
+//    RingBuffer<float>::Span spans[2];
+//    rb.getSpans(spans[0], spans[1]);
+//    for (auto& span : spans) {
+//       for (uint i = 0; i < span.m_size; ++i) { ... span.m_data[i] ... }
+//    }
+//
+// The storage is rounded up to a power of 2 so that indexing is a mask; the
+// capacity is exactly as requested.
 ////////////////////////////////////////////////////////////////////////////////
 template <typename tType>
-class RingBuffer
+class RingBuffer: private non_copyable<RingBuffer<tType> >
 {
 public:
 
+	template <typename tSpanType>
+	struct SpanT
+	{
+		tSpanType* m_data;
+		uint       m_size;
+	};
+	typedef SpanT<tType>       Span;
+	typedef SpanT<const tType> ConstSpan;
+
 	RingBuffer(uint _capacity = 2)
 		: m_buffer(0)
 		, m_front(0)
-		, m_back(0)
+		, m_size(0)
 		, m_capacity(0)
+		, m_mask(0)
 	{
 		reserve(_capacity);
 	}
 
 	~RingBuffer()
 	{
+		clear();
 		APT_FREE_ALIGNED(m_buffer);
 	}
 
+	// Change the capacity. Order is preserved; if _capacity < size() the oldest items are removed.
 	void reserve(uint _capacity)
 	{
-		tType* newBuffer = (tType*)APT_REALLOC_ALIGNED(m_buffer, _capacity * sizeof(tType), alignof(tType));
-
-		tType* end = m_buffer + _capacity;
-		if (m_front >= end) {
-			m_front = end - 1;
-		} else {
-			m_front = newBuffer + (m_front - m_buffer);
+		APT_ASSERT(_capacity > 0);
+		while (m_size > _capacity) {
+			pop_front();
 		}
-		if (m_back >= end) {
-			m_back = m_buffer;
-		} else {
-			m_back = newBuffer + (m_back - m_buffer);
+		uint storageSize = 1;
+		while (storageSize < _capacity) {
+			storageSize <<= 1;
+		}
+		if (storageSize != m_mask + 1 || !m_buffer) {
+			tType* newBuffer = (tType*)APT_MALLOC_ALIGNED(sizeof(tType) * storageSize, alignof(tType));
+			for (uint i = 0; i < m_size; ++i) {
+				tType& v = at(i);
+				new(&newBuffer[i]) tType(std::move(v));
+				v.~tType();
+			}
+			APT_FREE_ALIGNED(m_buffer);
+			m_buffer = newBuffer;
+			m_front  = 0;
+			m_mask   = storageSize - 1;
 		}
-
 		m_capacity = _capacity;
-		m_buffer = newBuffer;
 	}
 
-	void push_back(const tType& _v)
+	void push_back(const tType& _v)            { emplace_back(_v); }
+	void push_back(tType&& _v)                 { emplace_back(std::move(_v)); }
+
+	template <typename... tArgs>
+	tType& emplace_back(tArgs&&... _args)
 	{
-		if_likely (!empty()) {
-			incBack();
+		if_unlikely (m_size == m_capacity) {
+			pop_front();
 		}
-		*m_back = _v;
-		m_size = APT_MIN(m_size + 1, m_capacity);
+		tType* ret = &m_buffer[(m_front + m_size) & m_mask];
+		new(ret) tType(std::forward<tArgs>(_args)...);
+		++m_size;
+		return *ret;
 	}
 
 	void pop_front()
 	{
 		APT_ASSERT(m_size > 0);
-		(*m_front).~tType();
-		incFront();
+		m_buffer[m_front].~tType();
+		m_front = (m_front + 1) & m_mask;
 		--m_size;
-	};
+	}
+
+	// Remove all items.
+	void clear()
+	{
+		while (m_size > 0) {
+			pop_front();
+		}
+		m_front = 0;
+	}
 
-	tType&       front()                   { return *m_front; }
-	const tType& front() const             { return *m_front; }
-	tType&       back()                    { return *m_back; }
-	const tType& back() const              { return *m_back; }
+	tType&       front()                   { APT_ASSERT(!empty()); return at(0); }
+	const tType& front() const             { APT_ASSERT(!empty()); return at(0); }
+	tType&       back()                    { APT_ASSERT(!empty()); return at(m_size - 1); }
+	const tType& back() const              { APT_ASSERT(!empty()); return at(m_size - 1); }
 
 	bool         empty() const             { return size() == 0; }
 	uint         size() const              { return m_size; }
@@ -84,48 +127,41 @@ public:
 	const tType* data() const              { return m_buffer; }
 
 	// Access elements between front() and back().
-	tType&       operator[](uint _i)       { return at(_i); }
-	const tType& operator[](uint _i) const { return at(_i); } 
+	tType&       operator[](uint _i)       { APT_STRICT_ASSERT(_i < m_size); return at(_i); }
+	const tType& operator[](uint _i) const { APT_STRICT_ASSERT(_i < m_size); return at(_i); }
 
-private:
-	tType* m_buffer;   // Storage.
-	tType* m_front;    // Oldest item in the buffer.
-	tType* m_back;     // Newest item in the buffer.
-	uint   m_size;     // Number of items in the buffer;
-	uint   m_capacity; // Max number of items in the buffer.
-
-	void incFront()
+	// Return items between front() and back() as 2 contiguous ranges; first_ contains the oldest items. second_.m_size is 0 if the
+	// items don't wrap.
+	void getSpans(Span& first_, Span& second_)
 	{
-		tType* end = m_buffer + m_capacity;
-		if_unlikely (++m_front >= end) {
-			m_front = m_buffer;
-		}
+		first_.m_data   = m_buffer + m_front;
+		first_.m_size   = APT_MIN(m_size, m_mask + 1 - m_front);
+		second_.m_data  = m_buffer;
+		second_.m_size  = m_size - first_.m_size;
 	}
-
-	void incBack()
+	void getSpans(ConstSpan& first_, ConstSpan& second_) const
 	{
-		tType* end = m_buffer + m_capacity;
-		if_unlikely (++m_back >= end) {
-			m_back = m_buffer;
-		}
-		if_likely (m_back == m_front) {
-			if_unlikely (++m_front >= end) {
-				m_front = m_buffer;
-			}
-		}
+		first_.m_data   = m_buffer + m_front;
+		first_.m_size   = APT_MIN(m_size, m_mask + 1 - m_front);
+		second_.m_data  = m_buffer;
+		second_.m_size  = m_size - first_.m_size;
 	}
 
+private:
+	tType* m_buffer;   // Storage, m_mask + 1 items.
+	uint   m_front;    // Index of the oldest item in the buffer.
+	uint   m_size;     // Number of items in the buffer.
+	uint   m_capacity; // Max number of items in the buffer.
+	uint   m_mask;     // Storage size - 1 (storage size is a power of 2).
 
 	tType& at(uint _i)
 	{
-		tType* ret = m_front + _i;
-		tType* end = m_buffer + m_capacity;
-		if (ret >= end) {
-			_i -= end - m_front;
-			ret = m_buffer + _i;
-		}
-		APT_ASSERT(ret < end);
-		return *ret;
+		return m_buffer[(m_front + _i) & m_mask];
+	}
+
+	const tType& at(uint _i) const
+	{
+		return m_buffer[(m_front + _i) & m_mask];
 	}
 
 };
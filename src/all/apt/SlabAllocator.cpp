@@ -0,0 +1,302 @@
+#include <apt/SlabAllocator.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace apt {
+
+namespace {
+
+// All state is zero-initialized static storage (no constructors), SlabAllocator may be called during static initialization via global
+// new.
+
+const uint kSizeClasses[SlabAllocator::kSizeClassCount] =
+{
+	16,  32,  48,  64,  80,  96,  112, 128,  // 16 byte steps
+	160, 192, 224, 256,                      // 4 steps per power of 2
+	320, 384, 448, 512,
+	640, 768, 896, 1024,
+};
+
+inline uint GetSizeClass(uint _size)
+{
+	APT_ASSERT(_size <= SlabAllocator::kMaxSize);
+	if (_size <= 128) {
+		return _size == 0 ? 0 : (_size + 15) / 16 - 1;
+	}
+	uint s = _size - 1;
+	uint log2 = 7;
+	while ((s >> (log2 + 1)) != 0) {
+		++log2;
+	}
+	return 8 + (log2 - 7) * 4 + ((s >> (log2 - 2)) & 3);
+}
+
+struct SpinLock
+{
+	std::atomic<int> m_locked;
+
+	void lock()
+	{
+		while (m_locked.exchange(1, std::memory_order_acquire)) {
+			while (m_locked.load(std::memory_order_relaxed)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void unlock()
+	{
+		m_locked.store(0, std::memory_order_release);
+	}
+};
+
+struct FreeBlock
+{
+	FreeBlock* m_next;
+};
+
+// Shared state per size class.
+struct alignas(APT_DCACHE_LINE_SIZE) Central
+{
+	SpinLock   m_lock;
+	FreeBlock* m_freeList;
+	char*      m_bump;     // Next uncarved block in the current page.
+	char*      m_bumpEnd;
+};
+Central s_central[SlabAllocator::kSizeClassCount];
+
+// Page registry, maps page index (ptr / kPageSize) -> size class. Open addressing, insert only (pages are never released) hence
+// lookups are lock free. Entries are (page index << 8) | size class, 0 is empty.
+const uint kRegistrySize = SlabAllocator::kMaxPageCount * 2;
+std::atomic<uint64> s_registry[kRegistrySize];
+
+SpinLock          s_pageLock; // Guards s_nextPage, s_pageEnd and registry inserts.
+char*             s_nextPage;
+char*             s_pageEnd;
+std::atomic<uint> s_pageCount;
+
+inline uint64 GetPageIndex(const void* _ptr)
+{
+	return (uint64)_ptr / SlabAllocator::kPageSize;
+}
+
+inline uint GetRegistryHash(uint64 _pageIndex)
+{
+	return (uint)((_pageIndex * 0x9e3779b97f4a7c15ull) >> 32) & (kRegistrySize - 1);
+}
+
+// Return the size class of the page containing _ptr, or -1 if _ptr isn't from a slab page.
+inline int FindPage(const void* _ptr)
+{
+	uint64 pageIndex = GetPageIndex(_ptr);
+	for (uint i = GetRegistryHash(pageIndex);; i = (i + 1) & (kRegistrySize - 1)) {
+		uint64 entry = s_registry[i].load(std::memory_order_acquire);
+		if (entry == 0) {
+			return -1;
+		}
+		if ((entry >> 8) == pageIndex) {
+			return (int)(entry & 0xff);
+		}
+	}
+}
+
+// Return a new page for _sizeClass, or nullptr.
+char* NewPage(uint _sizeClass)
+{
+	std::lock_guard<SpinLock> lock(s_pageLock);
+	if (s_nextPage == s_pageEnd) {
+		if (s_pageCount.load(std::memory_order_relaxed) + SlabAllocator::kPagesPerChunk > SlabAllocator::kMaxPageCount) {
+			return nullptr;
+		}
+	 // system malloc, not APT_MALLOC; over allocate by 1 page to align the chunk
+		char* chunk = (char*)::malloc((SlabAllocator::kPagesPerChunk + 1) * SlabAllocator::kPageSize);
+		if (!chunk) {
+			return nullptr;
+		}
+		s_nextPage = (char*)(((uint)chunk + SlabAllocator::kPageSize - 1) & ~(uint)(SlabAllocator::kPageSize - 1));
+		s_pageEnd  = s_nextPage + SlabAllocator::kPagesPerChunk * SlabAllocator::kPageSize;
+	}
+	char* ret = s_nextPage;
+	s_nextPage += SlabAllocator::kPageSize;
+
+	uint64 pageIndex = GetPageIndex(ret);
+	uint i = GetRegistryHash(pageIndex);
+	while (s_registry[i].load(std::memory_order_relaxed) != 0) {
+		i = (i + 1) & (kRegistrySize - 1);
+	}
+	s_registry[i].store((pageIndex << 8) | _sizeClass, std::memory_order_release);
+	s_pageCount.fetch_add(1, std::memory_order_relaxed);
+
+	return ret;
+}
+
+// Pop up to _count blocks from the shared free list for _sizeClass (carve from a new page if required), push them onto _list_. Return
+// the number of blocks moved.
+uint CentralAlloc(uint _sizeClass, uint _count, FreeBlock*& _list_)
+{
+	Central& central = s_central[_sizeClass];
+	uint size = kSizeClasses[_sizeClass];
+	uint ret = 0;
+	std::lock_guard<SpinLock> lock(central.m_lock);
+	while (ret < _count && central.m_freeList) {
+		FreeBlock* block = central.m_freeList;
+		central.m_freeList = block->m_next;
+		block->m_next = _list_;
+		_list_ = block;
+		++ret;
+	}
+	while (ret < _count) {
+		if (central.m_bump == central.m_bumpEnd) {
+			char* page = NewPage(_sizeClass);
+			if (!page) {
+				break;
+			}
+			central.m_bump    = page;
+			central.m_bumpEnd = page + (SlabAllocator::kPageSize / size) * size;
+		}
+		FreeBlock* block = (FreeBlock*)central.m_bump;
+		central.m_bump += size;
+		block->m_next = _list_;
+		_list_ = block;
+		++ret;
+	}
+	return ret;
+}
+
+// Push the list [_head, _tail] onto the shared free list for _sizeClass.
+void CentralFree(uint _sizeClass, FreeBlock* _head, FreeBlock* _tail)
+{
+	Central& central = s_central[_sizeClass];
+	std::lock_guard<SpinLock> lock(central.m_lock);
+	_tail->m_next = central.m_freeList;
+	central.m_freeList = _head;
+}
+
+struct ThreadCache
+{
+	enum State { State_Uninitialized, State_Active, State_Destroyed };
+
+	FreeBlock* m_lists[SlabAllocator::kSizeClassCount];
+	uint       m_counts[SlabAllocator::kSizeClassCount];
+	State      m_state;
+};
+thread_local ThreadCache s_threadCache; // POD, remains accessible after s_threadCacheFlush is destroyed
+
+// Flush s_threadCache on thread exit.
+struct ThreadCacheFlush
+{
+	ThreadCacheFlush()  { s_threadCache.m_state = ThreadCache::State_Active; }
+	~ThreadCacheFlush() { SlabAllocator::FlushThreadCache(); s_threadCache.m_state = ThreadCache::State_Destroyed; }
+};
+thread_local ThreadCacheFlush s_threadCacheFlush;
+
+// Return the calling thread's cache, or nullptr during thread exit.
+inline ThreadCache* GetThreadCache()
+{
+	ThreadCache* ret = &s_threadCache;
+	if_unlikely (ret->m_state != ThreadCache::State_Active) {
+		if (ret->m_state == ThreadCache::State_Destroyed) {
+			return nullptr;
+		}
+		(void)&s_threadCacheFlush; // first use, construct the flush object
+	}
+	return ret;
+}
+
+// Move _count blocks from the front of the cache list for _sizeClass to the shared free list.
+void Spill(ThreadCache& _cache_, uint _sizeClass, uint _count)
+{
+	APT_ASSERT(_count > 0 && _count <= _cache_.m_counts[_sizeClass]);
+	FreeBlock* head = _cache_.m_lists[_sizeClass];
+	FreeBlock* tail = head;
+	for (uint i = 1; i < _count; ++i) {
+		tail = tail->m_next;
+	}
+	_cache_.m_lists[_sizeClass] = tail->m_next;
+	_cache_.m_counts[_sizeClass] -= _count;
+	CentralFree(_sizeClass, head, tail);
+}
+
+} // namespace
+
+// PUBLIC
+
+void* SlabAllocator::Alloc(uint _size)
+{
+	uint sizeClass = GetSizeClass(_size);
+	ThreadCache* cache = GetThreadCache();
+	if_unlikely (!cache) {
+		FreeBlock* ret = nullptr;
+		CentralAlloc(sizeClass, 1, ret);
+		return ret;
+	}
+	FreeBlock*& list = cache->m_lists[sizeClass];
+	if_unlikely (!list) {
+		cache->m_counts[sizeClass] = CentralAlloc(sizeClass, kBatchSize, list);
+		if_unlikely (!list) {
+			return nullptr;
+		}
+	}
+	FreeBlock* ret = list;
+	list = ret->m_next;
+	--cache->m_counts[sizeClass];
+	return ret;
+}
+
+void SlabAllocator::Free(void* _ptr)
+{
+	if (!_ptr) {
+		return;
+	}
+	int sizeClass = FindPage(_ptr);
+	APT_ASSERT_MSG(sizeClass >= 0, "SlabAllocator::Free: %p was not allocated by SlabAllocator", _ptr);
+	FreeBlock* block = (FreeBlock*)_ptr;
+	ThreadCache* cache = GetThreadCache();
+	if_unlikely (!cache) {
+		CentralFree(sizeClass, block, block);
+		return;
+	}
+	if_unlikely (cache->m_counts[sizeClass] == kBatchSize * 2) {
+		Spill(*cache, sizeClass, kBatchSize);
+	}
+	block->m_next = cache->m_lists[sizeClass];
+	cache->m_lists[sizeClass] = block;
+	++cache->m_counts[sizeClass];
+}
+
+bool SlabAllocator::IsFromSlab(const void* _ptr)
+{
+	return FindPage(_ptr) >= 0;
+}
+
+uint SlabAllocator::GetBlockSize(const void* _ptr)
+{
+	int sizeClass = FindPage(_ptr);
+	APT_ASSERT(sizeClass >= 0);
+	return kSizeClasses[sizeClass];
+}
+
+uint SlabAllocator::GetSizeClassSize(uint _size)
+{
+	return kSizeClasses[GetSizeClass(_size)];
+}
+
+void SlabAllocator::FlushThreadCache()
+{
+	ThreadCache& cache = s_threadCache;
+	for (uint i = 0; i < kSizeClassCount; ++i) {
+		if (cache.m_counts[i] > 0) {
+			Spill(cache, i, cache.m_counts[i]);
+		}
+	}
+}
+
+uint SlabAllocator::GetPageCount()
+{
+	return s_pageCount.load(std::memory_order_relaxed);
+}
+
+} // namespace apt
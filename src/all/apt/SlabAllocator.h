@@ -0,0 +1,60 @@
+#pragma once
+
+#include <apt/apt.h>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// SlabAllocator
+// General purpose allocator for small objects (up to kMaxSize bytes). Sizes are
+// rounded up to one of kSizeClassCount size classes; each size class allocates
+// from slabs of kPageSize bytes which are carved into equal sized blocks.
+// Blocks are 16 byte aligned.
+//
+// Each thread caches free blocks per size class, alloc()/free() are serviced
+// from the cache without any synchronization. The cache is refilled from/spilled
+// to the shared free list in batches of kBatchSize, which is the only time a
+// lock is taken. Blocks may be freed on a different thread to the one which
+// allocated them.
+//
+// Define APT_ENABLE_SLAB_ALLOCATOR (see config.h) to use SlabAllocator as the
+// implementation of APT_MALLOC et al. (and hence global new and EASTL
+// containers) for sizes <= kMaxSize; larger sizes and aligned allocations fall
+// through to the system allocator.
+//
+// Slab pages are never returned to the system.
+////////////////////////////////////////////////////////////////////////////////
+class SlabAllocator
+{
+public:
+	static const uint kMaxSize          = 1024;
+	static const uint kSizeClassCount   = 20;
+	static const uint kPageSize         = 64 * 1024;
+	static const uint kPagesPerChunk    = 16;        // Pages are reserved from the system in chunks of kPagesPerChunk.
+	static const uint kMaxPageCount     = 64 * 1024; // Max total slab memory is kMaxPageCount * kPageSize (4GB).
+	static const uint kBatchSize        = 32;        // Each thread caches at most 2 * kBatchSize blocks per size class.
+
+	// Return a ptr to at least _size bytes (_size must be <= kMaxSize), or nullptr if kMaxPageCount was exceeded or the system
+	// allocation failed.
+	static void* Alloc(uint _size);
+
+	// Release a block previously returned by Alloc().
+	static void  Free(void* _ptr);
+
+	// Return true if _ptr was returned by Alloc(). Lock free, O(1).
+	static bool  IsFromSlab(const void* _ptr);
+
+	// Return the usable size of a block returned by Alloc() (the size of its size class).
+	static uint  GetBlockSize(const void* _ptr);
+
+	// Round _size up to the nearest size class.
+	static uint  GetSizeClassSize(uint _size);
+
+	// Return any blocks cached by the calling thread to the shared free lists. This is called automatically on thread exit.
+	static void  FlushThreadCache();
+
+	// Number of slab pages allocated.
+	static uint  GetPageCount();
+};
+
+} // namespace apt
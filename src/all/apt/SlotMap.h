@@ -0,0 +1,189 @@
+#pragma once
+
+#include <apt/apt.h>
+
+#include <EASTL/allocator.h>
+#include <EASTL/vector.h>
+
+#include <utility> // std::move, std::forward
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// SlotMap
+// Associative container which maps stable handles to densely packed values.
+// Insert, erase and lookup by handle are O(1); the live values are stored
+// contiguously (in no particular order) for linear iteration:
+//
+//    SlotMap<Foo> foos;
+//    SlotMap<Foo>::Handle h = foos.insert(Foo());
+//    if (Foo* foo = foos.find(h)) { ... }  // nullptr if h was erased
+//    for (Foo& foo : foos) { ... }
+//    foos.erase(h);
+//
+// A handle is an index into the slot array plus a generation (tHandle = uint32
+// gives 24 index bits + 8 generation bits, uint64 gives 32 + 32). erase()
+// increments the slot's generation, hence stale handles fail lookup (until the
+// generation wraps). 0 is never a valid handle.
+//
+// Free slots form an intrusive free list (as in MemoryPool). erase() moves the
+// last value into the erased position, so ptrs/iterators to values are
+// invalidated by erase() and insert(); handles are not.
+////////////////////////////////////////////////////////////////////////////////
+template <typename tType, typename tHandle, typename tAllocator>
+class SlotMap
+{
+public:
+	typedef tHandle    Handle;
+	typedef tType      value_type;
+	typedef uint       size_type;
+	typedef tAllocator allocator_type;
+	typedef tType*       iterator;
+	typedef const tType* const_iterator;
+
+	static const Handle kInvalidHandle = 0;
+	static const uint   kIndexBits     = sizeof(Handle) == 4 ? 24 : 32;
+	static const uint   kMaxSize       = (uint)((Handle(1) << kIndexBits) - 1);
+
+	SlotMap(uint _reserve = 0, const tAllocator& _allocator = tAllocator())
+		: m_values(_allocator)
+		, m_valueSlots(_allocator)
+		, m_slots(_allocator)
+		, m_freeList(kFreeListEnd)
+	{
+		reserve(_reserve);
+	}
+
+	void reserve(uint _n)
+	{
+		m_values.reserve(_n);
+		m_valueSlots.reserve(_n);
+		m_slots.reserve(_n);
+	}
+
+	// Insert a new value, return its handle.
+	Handle insert(const tType& _v)                { return emplace(_v); }
+	Handle insert(tType&& _v)                     { return emplace(std::move(_v)); }
+
+	template <typename... tArgs>
+	Handle emplace(tArgs&&... _args)
+	{
+		uint32 slotIndex;
+		if (m_freeList != kFreeListEnd) {
+			slotIndex  = m_freeList;
+			m_freeList = m_slots[slotIndex].m_index;
+		} else {
+			APT_ASSERT_MSG(m_slots.size() < kMaxSize, "SlotMap: exceeded max size");
+			slotIndex = (uint32)m_slots.size();
+			m_slots.push_back(Slot{ 0, 1 });
+		}
+		Slot& slot = m_slots[slotIndex];
+		slot.m_index = (uint32)m_values.size();
+		m_values.emplace_back(std::forward<tArgs>(_args)...);
+		m_valueSlots.push_back(slotIndex);
+		return MakeHandle(slotIndex, slot.m_generation);
+	}
+
+	// Erase the value referenced by _handle. Return false if _handle is invalid.
+	bool erase(Handle _handle)
+	{
+		uint32 slotIndex = GetIndex(_handle);
+		if (!isValid(_handle)) {
+			return false;
+		}
+		Slot& slot = m_slots[slotIndex];
+		uint32 last = (uint32)m_values.size() - 1;
+		if (slot.m_index != last) {
+		 // move the last value into the erased position
+			m_values[slot.m_index] = std::move(m_values[last]);
+			m_valueSlots[slot.m_index] = m_valueSlots[last];
+			m_slots[m_valueSlots[last]].m_index = slot.m_index;
+		}
+		m_values.pop_back();
+		m_valueSlots.pop_back();
+
+		slot.m_generation = NextGeneration(slot.m_generation);
+		slot.m_index = m_freeList;
+		m_freeList = slotIndex;
+		return true;
+	}
+
+	// Erase all values. All handles become invalid.
+	void clear()
+	{
+		for (uint32 slotIndex : m_valueSlots) {
+			Slot& slot = m_slots[slotIndex];
+			slot.m_generation = NextGeneration(slot.m_generation);
+			slot.m_index = m_freeList;
+			m_freeList = slotIndex;
+		}
+		m_values.clear();
+		m_valueSlots.clear();
+	}
+
+	// Return true if _handle references a value in the map.
+	bool isValid(Handle _handle) const
+	{
+		uint32 slotIndex = GetIndex(_handle);
+		return slotIndex < m_slots.size() && m_slots[slotIndex].m_generation == GetGeneration(_handle) && _handle != kInvalidHandle;
+	}
+
+	// Return a ptr to the value referenced by _handle, or nullptr if _handle is invalid.
+	tType*       find(Handle _handle)             { return isValid(_handle) ? &m_values[m_slots[GetIndex(_handle)].m_index] : nullptr; }
+	const tType* find(Handle _handle) const       { return isValid(_handle) ? &m_values[m_slots[GetIndex(_handle)].m_index] : nullptr; }
+
+	// _handle must be valid.
+	tType&       operator[](Handle _handle)       { APT_ASSERT(isValid(_handle)); return m_values[m_slots[GetIndex(_handle)].m_index]; }
+	const tType& operator[](Handle _handle) const { APT_ASSERT(isValid(_handle)); return m_values[m_slots[GetIndex(_handle)].m_index]; }
+
+	// Return the handle of the value at _i in the dense array (_i < size()).
+	Handle getHandle(uint _i) const               { uint32 slotIndex = m_valueSlots[_i]; return MakeHandle(slotIndex, m_slots[slotIndex].m_generation); }
+
+	uint           size() const                   { return (uint)m_values.size(); }
+	bool           empty() const                  { return m_values.empty(); }
+
+	// Dense array of values.
+	tType*         data()                         { return m_values.data(); }
+	const tType*   data() const                   { return m_values.data(); }
+	iterator       begin()                        { return m_values.begin(); }
+	const_iterator begin() const                  { return m_values.begin(); }
+	iterator       end()                          { return m_values.end(); }
+	const_iterator end() const                    { return m_values.end(); }
+
+private:
+	static const uint32 kFreeListEnd      = ~uint32(0);
+	static const Handle kIndexMask        = (Handle(1) << kIndexBits) - 1;
+	static const uint32 kGenerationMask   = (uint32)(~Handle(0) >> kIndexBits);
+
+	struct Slot
+	{
+		uint32 m_index;      // Index into m_values if the slot is in use, else the next free slot.
+		uint32 m_generation; // Never 0.
+	};
+
+	eastl::vector<tType,  tAllocator> m_values;
+	eastl::vector<uint32, tAllocator> m_valueSlots; // Slot index per value.
+	eastl::vector<Slot,   tAllocator> m_slots;
+	uint32                            m_freeList;
+
+	static Handle MakeHandle(uint32 _index, uint32 _generation) { return ((Handle)_generation << kIndexBits) | (Handle)_index; }
+	static uint32 GetIndex(Handle _handle)                      { return (uint32)(_handle & kIndexMask); }
+	static uint32 GetGeneration(Handle _handle)                 { return (uint32)(_handle >> kIndexBits); }
+	static uint32 NextGeneration(uint32 _generation)            { _generation = (_generation + 1) & kGenerationMask; return _generation ? _generation : 1; }
+
+}; // class SlotMap
+
+template <typename tType, typename tHandle, typename tAllocator>
+const tHandle SlotMap<tType, tHandle, tAllocator>::kInvalidHandle;
+template <typename tType, typename tHandle, typename tAllocator>
+const uint SlotMap<tType, tHandle, tAllocator>::kIndexBits;
+template <typename tType, typename tHandle, typename tAllocator>
+const uint SlotMap<tType, tHandle, tAllocator>::kMaxSize;
+template <typename tType, typename tHandle, typename tAllocator>
+const uint32 SlotMap<tType, tHandle, tAllocator>::kFreeListEnd;
+template <typename tType, typename tHandle, typename tAllocator>
+const tHandle SlotMap<tType, tHandle, tAllocator>::kIndexMask;
+template <typename tType, typename tHandle, typename tAllocator>
+const uint32 SlotMap<tType, tHandle, tAllocator>::kGenerationMask;
+
+} // namespace apt
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+#include <apt/Octree.h>
+
+#include <EASTL/fixed_vector.h>
+#include <EASTL/hash_map.h>
+
+namespace apt {
+
+///////////////////////////////////////////////////////////////////////////////
+// SparseOctree
+// Linear octree which stores only materialized nodes, in a hash table keyed
+// by node index (i.e. level offset + Morton code, see Octree.h). Use this
+// instead of Octree when most of the nodes at the finer levels are empty, e.g.
+// a 64 bit index with 21 levels.
+//
+// Indexing, FindNeighbor(), getParentIndex() etc. are the same as Octree.
+// Materializing a node (via operator[]) also materializes its ancestors, hence
+// every materialized node is reachable from the root. Each node stores a mask
+// of its materialized children so that traverse() only visits materialized
+// nodes without probing the table for absent children.
+//
+//    SparseOctree<uint64, VoxelBrick*> tree(21);
+//    tree[SparseOctree<uint64, VoxelBrick*>::ToIndex(x, y, z, 20)] = brick;
+//    tree.traverse([](uint64 _nodeIndex, int _nodeLevel) { ... return true; });
+///////////////////////////////////////////////////////////////////////////////
+template <typename tIndex, typename tNode, typename tAllocator>
+class SparseOctree: public internal::OctreeBase<tIndex>
+{
+	typedef internal::OctreeBase<tIndex> Base;
+	using Base::m_levelCount;
+
+	struct Entry
+	{
+		tNode  m_node;
+		uint32 m_childMask; // Bit i is set if child i is materialized.
+	};
+	typedef eastl::hash_map<tIndex, Entry, eastl::hash<tIndex>, eastl::equal_to<tIndex>, tAllocator> Map;
+
+	Map   m_map;
+	tNode m_init;
+
+public:
+	typedef tIndex     Index;
+	typedef tNode      Node;
+	typedef tAllocator Allocator;
+	using Base::Index_Invalid;
+	using Base::GetAbsoluteMaxLevelCount;
+	using Base::FindNeighbor;
+	using Base::FindLevel;
+	using Base::getParentIndex;
+	using Base::getFirstChildIndex;
+
+	// _init is the value of newly materialized nodes.
+	SparseOctree(int _levelCount = GetAbsoluteMaxLevelCount(), Node _init = Node(), const Allocator& _allocator = Allocator());
+
+	// Depth-first traversal of the materialized nodes starting at _root, call _onVisit for each node.
+	// _onVisit should be of the form ()(tIndex _nodeIndex, int _nodeLevel) -> bool.
+	// Traversal proceeds to a node's children only if _onVisit returns true.
+	template<typename OnVisit>
+	void        traverse(OnVisit&& _onVisit, Index _rootIndex = 0) const;
+
+	// Find a materialized neighbor at _offsetX, _offsetY, _offsetZ from the given node (search up the tree until a materialized node is
+	// found).
+	Index       findValidNeighbor(Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY, int _offsetZ) const;
+
+	// Return a ptr to the node at _index, or nullptr if the node isn't materialized.
+	Node*       find(Index _index)                                                           { auto it = m_map.find(_index); return it == m_map.end() ? nullptr : &it->second.m_node; }
+	const Node* find(Index _index) const                                                     { auto it = m_map.find(_index); return it == m_map.end() ? nullptr : &it->second.m_node; }
+
+	// Return the node at _index, materialize it (and its ancestors) if necessary.
+	Node&       operator[](Index _index);
+
+	// Erase the node at _index and its subtree. Return the number of nodes erased.
+	Index       erase(Index _index);
+
+	// Erase all nodes.
+	void        clear()                                                                      { m_map.clear(); }
+
+	// Return a mask with bit i set if child i of _parentIndex is materialized.
+	uint32      getChildMask(Index _parentIndex) const                                       { auto it = m_map.find(_parentIndex); return it == m_map.end() ? 0 : it->second.m_childMask; }
+
+	// Number of materialized nodes.
+	Index       getMaterializedCount() const                                                 { return (Index)m_map.size(); }
+
+	// Spatial queries, as per Octree but only materialized nodes are returned.
+	Index       queryAabb(const vec3& _rootMin, const vec3& _rootMax, const vec3& _min, const vec3& _max, int _level, Index* out_, Index _maxCount) const;
+	Index       querySphere(const vec3& _rootMin, const vec3& _rootMax, const vec3& _center, float _radius, int _level, Index* out_, Index _maxCount) const;
+	Index       queryFrustum(const vec3& _rootMin, const vec3& _rootMax, const vec4* _planes, int _planeCount, int _level, Index* out_, Index _maxCount) const;
+};
+
+
+/*******************************************************************************
+
+                                  SparseOctree
+
+*******************************************************************************/
+
+#define APT_SPARSE_OCTREE_TEMPLATE_DECL template <typename tIndex, typename tNode, typename tAllocator>
+#define APT_SPARSE_OCTREE_CLASS_DECL    SparseOctree<tIndex, tNode, tAllocator>
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+APT_SPARSE_OCTREE_CLASS_DECL::SparseOctree(int _levelCount, Node _init, const Allocator& _allocator)
+	: Base(_levelCount)
+	, m_map(_allocator)
+	, m_init(_init)
+{
+}
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+tNode& APT_SPARSE_OCTREE_CLASS_DECL::operator[](Index _index)
+{
+	auto it = m_map.find(_index);
+	if (it != m_map.end())
+	{
+		return it->second.m_node;
+	}
+	int level = FindLevel(_index);
+	APT_ASSERT(level >= 0 && level < m_levelCount);
+	Entry& ret = m_map.insert(eastl::make_pair(_index, Entry{ m_init, 0 })).first->second;
+
+ // materialize ancestors until one already exists, set the child mask bits on the way up
+	Index childIndex = _index;
+	for (int childLevel = level; childLevel > 0; --childLevel)
+	{
+		Index parentIndex = getParentIndex(childIndex, childLevel);
+		uint32 childBit = 1u << (uint32)(childIndex - getFirstChildIndex(parentIndex, childLevel - 1));
+		auto parent = m_map.find(parentIndex);
+		if (parent != m_map.end())
+		{
+			parent->second.m_childMask |= childBit;
+			break;
+		}
+		m_map.insert(eastl::make_pair(parentIndex, Entry{ m_init, childBit }));
+		childIndex = parentIndex;
+	}
+	return ret.m_node; // hash_map nodes are stable, ret is valid after subsequent inserts
+}
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+tIndex APT_SPARSE_OCTREE_CLASS_DECL::erase(Index _index)
+{
+	auto it = m_map.find(_index);
+	if (it == m_map.end())
+	{
+		return 0;
+	}
+	int level = FindLevel(_index);
+	if (level > 0)
+	{
+		Index parentIndex = getParentIndex(_index, level);
+		auto parent = m_map.find(parentIndex);
+		APT_ASSERT(parent != m_map.end());
+		parent->second.m_childMask &= ~(1u << (uint32)(_index - getFirstChildIndex(parentIndex, level - 1)));
+	}
+
+	Index ret = 0;
+	struct NodeAddr { Index m_index; int m_level; };
+	eastl::fixed_vector<NodeAddr, GetAbsoluteMaxLevelCount() * 8> tstack;
+	tstack.push_back({ _index, level });
+	while (!tstack.empty())
+	{
+		NodeAddr node = tstack.back();
+		tstack.pop_back();
+		auto nodeIt = m_map.find(node.m_index);
+		Index firstChildIndex = getFirstChildIndex(node.m_index, node.m_level);
+		for (uint32 mask = nodeIt->second.m_childMask; mask != 0; mask &= mask - 1)
+		{
+			tstack.push_back({ firstChildIndex + (Index)FindFirstSet(mask), node.m_level + 1 });
+		}
+		m_map.erase(nodeIt);
+		++ret;
+	}
+	return ret;
+}
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+tIndex APT_SPARSE_OCTREE_CLASS_DECL::findValidNeighbor(Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY, int _offsetZ) const
+{
+	Index ret = FindNeighbor(_nodeIndex, _nodeLevel, _offsetX, _offsetY, _offsetZ); // get neighbor index at the same level
+	while (ret != Index_Invalid && m_map.find(ret) == m_map.end()) // search up the tree until a materialized node is found
+	{
+		ret = getParentIndex(ret, _nodeLevel--);
+	}
+	return ret;
+}
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+template<typename OnVisit>
+void APT_SPARSE_OCTREE_CLASS_DECL::traverse(OnVisit&& _onVisit, Index _root) const
+{
+	struct NodeAddr { Index m_index; int m_level; uint32 m_childMask; }; // store level in the stack, avoid calling FindLevel()
+	eastl::fixed_vector<NodeAddr, GetAbsoluteMaxLevelCount() * 8> tstack; // depth-first traversal has a small upper limit on the stack size
+	auto root = m_map.find(_root);
+	if (root == m_map.end())
+	{
+		return;
+	}
+	tstack.push_back({ _root, FindLevel(_root), root->second.m_childMask });
+	while (!tstack.empty())
+	{
+		NodeAddr node = tstack.back();
+		tstack.pop_back();
+		if (eastl::forward<OnVisit>(_onVisit)(node.m_index, node.m_level) && node.m_childMask != 0)
+		{
+			Index firstChildIndex = getFirstChildIndex(node.m_index, node.m_level);
+			for (uint32 mask = node.m_childMask; mask != 0; mask &= mask - 1)
+			{
+				Index childIndex = firstChildIndex + (Index)FindFirstSet(mask);
+				tstack.push_back({ childIndex, node.m_level + 1, m_map.find(childIndex)->second.m_childMask });
+			}
+		}
+	}
+}
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+tIndex APT_SPARSE_OCTREE_CLASS_DECL::queryAabb(const vec3& _rootMin, const vec3& _rootMax, const vec3& _min, const vec3& _max, int _level, Index* out_, Index _maxCount) const
+{
+	if (m_map.find(0) == m_map.end())
+	{
+		return 0;
+	}
+	return Base::template query<false>(internal::SpatialAabb<3>(_min, _max), _rootMin, _rootMax, _level, [this](Index _nodeIndex, int) { return getChildMask(_nodeIndex); }, out_, _maxCount);
+}
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+tIndex APT_SPARSE_OCTREE_CLASS_DECL::querySphere(const vec3& _rootMin, const vec3& _rootMax, const vec3& _center, float _radius, int _level, Index* out_, Index _maxCount) const
+{
+	if (m_map.find(0) == m_map.end())
+	{
+		return 0;
+	}
+	return Base::template query<false>(internal::SpatialSphere<3>(_center, _radius), _rootMin, _rootMax, _level, [this](Index _nodeIndex, int) { return getChildMask(_nodeIndex); }, out_, _maxCount);
+}
+
+APT_SPARSE_OCTREE_TEMPLATE_DECL
+tIndex APT_SPARSE_OCTREE_CLASS_DECL::queryFrustum(const vec3& _rootMin, const vec3& _rootMax, const vec4* _planes, int _planeCount, int _level, Index* out_, Index _maxCount) const
+{
+	if (m_map.find(0) == m_map.end())
+	{
+		return 0;
+	}
+	return Base::template query<false>(internal::SpatialPlanes<3, vec4>(_planes, _planeCount), _rootMin, _rootMax, _level, [this](Index _nodeIndex, int) { return getChildMask(_nodeIndex); }, out_, _maxCount);
+}
+
+#undef APT_SPARSE_OCTREE_TEMPLATE_DECL
+#undef APT_SPARSE_OCTREE_CLASS_DECL
+
+} // namespace apt
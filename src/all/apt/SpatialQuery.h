@@ -0,0 +1,247 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define APT_SPATIAL_QUERY_SSE2 1
+	#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+	#define APT_SPATIAL_QUERY_AVX 1
+	#include <immintrin.h>
+#endif
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialQuery
+// Bounds tests used by the Quadtree/Octree spatial queries (queryAabb(),
+// querySphere(), queryFrustum()). Each test classifies all children of a node
+// at once against the query volume: the children's bounds are derived from the
+// parent min and the child size, 1 child per SIMD lane (SSE2, or AVX for the 8
+// children of an octree node when compiling with AVX enabled).
+//
+// The result of a test is a pair of child masks: 'overlap' (bit i set if child
+// i intersects the volume) and 'inside' (bit i set if child i is entirely
+// inside the volume, in which case its descendants needn't be tested).
+//
+// Child i is at offset ((i >> 1) & 1, i & 1, (i >> 2) & 1) * childSize from
+// the parent min, i.e. the Morton order used by Quadtree/Octree.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace internal {
+
+#if APT_SPATIAL_QUERY_SSE2
+	struct SpatialFloat4
+	{
+		__m128 m_v;
+
+		static SpatialFloat4 Load(const float* _src)                                           { return { _mm_loadu_ps(_src) }; }
+		static SpatialFloat4 Splat(float _f)                                                   { return { _mm_set1_ps(_f) }; }
+
+		friend SpatialFloat4 operator+(SpatialFloat4 _a, SpatialFloat4 _b)                     { return { _mm_add_ps(_a.m_v, _b.m_v) }; }
+		friend SpatialFloat4 operator-(SpatialFloat4 _a, SpatialFloat4 _b)                     { return { _mm_sub_ps(_a.m_v, _b.m_v) }; }
+		friend SpatialFloat4 operator*(SpatialFloat4 _a, SpatialFloat4 _b)                     { return { _mm_mul_ps(_a.m_v, _b.m_v) }; }
+		friend SpatialFloat4 Max(SpatialFloat4 _a, SpatialFloat4 _b)                           { return { _mm_max_ps(_a.m_v, _b.m_v) }; }
+
+		// Return a mask with bit i set if _a[i] <= _b[i].
+		friend uint32        LessEqual(SpatialFloat4 _a, SpatialFloat4 _b)                     { return (uint32)_mm_movemask_ps(_mm_cmple_ps(_a.m_v, _b.m_v)); }
+	};
+#else
+	struct SpatialFloat4
+	{
+		float m_v[4];
+
+		static SpatialFloat4 Load(const float* _src)                                           { return { { _src[0], _src[1], _src[2], _src[3] } }; }
+		static SpatialFloat4 Splat(float _f)                                                   { return { { _f, _f, _f, _f } }; }
+
+		friend SpatialFloat4 operator+(SpatialFloat4 _a, SpatialFloat4 _b)                     { for (int i = 0; i < 4; ++i) _a.m_v[i] += _b.m_v[i]; return _a; }
+		friend SpatialFloat4 operator-(SpatialFloat4 _a, SpatialFloat4 _b)                     { for (int i = 0; i < 4; ++i) _a.m_v[i] -= _b.m_v[i]; return _a; }
+		friend SpatialFloat4 operator*(SpatialFloat4 _a, SpatialFloat4 _b)                     { for (int i = 0; i < 4; ++i) _a.m_v[i] *= _b.m_v[i]; return _a; }
+		friend SpatialFloat4 Max(SpatialFloat4 _a, SpatialFloat4 _b)                           { for (int i = 0; i < 4; ++i) _a.m_v[i] = APT_MAX(_a.m_v[i], _b.m_v[i]); return _a; }
+		friend uint32        LessEqual(SpatialFloat4 _a, SpatialFloat4 _b)                     { uint32 ret = 0; for (int i = 0; i < 4; ++i) ret |= (uint32)(_a.m_v[i] <= _b.m_v[i]) << i; return ret; }
+	};
+#endif
+
+#if APT_SPATIAL_QUERY_AVX
+	struct SpatialFloat8
+	{
+		__m256 m_v;
+
+		static SpatialFloat8 Load(const float* _src)                                           { return { _mm256_loadu_ps(_src) }; }
+		static SpatialFloat8 Splat(float _f)                                                   { return { _mm256_set1_ps(_f) }; }
+
+		friend SpatialFloat8 operator+(SpatialFloat8 _a, SpatialFloat8 _b)                     { return { _mm256_add_ps(_a.m_v, _b.m_v) }; }
+		friend SpatialFloat8 operator-(SpatialFloat8 _a, SpatialFloat8 _b)                     { return { _mm256_sub_ps(_a.m_v, _b.m_v) }; }
+		friend SpatialFloat8 operator*(SpatialFloat8 _a, SpatialFloat8 _b)                     { return { _mm256_mul_ps(_a.m_v, _b.m_v) }; }
+		friend SpatialFloat8 Max(SpatialFloat8 _a, SpatialFloat8 _b)                           { return { _mm256_max_ps(_a.m_v, _b.m_v) }; }
+		friend uint32        LessEqual(SpatialFloat8 _a, SpatialFloat8 _b)                     { return (uint32)_mm256_movemask_ps(_mm256_cmp_ps(_a.m_v, _b.m_v, _CMP_LE_OQ)); }
+	};
+#endif
+
+	// Child offsets (in units of child size) per axis for children [0, 8).
+	inline const float* SpatialChildOffsets(int _axis)
+	{
+		alignas(32) static const float kOffsets[3][8] =
+		{
+			{ 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f },
+			{ 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f },
+			{ 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+		};
+		return kOffsets[_axis];
+	}
+
+	// Min/max bounds of children [_first, _first + lane count) along _axis.
+	template <typename tFloatN>
+	inline void SpatialChildBounds(const float* _parentMin, const float* _childSize, int _first, int _axis, tFloatN& min_, tFloatN& max_)
+	{
+		tFloatN size = tFloatN::Splat(_childSize[_axis]);
+		min_ = tFloatN::Splat(_parentMin[_axis]) + tFloatN::Load(SpatialChildOffsets(_axis) + _first) * size;
+		max_ = min_ + size;
+	}
+
+	// Axis-aligned box [m_min, m_max].
+	template <int kDim>
+	struct SpatialAabb
+	{
+		float m_min[kDim];
+		float m_max[kDim];
+
+		template <typename tVec>
+		SpatialAabb(const tVec& _min, const tVec& _max)
+		{
+			for (int i = 0; i < kDim; ++i)
+			{
+				m_min[i] = _min[i];
+				m_max[i] = _max[i];
+			}
+		}
+
+		template <typename tFloatN>
+		void test(const float* _parentMin, const float* _childSize, int _first, uint32& overlap_, uint32& inside_) const
+		{
+			overlap_ = inside_ = ~0u;
+			for (int i = 0; i < kDim; ++i)
+			{
+				tFloatN cmin, cmax;
+				SpatialChildBounds(_parentMin, _childSize, _first, i, cmin, cmax);
+				tFloatN qmin = tFloatN::Splat(m_min[i]);
+				tFloatN qmax = tFloatN::Splat(m_max[i]);
+				overlap_ &= LessEqual(cmin, qmax) & LessEqual(qmin, cmax);
+				inside_  &= LessEqual(qmin, cmin) & LessEqual(cmax, qmax);
+			}
+		}
+	};
+
+	// Sphere (circle if kDim = 2) at m_center with radius sqrt(m_radius2).
+	template <int kDim>
+	struct SpatialSphere
+	{
+		float m_center[kDim];
+		float m_radius2;
+
+		template <typename tVec>
+		SpatialSphere(const tVec& _center, float _radius)
+			: m_radius2(_radius * _radius)
+		{
+			for (int i = 0; i < kDim; ++i)
+			{
+				m_center[i] = _center[i];
+			}
+		}
+
+		template <typename tFloatN>
+		void test(const float* _parentMin, const float* _childSize, int _first, uint32& overlap_, uint32& inside_) const
+		{
+			tFloatN nearest2 = tFloatN::Splat(0.0f); // squared distance to the nearest point
+			tFloatN farthest2 = tFloatN::Splat(0.0f); // squared distance to the farthest corner
+			for (int i = 0; i < kDim; ++i)
+			{
+				tFloatN cmin, cmax;
+				SpatialChildBounds(_parentMin, _childSize, _first, i, cmin, cmax);
+				tFloatN c = tFloatN::Splat(m_center[i]);
+				tFloatN dmin = cmin - c;
+				tFloatN dmax = c - cmax;
+				tFloatN nearest = Max(Max(dmin, dmax), tFloatN::Splat(0.0f));
+				tFloatN farthest = Max(c - cmin, cmax - c);
+				nearest2 = nearest2 + nearest * nearest;
+				farthest2 = farthest2 + farthest * farthest;
+			}
+			tFloatN r2 = tFloatN::Splat(m_radius2);
+			overlap_ = LessEqual(nearest2, r2);
+			inside_  = LessEqual(farthest2, r2);
+		}
+	};
+
+	// Convex volume bounded by planes (lines if kDim = 2). A point p is inside plane j if dot(m_planes[j].xyz, p) + m_planes[j].w >= 0.
+	// Overlap is conservative: a child which straddles 2 planes outside the volume (e.g. near a frustum corner) may be reported as
+	// overlapping.
+	template <int kDim, typename tPlane>
+	struct SpatialPlanes
+	{
+		const tPlane* m_planes;
+		int           m_planeCount;
+
+		SpatialPlanes(const tPlane* _planes, int _planeCount)
+			: m_planes(_planes)
+			, m_planeCount(_planeCount)
+		{
+			APT_ASSERT(_planes || _planeCount == 0);
+		}
+
+		template <typename tFloatN>
+		void test(const float* _parentMin, const float* _childSize, int _first, uint32& overlap_, uint32& inside_) const
+		{
+			tFloatN center[kDim];
+			for (int i = 0; i < kDim; ++i)
+			{
+				tFloatN cmin, cmax;
+				SpatialChildBounds(_parentMin, _childSize, _first, i, cmin, cmax);
+				center[i] = (cmin + cmax) * tFloatN::Splat(0.5f);
+			}
+			overlap_ = inside_ = ~0u;
+			for (int j = 0; j < m_planeCount; ++j)
+			{
+				const tPlane& plane = m_planes[j];
+			 // signed distance of the child centers, the projected child radius is the same for all children
+				tFloatN dist = tFloatN::Splat(plane[kDim]);
+				float radius = 0.0f;
+				for (int i = 0; i < kDim; ++i)
+				{
+					dist = dist + center[i] * tFloatN::Splat(plane[i]);
+					radius += (plane[i] < 0.0f ? -plane[i] : plane[i]) * _childSize[i] * 0.5f;
+				}
+				overlap_ &= LessEqual(tFloatN::Splat(-radius), dist);
+				inside_  &= LessEqual(tFloatN::Splat(radius), dist);
+			}
+		}
+	};
+
+	// Test the 2^kDim children of a node against _test, return the overlap and inside masks.
+	template <int kDim, typename tTest>
+	inline void SpatialTestChildren(const tTest& _test, const float* _parentMin, const float* _childSize, uint32& overlap_, uint32& inside_)
+	{
+		const int kChildCount = 1 << kDim;
+	#if APT_SPATIAL_QUERY_AVX
+		if (kChildCount == 8)
+		{
+			_test.template test<SpatialFloat8>(_parentMin, _childSize, 0, overlap_, inside_);
+			overlap_ &= 0xff;
+			inside_  &= 0xff;
+			return;
+		}
+	#endif
+		overlap_ = inside_ = 0;
+		for (int i = 0; i < kChildCount; i += 4)
+		{
+			uint32 overlap, inside;
+			_test.template test<SpatialFloat4>(_parentMin, _childSize, i, overlap, inside);
+			overlap_ |= (overlap & 0xf) << i;
+			inside_  |= (inside & 0xf) << i;
+		}
+	}
+
+} // namespace internal
+
+} // namespace apt
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <atomic>
+#include <cstring>
+#include <new>         // placement new
+#include <type_traits> // std::is_trivially_copyable
+#include <utility>     // std::move
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// SpscRingBuffer
+// Lock-free, bounded, single-producer single-consumer FIFO. Exactly one thread
+// may call the push functions and exactly one (other) thread may call the pop
+// functions. Usage:
+//
+//    SpscRingBuffer<Sample> buf(1024);
+//    // producer thread:
+//    buf.tryPush(samples, sampleCount); // push as many as will fit
+//    // consumer thread:
+//    Sample out[64];
+//    uint n = buf.tryPop(out, 64);
+//
+// The capacity is rounded up to a power of 2. The head (read) and tail (write)
+// indices increase monotonically and are masked on access; each is on its own
+// cache line along with the owning thread's cached copy of the other index,
+// hence the producer and consumer only share a cache line when the cached
+// index is stale (the buffer appears full/empty).
+//
+// The bulk functions copy contiguous runs (at most 2 per call) with memcpy if
+// tType is trivially copyable, else element-wise. Bulk operations are
+// published with a single release store.
+////////////////////////////////////////////////////////////////////////////////
+template <typename tType>
+class SpscRingBuffer: public aligned<SpscRingBuffer<tType>, APT_DCACHE_LINE_SIZE>, private non_copyable<SpscRingBuffer<tType> >
+{
+public:
+	SpscRingBuffer(uint _capacity)
+	{
+		APT_ASSERT(_capacity > 0);
+		m_capacity = 1;
+		while (m_capacity < _capacity) {
+			m_capacity <<= 1;
+		}
+		m_mask = m_capacity - 1;
+		m_buffer = (tType*)APT_MALLOC_ALIGNED(sizeof(tType) * m_capacity, alignof(tType));
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_relaxed);
+		m_cachedHead = m_cachedTail = 0;
+	}
+
+	// Remaining elements are destructed. The producer and consumer must not be active.
+	~SpscRingBuffer()
+	{
+		uint head = m_head.load(std::memory_order_relaxed);
+		uint tail = m_tail.load(std::memory_order_relaxed);
+		for (; head != tail; ++head) {
+			m_buffer[head & m_mask].~tType();
+		}
+		APT_FREE_ALIGNED(m_buffer);
+	}
+
+	// Producer. Return false if the buffer is full.
+	bool tryPush(const tType& _v)             { return emplace(_v); }
+	bool tryPush(tType&& _v)                  { return emplace(std::move(_v)); }
+
+	// Producer. Push up to _count elements from _data, return the number of elements pushed.
+	uint tryPush(const tType* _data, uint _count)
+	{
+		uint tail = m_tail.load(std::memory_order_relaxed);
+		uint n = APT_MIN(_count, m_capacity - (tail - m_cachedHead));
+		if (n < _count) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			n = APT_MIN(_count, m_capacity - (tail - m_cachedHead));
+		}
+		uint i = tail & m_mask;
+		uint run = APT_MIN(n, m_capacity - i);
+		CopyConstruct(m_buffer + i, _data, run, IsTrivial());
+		CopyConstruct(m_buffer, _data + run, n - run, IsTrivial());
+		m_tail.store(tail + n, std::memory_order_release);
+		return n;
+	}
+
+	// Consumer. Return false if the buffer is empty, else move the front element into out_.
+	bool tryPop(tType& out_)
+	{
+		uint head = m_head.load(std::memory_order_relaxed);
+		if (head == m_cachedTail) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head == m_cachedTail) {
+				return false;
+			}
+		}
+		tType& v = m_buffer[head & m_mask];
+		out_ = std::move(v);
+		v.~tType();
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer. Pop up to _count elements into out_, return the number of elements popped.
+	uint tryPop(tType* out_, uint _count)
+	{
+		uint head = m_head.load(std::memory_order_relaxed);
+		uint n = APT_MIN(_count, m_cachedTail - head);
+		if (n < _count) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			n = APT_MIN(_count, m_cachedTail - head);
+		}
+		uint i = head & m_mask;
+		uint run = APT_MIN(n, m_capacity - i);
+		MoveDestruct(out_, m_buffer + i, run, IsTrivial());
+		MoveDestruct(out_ + run, m_buffer, n - run, IsTrivial());
+		m_head.store(head + n, std::memory_order_release);
+		return n;
+	}
+
+	// Approximate if called while the producer or consumer are active.
+	uint size() const                         { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+	bool empty() const                        { return size() == 0; }
+	uint capacity() const                     { return m_capacity; }
+
+private:
+	typedef std::integral_constant<bool, std::is_trivially_copyable<tType>::value> IsTrivial;
+
+ // consumer
+	alignas(APT_DCACHE_LINE_SIZE) std::atomic<uint> m_head; // Next element to pop.
+	uint                          m_cachedTail;             // Consumer's copy of m_tail.
+
+ // producer
+	alignas(APT_DCACHE_LINE_SIZE) std::atomic<uint> m_tail; // Next element to push.
+	uint                          m_cachedHead;             // Producer's copy of m_head.
+
+ // shared, read only
+	alignas(APT_DCACHE_LINE_SIZE) tType* m_buffer;
+	uint                          m_capacity;
+	uint                          m_mask;
+
+	template <typename tValue>
+	bool emplace(tValue&& _v)
+	{
+		uint tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_cachedHead == m_capacity) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail - m_cachedHead == m_capacity) {
+				return false;
+			}
+		}
+		new(&m_buffer[tail & m_mask]) tType(std::forward<tValue>(_v));
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	static void CopyConstruct(tType* _dst, const tType* _src, uint _count, std::true_type)
+	{
+		memcpy(_dst, _src, sizeof(tType) * _count);
+	}
+	static void CopyConstruct(tType* _dst, const tType* _src, uint _count, std::false_type)
+	{
+		for (uint i = 0; i < _count; ++i) {
+			new(&_dst[i]) tType(_src[i]);
+		}
+	}
+
+	static void MoveDestruct(tType* _dst, tType* _src, uint _count, std::true_type)
+	{
+		memcpy(_dst, _src, sizeof(tType) * _count);
+	}
+	static void MoveDestruct(tType* _dst, tType* _src, uint _count, std::false_type)
+	{
+		for (uint i = 0; i < _count; ++i) {
+			_dst[i] = std::move(_src[i]);
+			_src[i].~tType();
+		}
+	}
+};
+
+} // namespace apt
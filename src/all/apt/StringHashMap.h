@@ -0,0 +1,384 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/StringHash.h>
+
+#include <EASTL/allocator.h>
+#include <EASTL/utility.h> // eastl::pair
+
+#include <cstring>
+#include <iterator>    // std::forward_iterator_tag
+#include <new>         // placement new
+#include <type_traits> // std::conditional
+#include <utility>     // std::move
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define APT_STRING_HASH_MAP_SSE2 1
+	#include <emmintrin.h>
+#endif
+#if APT_COMPILER_MSVC
+	#include <intrin.h> // _BitScanForward
+#endif
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// StringHashMap
+// Flat open-addressing hash map keyed by StringHash (after the 'Swiss table'
+// design). Usage:
+//
+//    StringHashMap<Texture*> textures;
+//    textures[StringHash("albedo")] = tex;
+//    auto it = textures.find("albedo");
+//    if (it != textures.end()) { it->second ... }
+//
+// StringHash is already a well mixed 64 bit value, hence it is used directly:
+// the low 7 bits (H2) are stored in a 1 byte control array alongside the
+// slots, the remaining bits (H1) select the start of the probe sequence.
+// Lookup compares H2 against a group of 16 control bytes at once (with SSE2
+// where available) and only compares full keys for matching bytes, so most
+// lookups touch 1 cache line of control bytes plus the matching slot.
+//
+// The max load factor is 7/8. erase() leaves a tombstone, tombstones are
+// purged when the table is rehashed. insert() and erase() invalidate iterators
+// and ptrs to values.
+////////////////////////////////////////////////////////////////////////////////
+template <typename tValue, typename tAllocator>
+class StringHashMap
+{
+public:
+	typedef StringHash                      key_type;
+	typedef tValue                          mapped_type;
+	typedef eastl::pair<StringHash, tValue> value_type;
+	typedef uint                            size_type;
+	typedef tAllocator                      allocator_type;
+
+	template <bool kIsConst> class iterator_base;
+	typedef iterator_base<false> iterator;
+	typedef iterator_base<true>  const_iterator;
+
+	StringHashMap(const tAllocator& _allocator = tAllocator())
+		: m_allocator(_allocator)
+		, m_ctrl(nullptr)
+		, m_slots(nullptr)
+		, m_capacity(0)
+		, m_size(0)
+		, m_growthLeft(0)
+	{
+	}
+
+	StringHashMap(StringHashMap&& _rhs)
+		: StringHashMap(_rhs.m_allocator)
+	{
+		swap(*this, _rhs);
+	}
+
+	StringHashMap& operator=(StringHashMap&& _rhs)
+	{
+		swap(*this, _rhs);
+		return *this;
+	}
+
+	~StringHashMap()
+	{
+		clear();
+		if (m_ctrl) {
+			m_allocator.deallocate(m_ctrl, GetAllocSize(m_capacity));
+		}
+	}
+
+	friend void swap(StringHashMap& _a, StringHashMap& _b)
+	{
+		eastl::swap(_a.m_allocator,  _b.m_allocator);
+		eastl::swap(_a.m_ctrl,       _b.m_ctrl);
+		eastl::swap(_a.m_slots,      _b.m_slots);
+		eastl::swap(_a.m_capacity,   _b.m_capacity);
+		eastl::swap(_a.m_size,       _b.m_size);
+		eastl::swap(_a.m_growthLeft, _b.m_growthLeft);
+	}
+
+	// Return an iterator to the value for _key, or end().
+	iterator       find(StringHash _key)              { return iterator(this, findIndex(_key)); }
+	const_iterator find(StringHash _key) const        { return const_iterator(this, findIndex(_key)); }
+	bool           contains(StringHash _key) const    { return findIndex(_key) != m_capacity; }
+
+	// Insert _value if _value.first isn't already in the map. Return an iterator to the value for _value.first and true if the insertion
+	// happened.
+	eastl::pair<iterator, bool> insert(const value_type& _value)
+	{
+		uint i = findIndex(_value.first);
+		if (i != m_capacity) {
+			return eastl::make_pair(iterator(this, i), false);
+		}
+		i = prepareInsert(_value.first);
+		new(&m_slots[i]) value_type(_value);
+		return eastl::make_pair(iterator(this, i), true);
+	}
+
+	// Return a reference to the value for _key, insert a default constructed value if _key isn't in the map.
+	tValue& operator[](StringHash _key)
+	{
+		uint i = findIndex(_key);
+		if (i == m_capacity) {
+			i = prepareInsert(_key);
+			new(&m_slots[i]) value_type(_key, tValue());
+		}
+		return m_slots[i].second;
+	}
+
+	// Return the number of values erased (0 or 1).
+	uint erase(StringHash _key)
+	{
+		uint i = findIndex(_key);
+		if (i == m_capacity) {
+			return 0;
+		}
+		eraseIndex(i);
+		return 1;
+	}
+
+	// Return an iterator to the next value.
+	iterator erase(const_iterator _it)
+	{
+		APT_ASSERT(_it.m_map == this && _it.m_index < m_capacity);
+		eraseIndex(_it.m_index);
+		return iterator(this, _it.m_index + 1);
+	}
+
+	void clear()
+	{
+		for (uint i = 0; i < m_capacity; ++i) {
+			if (IsFull(m_ctrl[i])) {
+				m_slots[i].~value_type();
+			}
+		}
+		if (m_ctrl) {
+			memset(m_ctrl, kEmpty, m_capacity + kClonedBytes);
+		}
+		m_size = 0;
+		m_growthLeft = GetMaxLoad(m_capacity);
+	}
+
+	// Ensure that at least _n values can be stored without rehashing.
+	void reserve(uint _n)
+	{
+		if (_n > m_size + m_growthLeft) {
+			uint capacity = kGroupSize;
+			while (GetMaxLoad(capacity) < _n) {
+				capacity *= 2;
+			}
+			rehash(capacity);
+		}
+	}
+
+	uint           size() const                       { return m_size; }
+	bool           empty() const                      { return m_size == 0; }
+	uint           capacity() const                   { return m_capacity; }
+
+	iterator       begin()                            { return iterator(this, 0); }
+	const_iterator begin() const                      { return const_iterator(this, 0); }
+	iterator       end()                              { return iterator(this, m_capacity); }
+	const_iterator end() const                        { return const_iterator(this, m_capacity); }
+
+	const tAllocator& get_allocator() const           { return m_allocator; }
+
+private:
+	typedef sint8 Ctrl;
+	static const Ctrl kEmpty       = -128; // 0b10000000
+	static const Ctrl kDeleted     = -2;   // 0b11111110
+	static const uint kGroupSize   = 16;
+	static const uint kClonedBytes = kGroupSize - 1; // The first kClonedBytes control bytes are mirrored after the end so that groups can be loaded at any index.
+
+	tAllocator  m_allocator;
+	Ctrl*       m_ctrl;       // m_capacity + kClonedBytes control bytes, followed by the slots.
+	value_type* m_slots;
+	uint        m_capacity;   // 0 or a power of 2 >= kGroupSize.
+	uint        m_size;
+	uint        m_growthLeft; // Number of empty slots which can be filled before rehashing.
+
+	static bool   IsFull(Ctrl _ctrl)                  { return _ctrl >= 0; }
+	static uint   GetH1(StringHash _key)              { return (uint)(_key.getHash() >> 7); }
+	static Ctrl   GetH2(StringHash _key)              { return (Ctrl)(_key.getHash() & 0x7f); }
+	static uint   GetMaxLoad(uint _capacity)          { return _capacity - _capacity / 8; }
+	static uint   GetSlotOffset(uint _capacity)       { return (_capacity + kClonedBytes + alignof(value_type) - 1) & ~(uint)(alignof(value_type) - 1); }
+	static uint   GetAllocSize(uint _capacity)        { return GetSlotOffset(_capacity) + sizeof(value_type) * _capacity; }
+
+	// Bit i of the returned masks is set if byte i of the group matches.
+	struct Group
+	{
+	#if APT_STRING_HASH_MAP_SSE2
+		__m128i m_ctrl;
+
+		Group(const Ctrl* _ctrl): m_ctrl(_mm_loadu_si128((const __m128i*)_ctrl)) {}
+
+		uint32 match(Ctrl _h2) const                  { return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(m_ctrl, _mm_set1_epi8(_h2))); }
+		uint32 matchEmpty() const                     { return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(m_ctrl, _mm_set1_epi8(kEmpty))); }
+		uint32 matchEmptyOrDeleted() const            { return (uint32)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), m_ctrl)); }
+	#else
+		Ctrl m_ctrl[kGroupSize];
+
+		Group(const Ctrl* _ctrl)                      { memcpy(m_ctrl, _ctrl, kGroupSize); }
+
+		uint32 match(Ctrl _h2) const                  { uint32 ret = 0; for (uint i = 0; i < kGroupSize; ++i) ret |= (uint32)(m_ctrl[i] == _h2) << i; return ret; }
+		uint32 matchEmpty() const                     { return match(kEmpty); }
+		uint32 matchEmptyOrDeleted() const            { uint32 ret = 0; for (uint i = 0; i < kGroupSize; ++i) ret |= (uint32)(m_ctrl[i] < -1) << i; return ret; }
+	#endif
+	};
+
+	static uint LowestBit(uint32 _mask)
+	{
+		APT_ASSERT(_mask != 0);
+	#if APT_COMPILER_MSVC
+		unsigned long ret;
+		_BitScanForward(&ret, _mask);
+		return (uint)ret;
+	#else
+		return (uint)__builtin_ctz(_mask);
+	#endif
+	}
+
+	void setCtrl(uint _i, Ctrl _ctrl)
+	{
+		m_ctrl[_i] = _ctrl;
+		m_ctrl[((_i - kClonedBytes) & (m_capacity - 1)) + kClonedBytes] = _ctrl;
+	}
+
+	// Return the slot index for _key, or m_capacity if not found.
+	uint findIndex(StringHash _key) const
+	{
+		if_unlikely (m_capacity == 0) {
+			return 0;
+		}
+		uint mask = m_capacity - 1;
+		Ctrl h2 = GetH2(_key);
+	 // triangular probing visits every group once if the capacity is a power of 2
+		for (uint pos = GetH1(_key) & mask, step = 0;; step += kGroupSize, pos = (pos + step) & mask) {
+			Group group(m_ctrl + pos);
+			for (uint32 match = group.match(h2); match; match &= match - 1) {
+				uint i = (pos + LowestBit(match)) & mask;
+				if_likely (m_slots[i].first == _key) {
+					return i;
+				}
+			}
+			if_likely (group.matchEmpty()) {
+				return m_capacity;
+			}
+			APT_ASSERT(step <= m_capacity);
+		}
+	}
+
+	// Return the index of the first empty or deleted slot in the probe sequence for _key.
+	uint findInsertIndex(StringHash _key) const
+	{
+		uint mask = m_capacity - 1;
+		for (uint pos = GetH1(_key) & mask, step = 0;; step += kGroupSize, pos = (pos + step) & mask) {
+			uint32 match = Group(m_ctrl + pos).matchEmptyOrDeleted();
+			if (match) {
+				return (pos + LowestBit(match)) & mask;
+			}
+			APT_ASSERT(step <= m_capacity);
+		}
+	}
+
+	// Mark a slot for _key (which must not be in the map) as full, return its index. The caller constructs the value.
+	uint prepareInsert(StringHash _key)
+	{
+		uint i = m_capacity ? findInsertIndex(_key) : 0;
+		if_unlikely (m_capacity == 0 || (m_growthLeft == 0 && m_ctrl[i] == kEmpty)) {
+		 // grow if the table is more than half full (excluding tombstones), else rehash in place to purge tombstones
+			rehash(m_size * 2 >= GetMaxLoad(m_capacity) ? (m_capacity ? m_capacity * 2 : (uint)kGroupSize) : m_capacity);
+			i = findInsertIndex(_key);
+		}
+		if (m_ctrl[i] == kEmpty) {
+			--m_growthLeft;
+		}
+		setCtrl(i, GetH2(_key));
+		++m_size;
+		return i;
+	}
+
+	void eraseIndex(uint _i)
+	{
+		APT_ASSERT(IsFull(m_ctrl[_i]));
+		m_slots[_i].~value_type();
+		setCtrl(_i, kDeleted);
+		--m_size;
+	}
+
+	void rehash(uint _capacity)
+	{
+		APT_ASSERT(_capacity >= kGroupSize && (_capacity & (_capacity - 1)) == 0);
+		Ctrl*       oldCtrl     = m_ctrl;
+		value_type* oldSlots    = m_slots;
+		uint        oldCapacity = m_capacity;
+
+		m_ctrl       = (Ctrl*)eastl::allocate_memory(m_allocator, GetAllocSize(_capacity), alignof(value_type), 0); // groups are loaded unaligned
+		m_slots      = (value_type*)((char*)m_ctrl + GetSlotOffset(_capacity));
+		m_capacity   = _capacity;
+		m_growthLeft = GetMaxLoad(_capacity) - m_size;
+		memset(m_ctrl, kEmpty, _capacity + kClonedBytes);
+
+		for (uint i = 0; i < oldCapacity; ++i) {
+			if (IsFull(oldCtrl[i])) {
+				StringHash key = oldSlots[i].first;
+				uint j = findInsertIndex(key);
+				setCtrl(j, GetH2(key));
+				new(&m_slots[j]) value_type(std::move(oldSlots[i]));
+				oldSlots[i].~value_type();
+			}
+		}
+		if (oldCtrl) {
+			m_allocator.deallocate(oldCtrl, GetAllocSize(oldCapacity));
+		}
+	}
+
+}; // class StringHashMap
+
+template <typename tValue, typename tAllocator>
+template <bool kIsConst>
+class StringHashMap<tValue, tAllocator>::iterator_base
+{
+	friend class StringHashMap<tValue, tAllocator>;
+	typedef StringHashMap<tValue, tAllocator> Parent;
+	typedef typename std::conditional<kIsConst, const Parent, Parent>::type parent_type;
+public:
+	typedef typename std::conditional<kIsConst, const typename Parent::value_type, typename Parent::value_type>::type value_type;
+	typedef sint                      difference_type;
+	typedef value_type*               pointer;
+	typedef value_type&               reference;
+	typedef std::forward_iterator_tag iterator_category;
+
+	iterator_base(const iterator_base<false>& _rhs): m_map(_rhs.m_map), m_index(_rhs.m_index) {}
+
+	reference      operator*() const                              { APT_ASSERT(m_index < m_map->m_capacity); return m_map->m_slots[m_index]; }
+	pointer        operator->() const                             { return &operator*(); }
+
+	iterator_base& operator++()                                   { ++m_index; skipEmpty(); return *this; }
+	iterator_base  operator++(int)                                { iterator_base ret = *this; operator++(); return ret; }
+
+	bool           operator==(const iterator_base& _rhs) const    { return m_index == _rhs.m_index; }
+	bool           operator!=(const iterator_base& _rhs) const    { return m_index != _rhs.m_index; }
+
+private:
+	parent_type* m_map;
+	uint         m_index;
+
+	iterator_base(parent_type* _map, uint _index)
+		: m_map(_map)
+		, m_index(_index)
+	{
+		skipEmpty();
+	}
+
+	void skipEmpty()
+	{
+		while (m_index < m_map->m_capacity && !IsFull(m_map->m_ctrl[m_index])) {
+			++m_index;
+		}
+	}
+
+	template <bool> friend class iterator_base;
+
+}; // class iterator_base
+
+} // namespace apt
@@ -0,0 +1,216 @@
+#include <apt/ThreadCachedMemoryPool.h>
+
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <climits>
+#include <new>
+
+namespace apt {
+
+namespace {
+
+// Each live thread is assigned a unique slot in [0,kMaxThreads) which indexes the per-pool cache array. Slots are released on thread
+// exit and may be reused by a subsequent thread, in which case the new thread inherits any objects left in the caches.
+std::atomic<uint64> s_threadSlotMask(0);
+
+struct ThreadSlot
+{
+	int m_index = -1;
+
+	ThreadSlot()
+	{
+		uint64 mask = s_threadSlotMask.load();
+		while (mask != ~uint64(0)) {
+			int i = 0;
+			while (mask & (uint64(1) << i)) {
+				++i;
+			}
+			if (s_threadSlotMask.compare_exchange_weak(mask, mask | (uint64(1) << i))) {
+				m_index = i;
+				break;
+			}
+		}
+	}
+
+	~ThreadSlot()
+	{
+		if (m_index >= 0) {
+			s_threadSlotMask.fetch_and(~(uint64(1) << m_index));
+		}
+	}
+};
+thread_local ThreadSlot s_threadSlot;
+
+} // namespace
+
+// PUBLIC
+
+ThreadCachedMemoryPool::ThreadCachedMemoryPool(uint _objectSize, uint _objectAlignment, uint _blockSize, uint _batchSize)
+	: m_pool(_objectSize, _objectAlignment, _blockSize)
+	, m_batchSize(_batchSize)
+	, m_caches(nullptr)
+{
+	APT_STATIC_ASSERT(kMaxThreads <= sizeof(uint64) * CHAR_BIT); // thread slots are tracked via a 64 bit mask
+	APT_ASSERT(m_batchSize > 0);
+
+	m_caches = (Cache*)APT_MALLOC_ALIGNED(sizeof(Cache) * kMaxThreads, alignof(Cache));
+	for (uint i = 0; i < kMaxThreads; ++i) {
+		Cache* cache = new(&m_caches[i]) Cache;
+		cache->m_objects = nullptr;
+		cache->m_count.store(0);
+		cache->m_refillCount.store(0);
+		cache->m_spillCount.store(0);
+	}
+}
+
+ThreadCachedMemoryPool::~ThreadCachedMemoryPool()
+{
+	for (uint i = 0; i < kMaxThreads; ++i) {
+		Cache& cache = m_caches[i];
+		m_pool.freeBatch(cache.m_objects, cache.m_count.load());
+		APT_FREE(cache.m_objects);
+		cache.~Cache();
+	}
+	APT_FREE_ALIGNED(m_caches);
+}
+
+void* ThreadCachedMemoryPool::alloc()
+{
+	Cache* cache = getCache();
+	if_unlikely (!cache) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pool.alloc();
+	}
+	uint count = cache->m_count.load(std::memory_order_relaxed);
+	if_unlikely (count == 0) {
+		refill(*cache);
+		count = m_batchSize;
+	}
+	--count;
+	cache->m_count.store(count, std::memory_order_relaxed);
+	return cache->m_objects[count];
+}
+
+void ThreadCachedMemoryPool::free(void* _object)
+{
+	APT_ASSERT(_object);
+	Cache* cache = getCache();
+	if_unlikely (!cache) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pool.free(_object);
+		return;
+	}
+	uint count = cache->m_count.load(std::memory_order_relaxed);
+	if_unlikely (count == m_batchSize * 2) {
+		spill(*cache, m_batchSize);
+		count -= m_batchSize;
+	}
+	cache->m_objects[count] = _object;
+	cache->m_count.store(count + 1, std::memory_order_relaxed);
+}
+
+void ThreadCachedMemoryPool::flush()
+{
+	Cache* cache = getCache();
+	if (cache) {
+		uint count = cache->m_count.load(std::memory_order_relaxed);
+		if (count > 0) {
+			spill(*cache, count);
+		}
+	}
+}
+
+uint ThreadCachedMemoryPool::trim(uint _keepBlocks)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pool.trim(_keepBlocks);
+}
+
+bool ThreadCachedMemoryPool::isFromPool(const void* _ptr) const
+{
+	return m_pool.isFromPool(_ptr); // lock-free, see MemoryPool::FindPool()
+}
+
+bool ThreadCachedMemoryPool::validate() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pool.validate();
+}
+
+uint ThreadCachedMemoryPool::getCapacity() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pool.getCapacity();
+}
+
+uint ThreadCachedMemoryPool::getUsedCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint ret = m_pool.getUsedCount();
+	for (uint i = 0; i < kMaxThreads; ++i) {
+	 // cached objects are 'used' from the shared pool's point of view; other threads may modify their cache concurrently, hence the
+	 // result is approximate (and may transiently undercount)
+		uint cached = m_caches[i].m_count.load(std::memory_order_relaxed);
+		ret -= APT_MIN(cached, ret);
+	}
+	return ret;
+}
+
+uint ThreadCachedMemoryPool::getRefillCount() const
+{
+	uint ret = 0;
+	for (uint i = 0; i < kMaxThreads; ++i) {
+		ret += m_caches[i].m_refillCount.load(std::memory_order_relaxed);
+	}
+	return ret;
+}
+
+uint ThreadCachedMemoryPool::getSpillCount() const
+{
+	uint ret = 0;
+	for (uint i = 0; i < kMaxThreads; ++i) {
+		ret += m_caches[i].m_spillCount.load(std::memory_order_relaxed);
+	}
+	return ret;
+}
+
+// PRIVATE
+
+ThreadCachedMemoryPool::Cache* ThreadCachedMemoryPool::getCache()
+{
+	int slot = s_threadSlot.m_index;
+	if_unlikely (slot < 0) {
+		return nullptr;
+	}
+	Cache* ret = &m_caches[slot];
+	if_unlikely (!ret->m_objects) {
+		ret->m_objects = (void**)APT_MALLOC(sizeof(void*) * m_batchSize * 2);
+	}
+	return ret;
+}
+
+void ThreadCachedMemoryPool::refill(Cache& _cache_)
+{
+	APT_ASSERT(_cache_.m_count.load(std::memory_order_relaxed) == 0);
+	{	std::lock_guard<std::mutex> lock(m_mutex);
+		m_pool.allocBatch(_cache_.m_objects, m_batchSize);
+		_cache_.m_count.store(m_batchSize, std::memory_order_relaxed);
+	}
+ // only the owning thread writes the counters, relaxed load/store avoids a locked RMW
+	_cache_.m_refillCount.store(_cache_.m_refillCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void ThreadCachedMemoryPool::spill(Cache& _cache_, uint _count)
+{
+	uint count = _cache_.m_count.load(std::memory_order_relaxed);
+	APT_ASSERT(_count <= count);
+	{	std::lock_guard<std::mutex> lock(m_mutex);
+		count -= _count;
+		_cache_.m_count.store(count, std::memory_order_relaxed);
+		m_pool.freeBatch(_cache_.m_objects + count, _count);
+	}
+	_cache_.m_spillCount.store(_cache_.m_spillCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+} // namespace apt
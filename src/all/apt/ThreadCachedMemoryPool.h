@@ -0,0 +1,86 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/MemoryPool.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// ThreadCachedMemoryPool
+// Thread safe front end for MemoryPool. Each thread owns a cache ('magazine')
+// of free objects from which alloc()/free() are serviced without any
+// synchronization. The cache is refilled from/spilled to the shared pool in
+// batches, which is the only time a lock is taken.
+// Usage:
+//
+//    Pool<Foo, ThreadCachedMemoryPool> pool(128); // drop-in policy for Pool
+//    Foo* f = pool.alloc(); // from any thread
+//    pool.free(f);          // from any thread
+//
+// Objects may be freed on a different thread to the one which allocated them.
+// Threads are assigned a cache slot on first use. If more than kMaxThreads
+// threads are alive at once, the remainder fall back to taking the lock on
+// every alloc()/free().
+////////////////////////////////////////////////////////////////////////////////
+class ThreadCachedMemoryPool: private non_copyable<ThreadCachedMemoryPool>
+{
+public:
+	static const uint kMaxThreads       = 64;
+	static const uint kDefaultBatchSize = 32;
+
+	// See MemoryPool. _batchSize is the number of objects moved between a thread cache and the shared pool per refill/spill; each
+	// thread cache holds at most 2 * _batchSize objects.
+	ThreadCachedMemoryPool(uint _objectSize, uint _objectAlignment, uint _blockSize, uint _batchSize = kDefaultBatchSize);
+
+	// Return all cached objects to the shared pool and free all allocated memory. Any allocated objects should be released via free()
+	// before the pool is destroyed.
+	~ThreadCachedMemoryPool();
+
+	void* alloc();
+	void  free(void* _object);
+
+	// Return any objects cached by the calling thread to the shared pool.
+	void  flush();
+
+	// See MemoryPool::trim(). Blocks which contain objects held in a thread cache are not empty and can't be released.
+	uint  trim(uint _keepBlocks = 0);
+
+	// Return true if _ptr was allocated from the pool.
+	bool  isFromPool(const void* _ptr) const;
+
+	// Return true if # used objects is consistent with # accessible free objects. Not thread safe.
+	bool  validate() const;
+
+	uint  getCapacity() const;
+	uint  getUsedCount() const; // Approximate if other threads are calling alloc()/free() concurrently.
+	uint  getFreeCount() const          { return getCapacity() - getUsedCount(); }
+
+	// Number of batch refills/spills between the thread caches and the shared pool (use to tune _batchSize).
+	uint  getRefillCount() const;
+	uint  getSpillCount() const;
+
+private:
+	struct alignas(APT_DCACHE_LINE_SIZE) Cache
+	{
+		void**            m_objects;
+		std::atomic<uint> m_count;       // Only written by the owning thread, atomic so that getUsedCount() can read it.
+		std::atomic<uint> m_refillCount;
+		std::atomic<uint> m_spillCount;
+	};
+
+	MemoryPool         m_pool;      // Shared pool, guarded by m_mutex.
+	mutable std::mutex m_mutex;
+	uint               m_batchSize;
+	Cache*             m_caches;    // kMaxThreads caches, indexed by thread slot.
+
+	// Return the calling thread's cache, or nullptr if no slot is available.
+	Cache* getCache();
+
+	void   refill(Cache& _cache_);
+	void   spill(Cache& _cache_, uint _count);
+};
+
+} // namespace apt
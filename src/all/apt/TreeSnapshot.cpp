@@ -0,0 +1,262 @@
+#include <apt/TreeSnapshot.h>
+
+#include <apt/File.h>
+#include <apt/memory.h>
+
+using namespace apt;
+
+constexpr uint32 TreeSnapshot::kMagic;
+constexpr uint32 TreeSnapshot::kVersion;
+constexpr uint64 TreeSnapshot::kDataAlignment;
+
+static uint64 AlignUp(uint64 _offset, uint64 _alignment)
+{
+	return (_offset + _alignment - 1) / _alignment * _alignment;
+}
+
+// PUBLIC
+
+TreeSnapshot::TreeSnapshot()
+{
+	APT_STATIC_ASSERT(sizeof(Header) == 64); // the file layout depends on these sizes
+	APT_STATIC_ASSERT(sizeof(Level) == 32);
+}
+
+TreeSnapshot::~TreeSnapshot()
+{
+	unload();
+}
+
+bool TreeSnapshot::load(const char* _path, Mode _mode)
+{
+	APT_ASSERT(_mode < Mode_Count);
+	unload();
+	if (!m_file.open(_path))
+	{
+		return false;
+	}
+	m_mode = _mode;
+	if (m_mode == Mode_Eager)
+	{
+		m_fileData = m_file.map(0, m_file.getSize());
+		if (!m_fileData)
+		{
+			unload();
+			return false;
+		}
+	}
+	if (!loadHeader())
+	{
+		unload();
+		return false;
+	}
+	if (m_mode == Mode_Eager)
+	{
+		for (int i = 0; i < getLevelCount(); ++i)
+		{
+			if (!getLevelData(i))
+			{
+				unload();
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void TreeSnapshot::unload()
+{
+	for (uint i = 0; i < m_levelData.size(); ++i)
+	{
+		if (!m_levelData[i])
+		{
+			continue;
+		}
+		if (m_levels[i].m_compression != CompressionFlags_None)
+		{
+			APT_FREE((void*)m_levelData[i]); // allocated by Decompress()
+		}
+		else if (!m_fileData)
+		{
+			m_file.unmap(m_levelData[i], m_levels[i].m_size);
+		}
+	}
+	if (m_fileData)
+	{
+		m_file.unmap(m_fileData, m_file.getSize());
+		m_fileData = nullptr;
+	}
+	m_file.close();
+	m_levels.clear();
+	m_levelData.clear();
+	m_header = Header();
+}
+
+// PRIVATE
+
+bool TreeSnapshot::WriteLevels(const char* _path, int _dimensions, uint _indexSize, uint _nodeSize, int _levelCount, const char* _nodes, const uint64* _levelSizes, uint64 _compressedLevels, CompressionFlags _compression)
+{
+	APT_ASSERT(_path);
+	APT_ASSERT(_nodes);
+	APT_ASSERT(_levelCount > 0 && _levelCount <= 64);
+
+	Header header = {};
+	header.m_magic      = kMagic;
+	header.m_version    = kVersion;
+	header.m_dimensions = (uint32)_dimensions;
+	header.m_indexSize  = (uint32)_indexSize;
+	header.m_nodeSize   = (uint32)_nodeSize;
+	header.m_levelCount = (uint32)_levelCount;
+
+	uint64 dataSize = 0;
+	for (int i = 0; i < _levelCount; ++i)
+	{
+		dataSize += AlignUp(_levelSizes[i], kDataAlignment);
+	}
+	uint64 tableEnd = AlignUp(sizeof(Header) + sizeof(Level) * _levelCount, kDataAlignment);
+
+ // single pass: reserve space for the header/table, append the level data and then fill in the header/table
+	File f;
+	f.reserveData((uint)(tableEnd + dataSize));
+	f.appendData(nullptr, (uint)tableEnd);
+	Level levels[64];
+	for (int i = 0; i < _levelCount; ++i)
+	{
+		Level& level = levels[i];
+		level = Level();
+		level.m_offset  = f.getDataSize();
+		level.m_rawSize = _levelSizes[i];
+		if (_compression != CompressionFlags_None && (_compressedLevels & (1ull << i)) != 0)
+		{
+			void* compressed = nullptr;
+			uint compressedSize = 0;
+			Compress(_nodes, (uint)_levelSizes[i], compressed, compressedSize, _compression);
+			f.appendData((const char*)compressed, compressedSize);
+			APT_FREE(compressed);
+			level.m_size = compressedSize;
+			level.m_compression = (uint32)_compression;
+		}
+		else
+		{
+			f.appendData(_nodes, (uint)_levelSizes[i]);
+			level.m_size = _levelSizes[i];
+		}
+		f.appendData(nullptr, (uint)(AlignUp(f.getDataSize(), kDataAlignment) - f.getDataSize()));
+		_nodes += _levelSizes[i];
+	}
+	memcpy(f.getData(), &header, sizeof(Header));
+	memcpy(f.getData() + sizeof(Header), levels, sizeof(Level) * _levelCount);
+
+	return File::Write(f, _path);
+}
+
+bool TreeSnapshot::loadHeader()
+{
+	const uint64 fileSize = m_file.getSize();
+	if (fileSize < sizeof(Header))
+	{
+		APT_LOG_ERR("Error loading '%s': invalid file size (%llu bytes)", getPath(), fileSize);
+		return false;
+	}
+	const char* data = m_fileData ? m_fileData : m_file.map(0, sizeof(Header));
+	if (!data)
+	{
+		return false;
+	}
+	memcpy(&m_header, data, sizeof(Header));
+	if (!m_fileData)
+	{
+		m_file.unmap(data, sizeof(Header));
+	}
+
+	if (m_header.m_magic != kMagic)
+	{
+		APT_LOG_ERR("Error loading '%s': not a tree snapshot", getPath());
+		return false;
+	}
+	if (m_header.m_version != kVersion)
+	{
+		APT_LOG_ERR("Error loading '%s': unsupported version %u (expected %u)", getPath(), m_header.m_version, kVersion);
+		return false;
+	}
+	if ((m_header.m_dimensions != 2 && m_header.m_dimensions != 3) || m_header.m_levelCount == 0 || m_header.m_dimensions * (m_header.m_levelCount - 1) >= 64 || m_header.m_nodeSize == 0)
+	{
+		APT_LOG_ERR("Error loading '%s': invalid header", getPath());
+		return false;
+	}
+
+	const uint64 tableSize = sizeof(Level) * m_header.m_levelCount;
+	if (fileSize < sizeof(Header) + tableSize)
+	{
+		APT_LOG_ERR("Error loading '%s': invalid file size (%llu bytes)", getPath(), fileSize);
+		return false;
+	}
+	data = m_fileData ? m_fileData + sizeof(Header) : m_file.map(sizeof(Header), tableSize);
+	if (!data)
+	{
+		return false;
+	}
+	m_levels.resize(m_header.m_levelCount);
+	memcpy(m_levels.data(), data, (size_t)tableSize);
+	if (!m_fileData)
+	{
+		m_file.unmap(data, tableSize);
+	}
+
+	for (int i = 0; i < getLevelCount(); ++i)
+	{
+		const Level& level = m_levels[i];
+		uint64 rawSize = (uint64)m_header.m_nodeSize << (m_header.m_dimensions * i);
+		bool valid = level.m_size > 0
+			&& level.m_offset % kDataAlignment == 0
+			&& level.m_offset <= fileSize && level.m_size <= fileSize - level.m_offset
+			&& level.m_rawSize == rawSize
+			&& (level.m_compression != CompressionFlags_None || level.m_size == level.m_rawSize)
+			;
+		if (!valid)
+		{
+			APT_LOG_ERR("Error loading '%s': invalid level %d", getPath(), i);
+			return false;
+		}
+	}
+	m_levelData.resize(m_header.m_levelCount, nullptr);
+	return true;
+}
+
+const char* TreeSnapshot::getLevelData(int _levelIndex)
+{
+	APT_ASSERT(isLoaded());
+	APT_ASSERT(_levelIndex >= 0 && _levelIndex < getLevelCount());
+	if (m_levelData[_levelIndex])
+	{
+		return m_levelData[_levelIndex];
+	}
+
+	const Level& level = m_levels[_levelIndex];
+	const char* data = m_fileData ? m_fileData + level.m_offset : m_file.map(level.m_offset, level.m_size);
+	if (!data)
+	{
+		return nullptr;
+	}
+	if (level.m_compression == CompressionFlags_None)
+	{
+		m_levelData[_levelIndex] = data;
+		return data;
+	}
+
+	void* raw = nullptr;
+	uint rawSize = 0;
+	Decompress(data, (uint)level.m_size, raw, rawSize);
+	if (!m_fileData)
+	{
+		m_file.unmap(data, level.m_size);
+	}
+	if (rawSize != level.m_rawSize)
+	{
+		APT_LOG_ERR("Error loading '%s': level %d decompressed to %llu bytes (expected %llu)", getPath(), _levelIndex, (uint64)rawSize, level.m_rawSize);
+		APT_FREE(raw);
+		return nullptr;
+	}
+	m_levelData[_levelIndex] = (const char*)raw;
+	return m_levelData[_levelIndex];
+}
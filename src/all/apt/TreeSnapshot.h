@@ -0,0 +1,201 @@
+#pragma once
+
+#include <apt/apt.h>
+#include <apt/compress.h>
+#include <apt/log.h>
+#include <apt/MappedFile.h>
+
+#include <EASTL/vector.h>
+
+#include <climits>
+#include <cstring>
+#include <type_traits>
+
+namespace apt {
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeSnapshot
+// Binary snapshot of a Quadtree/Octree which is loaded by memory mapping the
+// file, e.g. for fast startup or to share a read-only tree between processes
+// (the OS shares the physical pages of the mapped file).
+//
+//    TreeSnapshot::Write(tree, "tree.bin");
+//    ...
+//    TreeSnapshot snapshot;
+//    if (snapshot.load("tree.bin") && snapshot.isType<Octree<uint32, float> >()) {
+//       const float* leaves = snapshot.getLevel<float>(snapshot.getLevelCount() - 1);
+//    }
+//
+// File layout (native endianness):
+//    Header      Magic, version, dimensions, index/node size, level count.
+//    Level[n]    Per level offset, stored size, raw size and compression.
+//    Level data  Node array per level in the tree's order (see Quadtree.h),
+//                each aligned to kDataAlignment.
+//
+// Levels can optionally be compressed (see Write()). Compressed levels can't
+// be used in place, they are decompressed into memory on first access.
+//
+// Mode_Eager maps the whole file and decompresses any compressed levels in
+// load(). Mode_Lazy only reads the header in load() and maps each level on the
+// first call to getLevel(), hence untouched levels cost nothing. getLevel() is
+// not thread safe in Mode_Lazy.
+//
+// Only the generic Quadtree/Octree are supported (not the bool specializations
+// or SparseOctree). tNode must be trivially copyable. The node type itself
+// isn't recorded, isType() only checks the dimensions and index/node sizes.
+////////////////////////////////////////////////////////////////////////////////
+class TreeSnapshot: private non_copyable<TreeSnapshot>
+{
+public:
+
+	enum Mode
+	{
+		Mode_Eager,    // Map the whole file in load().
+		Mode_Lazy,     // Map each level on first access.
+
+		Mode_Count
+	};
+
+	static constexpr uint32 kMagic         = 0x53545041; // 'APTS'
+	static constexpr uint32 kVersion       = 1;
+	static constexpr uint64 kDataAlignment = 64;
+
+	// Write _tree to _path. Level i is compressed with _compression if bit i of _compressedLevels is set. Return false if an error
+	// occurred.
+	template <typename tTree>
+	static bool Write(const tTree& _tree, const char* _path, uint64 _compressedLevels = 0, CompressionFlags _compression = CompressionFlags_Default);
+
+	TreeSnapshot();
+	~TreeSnapshot();
+
+	// Load the snapshot at _path. Return false if an error occurred. Any previously loaded snapshot is unloaded.
+	bool        load(const char* _path, Mode _mode = Mode_Lazy);
+	void        unload();
+
+	// Return true if the snapshot was written from a tree of type tTree.
+	template <typename tTree>
+	bool        isType() const;
+
+	// Return a ptr to the nodes at _levelIndex, map or decompress the level if required. Return nullptr if an error occurred. The ptr
+	// is valid until unload().
+	template <typename tNode>
+	const tNode* getLevel(int _levelIndex)                                                    { APT_ASSERT(sizeof(tNode) == m_header.m_nodeSize); return (const tNode*)getLevelData(_levelIndex); }
+
+	// Copy all levels to tree_, which must be of the same type (see isType()) and have the same level count. Return false if an error
+	// occurred.
+	template <typename tTree>
+	bool        read(tTree& tree_);
+
+	bool        isLoaded() const                                                             { return m_file.isOpen(); }
+	const char* getPath() const                                                              { return m_file.getPath(); }
+	Mode        getMode() const                                                              { return m_mode; }
+	int         getDimensions() const                                                        { return (int)m_header.m_dimensions; }
+	int         getLevelCount() const                                                        { return (int)m_header.m_levelCount; }
+	bool        isLevelCompressed(int _levelIndex) const                                     { return m_levels[_levelIndex].m_compression != CompressionFlags_None; }
+
+private:
+
+	struct Header
+	{
+		uint32 m_magic;
+		uint32 m_version;
+		uint32 m_dimensions;     // 2 = Quadtree, 3 = Octree.
+		uint32 m_indexSize;      // sizeof(tTree::Index).
+		uint32 m_nodeSize;       // sizeof(tTree::Node).
+		uint32 m_levelCount;
+		uint32 m_reserved[10];
+	};
+
+	struct Level
+	{
+		uint64 m_offset;         // From the start of the file, multiple of kDataAlignment.
+		uint64 m_size;           // Stored size (bytes).
+		uint64 m_rawSize;        // Uncompressed size (bytes).
+		uint32 m_compression;    // CompressionFlags_None if the level isn't compressed.
+		uint32 m_reserved;
+	};
+
+	MappedFile                 m_file;
+	Mode                       m_mode     = Mode_Lazy;
+	Header                     m_header   = {};
+	eastl::vector<Level>       m_levels;
+	eastl::vector<const char*> m_levelData;          // Mapped or decompressed level data, nullptr until first access.
+	const char*                m_fileData = nullptr; // Whole file view (Mode_Eager).
+
+	// Write _levelCount contiguous levels starting at _nodes. _levelSizes is the size (bytes) of each level.
+	static bool WriteLevels(const char* _path, int _dimensions, uint _indexSize, uint _nodeSize, int _levelCount, const char* _nodes, const uint64* _levelSizes, uint64 _compressedLevels, CompressionFlags _compression);
+
+	template <typename tTree>
+	static int  GetDimensions()                                                              { return tTree::GetNodeCount(1) == 4 ? 2 : 3; }
+
+	// Read and validate the header and level table.
+	bool        loadHeader();
+
+	const char* getLevelData(int _levelIndex);
+};
+
+
+/*******************************************************************************
+
+                                  TreeSnapshot
+
+*******************************************************************************/
+
+template <typename tTree>
+inline bool TreeSnapshot::Write(const tTree& _tree, const char* _path, uint64 _compressedLevels, CompressionFlags _compression)
+{
+	typedef typename tTree::Index Index;
+	typedef typename tTree::Node  Node;
+	APT_STATIC_ASSERT((!std::is_same<Node, bool>::value)); // bool specializations aren't supported
+	APT_STATIC_ASSERT(std::is_trivially_copyable<Node>::value);
+
+	uint64 levelSizes[sizeof(Index) * CHAR_BIT];
+	int levelCount = _tree.getLevelCount();
+	APT_ASSERT(levelCount <= (int)APT_ARRAY_COUNT(levelSizes));
+	for (int i = 0; i < levelCount; ++i)
+	{
+		levelSizes[i] = (uint64)tTree::GetNodeCount(i) * sizeof(Node);
+	}
+	return WriteLevels(_path, GetDimensions<tTree>(), sizeof(Index), sizeof(Node), levelCount, (const char*)_tree.getLevel(0), levelSizes, _compressedLevels, _compression);
+}
+
+template <typename tTree>
+inline bool TreeSnapshot::isType() const
+{
+	return isLoaded()
+		&& m_header.m_dimensions == (uint32)GetDimensions<tTree>()
+		&& m_header.m_indexSize  == sizeof(typename tTree::Index)
+		&& m_header.m_nodeSize   == sizeof(typename tTree::Node)
+		;
+}
+
+template <typename tTree>
+inline bool TreeSnapshot::read(tTree& tree_)
+{
+	typedef typename tTree::Node Node;
+	APT_STATIC_ASSERT((!std::is_same<Node, bool>::value)); // bool specializations aren't supported
+	APT_STATIC_ASSERT(std::is_trivially_copyable<Node>::value);
+
+	if (!isType<tTree>())
+	{
+		APT_LOG_ERR("Error reading '%s': tree type mismatch", getPath());
+		return false;
+	}
+	if (tree_.getLevelCount() != getLevelCount())
+	{
+		APT_LOG_ERR("Error reading '%s': level count mismatch (%d, expected %d)", getPath(), tree_.getLevelCount(), getLevelCount());
+		return false;
+	}
+	for (int i = 0; i < getLevelCount(); ++i)
+	{
+		const char* data = getLevelData(i);
+		if (!data)
+		{
+			return false;
+		}
+		memcpy(tree_.getLevel(i), data, (size_t)m_levels[i].m_rawSize);
+	}
+	return true;
+}
+
+} // namespace apt
@@ -105,29 +105,51 @@ inline constexpr unsigned ArrayCount(const tType (&)[kCount]) { return kCount; }
 
 #include <apt/types.h>
 
+namespace eastl {
+	class allocator;
+}
+
 namespace apt {
 
 // Forward declarations
+class Arena;
+class ArenaAllocator;
 class ArgList;
+class ConcurrentMemoryPool;
+template <typename tType, typename tAllocator = eastl::allocator, uint kBlockSize = 256> class ConcurrentPersistentVector;
 template <typename tType> class Factory;
 class File;
 class FileSystem;
 class Image;
 class Json;
+class LargeAllocator;
+class MappedFile;
+class MemoryInstrumentation;
 class MemoryPool;
-template <typename tIndex, typename tNode> class Octree;
-template <typename tType> class PersistentVector;
-template <typename tType> class Pool;
-template <typename tIndex, typename tNode> class Quadtree;
+class MemoryPoolAllocator;
+template <typename tType> class MpmcQueue;
+template <typename tIndex, typename tNode, typename tAllocator = eastl::allocator> class Octree;
+template <typename tType, typename tAllocator = eastl::allocator, uint kBlockSize = 0> class PersistentVector;
+template <typename tType, typename tMemoryPool = MemoryPool> class Pool;
+class ProxyAllocator;
+template <typename tIndex, typename tNode, typename tAllocator = eastl::allocator> class Quadtree;
 template <typename PRNG>  class Rand;
 template <typename tType> class RingBuffer;
 class Serializer;
 	class SerializerJson;
+class SlabAllocator;
+template <typename tType, typename tHandle = uint32, typename tAllocator = eastl::allocator> class SlotMap;
+template <typename tIndex, typename tNode, typename tAllocator = eastl::allocator> class SparseOctree;
+template <typename tType> class SpscRingBuffer;
 class StringBase;
 	template <uint kCapacity> class String;
 class StringHash;
+template <typename tValue, typename tAllocator = eastl::allocator> class StringHashMap;
+class TaggedAllocator;
 class TextParser;
+class ThreadCachedMemoryPool;
 class Timestamp;
+class TreeSnapshot;
 class DateTime;
 
 typedef String<128> PathStr;
@@ -5,6 +5,9 @@
 //#define APT_ENABLE_ASSERT              1   // Enable asserts. If APT_DEBUG this is enabled by default.
 //#define APT_ENABLE_STRICT_ASSERT       1   // Enable 'strict' asserts.
 //#define APT_LOG_CALLBACK_ONLY          1   // By default, log messages are written to stdout/stderr prior to the log callback dispatch. Disable this behavior.
+//#define APT_ENABLE_MEMORY_INSTRUMENTATION 1 // Track allocations made via APT_MALLOC et al. per memory tag (see MemoryInstrumentation.h).
+//#define APT_ENABLE_SLAB_ALLOCATOR      1   // Service small allocations made via APT_MALLOC et al. from SlabAllocator (see SlabAllocator.h).
+//#define APT_LARGE_ALLOC_THRESHOLD      (2 * 1024 * 1024) // Min size at which APT_MALLOC_LARGE allocates directly from the OS (see memory.h).
 
 #if defined(APT_DEBUG)
 	#ifndef APT_ENABLE_ASSERT
@@ -3,6 +3,10 @@
 #include <apt/apt.h>
 #include <linalg/linalg.h>
 
+#if APT_COMPILER_MSVC
+	#include <intrin.h> // _BitScanForward64, _BitScanReverse64
+#endif
+
 namespace apt {
 	using linalg::identity;
 
@@ -188,6 +192,58 @@ namespace apt {
 	inline tType ModPow2(const tType& _x, const tType& _y)                      { return _x & (_y - 1); }
 	#define APT_MOD_POW2(_x, _y) apt::ModPow2(_x, _y)
 
+	// Return the number of set bits in _x.
+	inline uint32 CountBits(uint64 _x)
+	{
+	#if APT_COMPILER_GNU
+		return (uint32)__builtin_popcountll(_x);
+	#else
+		_x = _x - ((_x >> 1) & 0x5555555555555555ull);
+		_x = (_x & 0x3333333333333333ull) + ((_x >> 2) & 0x3333333333333333ull);
+		_x = (_x + (_x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+		return (uint32)((_x * 0x0101010101010101ull) >> 56);
+	#endif
+	}
+
+	// Return the index of the least significant set bit in _x. _x must be nonzero.
+	inline uint32 FindFirstSet(uint64 _x)
+	{
+		APT_ASSERT(_x != 0);
+	#if APT_COMPILER_GNU
+		return (uint32)__builtin_ctzll(_x);
+	#elif APT_COMPILER_MSVC
+		unsigned long ret;
+		_BitScanForward64(&ret, _x);
+		return (uint32)ret;
+	#else
+		uint32 ret = 0;
+		while ((_x & 1) == 0) {
+			_x >>= 1;
+			++ret;
+		}
+		return ret;
+	#endif
+	}
+
+	// Return the index of the most significant set bit in _x. _x must be nonzero.
+	inline uint32 FindLastSet(uint64 _x)
+	{
+		APT_ASSERT(_x != 0);
+	#if APT_COMPILER_GNU
+		return 63u - (uint32)__builtin_clzll(_x);
+	#elif APT_COMPILER_MSVC
+		unsigned long ret;
+		_BitScanReverse64(&ret, _x);
+		return (uint32)ret;
+	#else
+		uint32 ret = 0;
+		while (_x >>= 1) {
+			++ret;
+		}
+		return ret;
+	#endif
+	}
+
 	namespace internal {
 		template <typename tType>
 		inline tType Fract(const tType& _x, FloatT)                             { return _x - std::floor(_x); }
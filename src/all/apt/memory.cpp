@@ -1,6 +1,36 @@
 #include <apt/memory.h>
 
+#include <apt/Arena.h>
+#include <apt/math.h>
+#include <apt/MemoryInstrumentation.h>
+#include <apt/SlabAllocator.h>
+
 #include <cstdlib>
+#include <mutex>
+
+// Arena redirection (see ArenaScope). Each allocation is prefixed with its size so that realloc can copy the old contents; the prefix 
+// is padded to preserve the requested alignment.
+static size_t ArenaPrefixSize(size_t _align)
+{
+	return APT_MAX(_align, (size_t)apt::Arena::kDefaultAlignment);
+}
+
+static void* ArenaMalloc(apt::Arena* _arena, size_t _size, size_t _align)
+{
+	size_t prefix = ArenaPrefixSize(_align);
+	char* ret = (char*)_arena->alloc((apt::uint)(_size + prefix), (apt::uint)_align) + prefix;
+	((size_t*)ret)[-1] = _size;
+	return ret;
+}
+
+static void* ArenaRealloc(apt::Arena* _arena, void* _ptr, size_t _size, size_t _align)
+{
+	size_t prefix  = ArenaPrefixSize(_align);
+	size_t oldSize = ((size_t*)_ptr)[-1];
+	char*  ret     = (char*)_arena->realloc((char*)_ptr - prefix, (apt::uint)(oldSize + prefix), (apt::uint)(_size + prefix), (apt::uint)_align) + prefix;
+	((size_t*)ret)[-1] = _size;
+	return ret;
+}
 
 #if 1
 	void* operator new(size_t _size)
@@ -21,54 +51,351 @@
 	}
 #endif
 
-void* apt::internal::malloc(size_t _size)
+static void* RawMalloc(size_t _size)
 {
+	apt::Arena* arena = apt::Arena::GetThreadArena();
+	if_unlikely (arena) {
+		return ArenaMalloc(arena, _size, apt::Arena::kDefaultAlignment);
+	}
+#if APT_ENABLE_SLAB_ALLOCATOR
+	if (_size <= apt::SlabAllocator::kMaxSize) {
+		void* ret = apt::SlabAllocator::Alloc((apt::uint)_size);
+		if_likely (ret) {
+			return ret;
+		}
+	}
+#endif
 	return ::malloc(_size);
 }
 
-void* apt::internal::realloc(void* _ptr, size_t _size)
+static void* RawRealloc(void* _ptr, size_t _size)
 {
+	apt::Arena* arena = apt::Arena::GetThreadArena();
+	if_unlikely (arena) {
+		if (!_ptr) {
+			return ArenaMalloc(arena, _size, apt::Arena::kDefaultAlignment);
+		}
+		if (arena->isFromArena(_ptr)) {
+			return ArenaRealloc(arena, _ptr, _size, apt::Arena::kDefaultAlignment);
+		}
+	}
+#if APT_ENABLE_SLAB_ALLOCATOR
+	if (!_ptr) {
+		return RawMalloc(_size);
+	}
+	if (apt::SlabAllocator::IsFromSlab(_ptr)) {
+		size_t blockSize = apt::SlabAllocator::GetBlockSize(_ptr);
+		if (_size <= blockSize) {
+			return _ptr;
+		}
+		void* ret = RawMalloc(_size);
+		if (ret) {
+			memcpy(ret, _ptr, blockSize);
+			apt::SlabAllocator::Free(_ptr);
+		}
+		return ret;
+	}
+#endif
 	return ::realloc(_ptr, _size);
 }
 
-void apt::internal::free(void* _ptr)
+static void RawFree(void* _ptr)
 {
+	apt::Arena* arena = apt::Arena::GetThreadArena();
+	if_unlikely (arena) {
+		if (arena->isFromArena(_ptr)) {
+			return; // released by Arena::rewind/reset
+		}
+	}
+#if APT_ENABLE_SLAB_ALLOCATOR
+	if (apt::SlabAllocator::IsFromSlab(_ptr)) {
+		apt::SlabAllocator::Free(_ptr);
+		return;
+	}
+#endif
 	::free(_ptr);
 }
 
-void* apt::internal::malloc_aligned(size_t _size, size_t _align) 
+static void* RawMallocAligned(size_t _size, size_t _align)
 {
+	apt::Arena* arena = apt::Arena::GetThreadArena();
+	if_unlikely (arena) {
+		return ArenaMalloc(arena, _size, _align);
+	}
 #if 1//#ifdef APT_COMPILER_MSVC
 	return _aligned_malloc(_size, _align);
 #else
-	aligned_alloc(_align, _size);
+	return aligned_alloc(_align, _size);
 #endif
 }
 
-void* apt::internal::realloc_aligned(void* _ptr, size_t _size, size_t _align)
+static void* RawReallocAligned(void* _ptr, size_t _size, size_t _align)
 {
+	apt::Arena* arena = apt::Arena::GetThreadArena();
+	if_unlikely (arena) {
+		if (!_ptr) {
+			return ArenaMalloc(arena, _size, _align);
+		}
+		if (arena->isFromArena(_ptr)) {
+			return ArenaRealloc(arena, _ptr, _size, _align);
+		}
+	}
 #if 1//#ifdef APT_COMPILER_MSVC
 	return _aligned_realloc(_ptr, _size, _align);
 #else
 	if (_ptr) {
-		return realloc(_ptr, _size);
+		return RawRealloc(_ptr, _size);
 	} else {
-		return malloc_aligned(_size, _align);
+		return RawMallocAligned(_size, _align);
 	}
 #endif
 }
 
-void apt::internal::free_aligned(void* _ptr) 
+static void RawFreeAligned(void* _ptr)
 {
+	apt::Arena* arena = apt::Arena::GetThreadArena();
+	if_unlikely (arena) {
+		if (arena->isFromArena(_ptr)) {
+			return;
+		}
+	}
 #if 1//#ifdef APT_COMPILER_MSVC
 	_aligned_free(_ptr);
 #else
-	free(_ptr);
+	::free(_ptr);
+#endif
+}
+
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+// Instrumented allocations are prefixed by a header; the prefix is padded to preserve the requested alignment. Aligned allocations 
+// are made with alignment = prefix size so that realloc doesn't need to know the original alignment. The header records which of the 
+// raw functions made the allocation so that mismatched APT_FREE/APT_FREE_ALIGNED calls are safe.
+namespace {
+
+struct AllocHeader
+{
+	apt::uint64 m_size;
+	apt::uint32 m_tag;
+	apt::uint16 m_prefix;
+	apt::uint16 m_aligned;
+};
+static_assert(sizeof(AllocHeader) == 16, "AllocHeader must be 16 bytes to preserve the default malloc alignment");
+
+AllocHeader* GetHeader(void* _ptr)
+{
+	return (AllocHeader*)_ptr - 1;
+}
+
+void* WriteHeader(void* _base, size_t _size, size_t _prefix, bool _aligned, int _tag)
+{
+	if (!_base) {
+		return nullptr;
+	}
+	char* ret = (char*)_base + _prefix;
+	AllocHeader* header = GetHeader(ret);
+	header->m_size    = _size;
+	header->m_tag     = (apt::uint32)_tag;
+	header->m_prefix  = (apt::uint16)_prefix;
+	header->m_aligned = _aligned ? 1 : 0;
+	apt::internal::RecordAlloc(_tag, _size);
+	return ret;
+}
+
+// _align == 0 for the unaligned variants.
+void* InstrumentedMalloc(size_t _size, size_t _align)
+{
+	if (_align == 0) {
+		return WriteHeader(RawMalloc(_size + sizeof(AllocHeader)), _size, sizeof(AllocHeader), false, apt::MemoryInstrumentation::GetThreadTag());
+	}
+	size_t prefix = APT_MAX(_align, sizeof(AllocHeader));
+	return WriteHeader(RawMallocAligned(_size + prefix, prefix), _size, prefix, true, apt::MemoryInstrumentation::GetThreadTag());
+}
+
+void* InstrumentedRealloc(void* _ptr, size_t _size, size_t _align)
+{
+	if (!_ptr) {
+		return InstrumentedMalloc(_size, _align);
+	}
+	AllocHeader header = *GetHeader(_ptr);
+	APT_ASSERT(header.m_aligned || _align == 0);
+	APT_ASSERT(!header.m_aligned || header.m_prefix % _align == 0); // realloc_aligned with a different alignment
+	apt::internal::RecordFree((int)header.m_tag, (size_t)header.m_size);
+	void* base = (char*)_ptr - header.m_prefix;
+	base = header.m_aligned
+		? RawReallocAligned(base, _size + header.m_prefix, header.m_prefix)
+		: RawRealloc(base, _size + header.m_prefix)
+		;
+	return WriteHeader(base, _size, header.m_prefix, header.m_aligned != 0, (int)header.m_tag); // the original tag is retained
+}
+
+void InstrumentedFree(void* _ptr)
+{
+	if (!_ptr) {
+		return;
+	}
+	AllocHeader* header = GetHeader(_ptr);
+	apt::internal::RecordFree((int)header->m_tag, (size_t)header->m_size);
+	void* base = (char*)_ptr - header->m_prefix;
+	if (header->m_aligned) {
+		RawFreeAligned(base);
+	} else {
+		RawFree(base);
+	}
+}
+
+} // namespace
+#endif // APT_ENABLE_MEMORY_INSTRUMENTATION
+
+void* apt::internal::malloc(size_t _size)
+{
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	return InstrumentedMalloc(_size, 0);
+#else
+	return RawMalloc(_size);
+#endif
+}
+
+void* apt::internal::realloc(void* _ptr, size_t _size)
+{
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	return InstrumentedRealloc(_ptr, _size, 0);
+#else
+	return RawRealloc(_ptr, _size);
+#endif
+}
+
+void apt::internal::free(void* _ptr)
+{
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	InstrumentedFree(_ptr);
+#else
+	RawFree(_ptr);
+#endif
+}
+
+void* apt::internal::malloc_aligned(size_t _size, size_t _align)
+{
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	return InstrumentedMalloc(_size, _align);
+#else
+	return RawMallocAligned(_size, _align);
+#endif
+}
+
+void* apt::internal::realloc_aligned(void* _ptr, size_t _size, size_t _align)
+{
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	return InstrumentedRealloc(_ptr, _size, _align);
+#else
+	return RawReallocAligned(_ptr, _size, _align);
+#endif
+}
+
+void apt::internal::free_aligned(void* _ptr)
+{
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	InstrumentedFree(_ptr);
+#else
+	RawFreeAligned(_ptr);
 #endif
 }
 
+thread_local apt::LargeAllocPolicy apt::LargeAllocScope::s_policy   = apt::LargeAlloc_Auto;
+thread_local bool                  apt::LargeAllocScope::s_prefault = false;
+
+namespace apt { namespace internal {
+
+// Implemented per platform (see src/<platform>/apt/memoryImpl.cpp). Return a kLargePageSize-aligned ptr to at least _size bytes,
+// or nullptr on failure. base_ receives the ptr to pass to PlatformFreeLarge().
+void* PlatformMallocLarge(size_t _size, bool _prefault, void*& base_);
+void  PlatformFreeLarge(void* _base);
+
+} } // namespace apt::internal
+
+// Registry of OS allocations made by malloc_large; free_large uses this to distinguish them from allocations which fell back to 
+// APT_MALLOC. Large allocations are infrequent, hence a linear search is sufficient.
+namespace {
+
+struct LargeAlloc
+{
+	void*  m_ptr;
+	void*  m_base;
+	size_t m_size;
+	int    m_tag;
+};
+
+LargeAlloc* s_largeAllocs;
+size_t      s_largeAllocCount;
+size_t      s_largeAllocCapacity;
+
+std::mutex& GetLargeAllocMutex()
+{
+	static std::mutex s_mutex; // function static, large allocations may be made during static initialization
+	return s_mutex;
+}
+
+} // namespace
+
+void* apt::internal::malloc_large(size_t _size)
+{
+	LargeAllocPolicy policy = LargeAllocScope::GetPolicy();
+	bool useOs = policy == LargeAlloc_Always || (policy == LargeAlloc_Auto && _size >= APT_LARGE_ALLOC_THRESHOLD);
+	if (!useOs || Arena::GetThreadArena()) { // respect ArenaScope
+		return APT_MALLOC(_size);
+	}
+
+	void* base = nullptr;
+	void* ret = PlatformMallocLarge(_size, LargeAllocScope::GetPrefault(), base);
+	if_unlikely (!ret) {
+		return APT_MALLOC(_size);
+	}
+	APT_ASSERT((size_t)ret % kLargePageSize == 0);
+
+	LargeAlloc entry = { ret, base, _size, MemoryInstrumentation::GetThreadTag() };
+	{	std::lock_guard<std::mutex> lock(GetLargeAllocMutex());
+		if (s_largeAllocCount == s_largeAllocCapacity) {
+			s_largeAllocCapacity = APT_MAX(s_largeAllocCapacity * 2, (size_t)16);
+			s_largeAllocs = (LargeAlloc*)::realloc(s_largeAllocs, sizeof(LargeAlloc) * s_largeAllocCapacity); // bookkeeping isn't counted
+			APT_ASSERT(s_largeAllocs);
+		}
+		s_largeAllocs[s_largeAllocCount++] = entry;
+	}
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	RecordAlloc(entry.m_tag, _size);
+#endif
+	return ret;
+}
+
+void apt::internal::free_large(void* _ptr)
+{
+	if (!_ptr) {
+		return;
+	}
+	if ((size_t)_ptr % kLargePageSize == 0) { // OS allocations are always aligned, skip the search otherwise
+		LargeAlloc entry = {};
+		{	std::lock_guard<std::mutex> lock(GetLargeAllocMutex());
+			for (size_t i = 0; i < s_largeAllocCount; ++i) {
+				if (s_largeAllocs[i].m_ptr == _ptr) {
+					entry = s_largeAllocs[i];
+					s_largeAllocs[i] = s_largeAllocs[--s_largeAllocCount];
+					break;
+				}
+			}
+		}
+		if (entry.m_ptr) {
+		#if APT_ENABLE_MEMORY_INSTRUMENTATION
+			RecordFree(entry.m_tag, entry.m_size);
+		#endif
+			PlatformFreeLarge(entry.m_base);
+			return;
+		}
+	}
+	APT_FREE(_ptr);
+}
+
 // EASTL new[] overloads
 #include <EABase/eabase.h>
+#include <EASTL/internal/config.h> // EASTL_SYSTEM_ALLOCATOR_MIN_ALIGNMENT
 #include <stddef.h>
 #include <new>
 #if defined(EA_COMPILER_NO_EXCEPTIONS) && (!defined(__MWERKS__) || defined(_MSL_NO_THROW_SPECS)) && !defined(EA_COMPILER_RVCT)
@@ -86,11 +413,19 @@ void* operator new[](size_t size, const char* /*name*/, int /*flags*/, unsigned
 
 void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* /*name*/, int flags, unsigned /*debugFlags*/, const char* /*file*/, int /*line*/) THROW_SPEC_1(std::bad_alloc)
 {
-#if 1//#ifdef APT_COMPILER_MSVC
-	return _aligned_offset_malloc(size, alignment, alignmentOffset);
+	if (alignmentOffset != 0) {
+	 // no allocator can return offset-aligned memory which delete[] (APT_FREE) can release
+		APT_ASSERT_MSG(false, "EASTL aligned offset allocations are not supported");
+		return nullptr;
+	}
+ // EASTL releases all allocations via delete[], i.e. APT_FREE
+	if (alignment <= EASTL_SYSTEM_ALLOCATOR_MIN_ALIGNMENT) {
+		return APT_MALLOC(size);
+	}
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+	return APT_MALLOC_ALIGNED(size, alignment); // the header records the alignment, APT_FREE is safe
 #else
- // \todo no standard 'offset' version, implement via aligned_alloc
-	APT_ASSERT(false);
+	APT_ASSERT_MSG(false, "EASTL over-aligned allocations (%u) require APT_ENABLE_MEMORY_INSTRUMENTATION, use an apt allocator instead (see Allocator.h)", (unsigned)alignment);
 	return nullptr;
 #endif
 }
\ No newline at end of file
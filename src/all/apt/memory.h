@@ -10,6 +10,8 @@
 #define APT_MALLOC_ALIGNED(size, align)         (apt::internal::malloc_aligned(size, align))
 #define APT_REALLOC_ALIGNED(ptr, size, align)   (apt::internal::realloc_aligned(ptr, size, align))
 #define APT_FREE_ALIGNED(ptr)                   (apt::internal::free_aligned(ptr))
+#define APT_MALLOC_LARGE(size)                  (apt::internal::malloc_large(size))
+#define APT_FREE_LARGE(ptr)                     (apt::internal::free_large(ptr))
 #define APT_NEW(type)                           (new type)
 #define APT_NEW_ARRAY(type, count)              (new type[count])
 #define APT_DELETE(ptr)                         (delete ptr)
@@ -23,6 +25,8 @@ void  free(void* _ptr);
 void* malloc_aligned(size_t _size, size_t _align);
 void* realloc_aligned(void* _ptr, size_t _size, size_t _align);
 void  free_aligned(void* _ptr);
+void* malloc_large(size_t _size);
+void  free_large(void* _ptr);
 
 template <size_t kAlignment> struct aligned_base;
 	template<> struct alignas(1)   aligned_base<1>   {};
@@ -36,8 +40,72 @@ template <size_t kAlignment> struct aligned_base;
 
 } } // namespace apt::internal
 
+#ifndef APT_LARGE_ALLOC_THRESHOLD
+	#define APT_LARGE_ALLOC_THRESHOLD (2 * 1024 * 1024)
+#endif
+
 namespace apt {
 
+////////////////////////////////////////////////////////////////////////////////
+// Large allocations
+// APT_MALLOC_LARGE is intended for big buffers which are streamed over, e.g.
+// Image and File data. Allocations of at least APT_LARGE_ALLOC_THRESHOLD bytes
+// are made directly from the OS, aligned to kLargePageSize and backed by large
+// pages where available to reduce TLB misses. On Windows large pages require
+// the 'Lock pages in memory' privilege; if unavailable regular pages are used
+// (the alignment is preserved). Smaller allocations are forwarded to
+// APT_MALLOC.
+//
+// Memory from APT_MALLOC_LARGE must be released via APT_FREE_LARGE.
+//
+// Use LargeAllocScope to override the default policy for allocations made on
+// the calling thread, e.g. to opt out at a particular call site:
+//
+//    { LargeAllocScope scope(LargeAlloc_Never);
+//       Image* img = Image::Create2d(4096, 4096, ...); // APT_MALLOC
+//    }
+////////////////////////////////////////////////////////////////////////////////
+constexpr size_t kLargePageSize = 2 * 1024 * 1024;
+
+enum LargeAllocPolicy
+{
+	LargeAlloc_Auto,   // Allocate from the OS if size >= APT_LARGE_ALLOC_THRESHOLD.
+	LargeAlloc_Always, // Always allocate from the OS.
+	LargeAlloc_Never,  // Always use APT_MALLOC.
+
+	LargeAlloc_Count
+};
+
+class LargeAllocScope: private non_copyable<LargeAllocScope>
+{
+public:
+	// If _prefault is true, memory allocated from the OS is touched at allocation time so that page faults aren't incurred on first
+	// access (large pages are always resident).
+	LargeAllocScope(LargeAllocPolicy _policy, bool _prefault = false)
+		: m_prevPolicy(s_policy)
+		, m_prevPrefault(s_prefault)
+	{
+		s_policy   = _policy;
+		s_prefault = _prefault;
+	}
+
+	~LargeAllocScope()
+	{
+		s_policy   = m_prevPolicy;
+		s_prefault = m_prevPrefault;
+	}
+
+	static LargeAllocPolicy GetPolicy()    { return s_policy; }
+	static bool             GetPrefault()  { return s_prefault; }
+
+private:
+	LargeAllocPolicy m_prevPolicy;
+	bool             m_prevPrefault;
+
+	static thread_local LargeAllocPolicy s_policy;
+	static thread_local bool             s_prefault;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // aligned
 // Mixin class, provides template-based memory alignment for deriving classes.
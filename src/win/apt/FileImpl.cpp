@@ -1,5 +1,6 @@
 #include <apt/File.h>
 
+#include <apt/Allocator.h>
 #include <apt/log.h>
 #include <apt/memory.h>
 #include <apt/platform.h>
@@ -12,7 +13,20 @@
 
 namespace apt {
 
+static LargeAllocator* GetLargeAllocator()
+{
+	static LargeAllocator s_largeAllocator("File"); // function static, Files may be constructed during static initialization
+	return &s_largeAllocator;
+}
+
 File::File()
+	: m_data(ProxyAllocator(GetLargeAllocator(), "File"))
+{
+	m_impl = INVALID_HANDLE_VALUE;
+}
+
+File::File(const ProxyAllocator& _allocator)
+	: m_data(_allocator)
 {
 	m_impl = INVALID_HANDLE_VALUE;
 }
@@ -38,7 +52,7 @@ bool File::Read(File& file_, const char* _path)
 	}
 	APT_ASSERT(_path);
 
-	eastl::vector<char> data;
+	Data  data(file_.m_data.get_allocator());
 	bool  ret       = false;
 	DWORD err       = 0;
 	int   tryCount  = 5; // avoid sharing violations, especially when loading a file after a file change notification
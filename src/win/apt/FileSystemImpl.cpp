@@ -7,6 +7,7 @@
 #include <apt/Pool.h>
 #include <apt/String.h>
 #include <apt/StringHash.h>
+#include <apt/StringHashMap.h>
 #include <apt/TextParser.h>
 
 #include <Shlwapi.h>
@@ -15,7 +16,6 @@
 #include <cstring>
 
 #include <EASTL/vector.h>
-#include <EASTL/vector_map.h>
 
 #pragma comment(lib, "shlwapi")
 
@@ -464,7 +464,7 @@ namespace {
 		eastl::vector<eastl::pair<PathStr, FileSystem::FileAction> > m_dispatchQueue;
 	};
 	static Pool<Watch> s_WatchPool(8);
-	static eastl::vector_map<StringHash, Watch*> s_WatchMap;
+	static StringHashMap<Watch*> s_WatchMap;
 
 	void CALLBACK WatchCompletion(DWORD _err, DWORD _bytes, LPOVERLAPPED _overlapped);
 	void          WatchUpdate(Watch* _watch);
@@ -0,0 +1,132 @@
+#include <apt/MappedFile.h>
+
+#include <apt/log.h>
+#include <apt/platform.h>
+#include <apt/win.h>
+
+namespace apt {
+
+// Views must start at a multiple of the allocation granularity (typically 64kb).
+static uint64 GetAllocationGranularity()
+{
+	static uint64 s_granularity = 0;
+	if (s_granularity == 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		s_granularity = (uint64)info.dwAllocationGranularity;
+	}
+	return s_granularity;
+}
+
+MappedFile::MappedFile()
+{
+	m_impl = INVALID_HANDLE_VALUE;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char* _path)
+{
+	APT_ASSERT(_path);
+
+	bool   ret     = false;
+	DWORD  err     = 0;
+	HANDLE mapping = NULL;
+	LARGE_INTEGER li;
+
+	HANDLE h = CreateFile(
+		_path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+		);
+	if (h == INVALID_HANDLE_VALUE)
+	{
+		err = GetLastError();
+		goto MappedFile_open_end;
+	}
+
+	if (!GetFileSizeEx(h, &li))
+	{
+		err = GetLastError();
+		goto MappedFile_open_end;
+	}
+
+	mapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL); // fails if the file is empty
+	if (mapping == NULL)
+	{
+		err = GetLastError();
+		goto MappedFile_open_end;
+	}
+
+	ret = true;
+
+  // close existing handles
+	close();
+
+	m_impl    = h;
+	m_mapping = mapping;
+	m_size    = (uint64)li.QuadPart;
+	m_path.set(_path);
+
+MappedFile_open_end:
+	if (!ret)
+	{
+		APT_LOG_ERR("Error opening '%s':\n\t%s", _path, GetPlatformErrorString((uint64)err));
+		if (h != INVALID_HANDLE_VALUE)
+		{
+			APT_PLATFORM_VERIFY(CloseHandle(h));
+		}
+	}
+	return ret;
+}
+
+void MappedFile::close()
+{
+	if (m_mapping)
+	{
+		APT_PLATFORM_VERIFY(CloseHandle((HANDLE)m_mapping));
+		m_mapping = nullptr;
+	}
+	if ((HANDLE)m_impl != INVALID_HANDLE_VALUE)
+	{
+		APT_PLATFORM_VERIFY(CloseHandle((HANDLE)m_impl));
+		m_impl = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+
+const char* MappedFile::map(uint64 _offset, uint64 _size)
+{
+	APT_ASSERT(isOpen());
+	APT_ASSERT(_size > 0); // MapViewOfFile maps to the end of the file if the size is 0
+	APT_ASSERT(_offset + _size <= m_size);
+
+	uint64 base = _offset - _offset % GetAllocationGranularity();
+	void* view = MapViewOfFile((HANDLE)m_mapping, FILE_MAP_READ, (DWORD)(base >> 32), (DWORD)base, (SIZE_T)(_offset - base + _size));
+	if (!view)
+	{
+		APT_LOG_ERR("Error mapping '%s' [%llu, %llu):\n\t%s", getPath(), _offset, _offset + _size, GetPlatformErrorString((uint64)GetLastError()));
+		return nullptr;
+	}
+	return (const char*)view + (_offset - base);
+}
+
+void MappedFile::unmap(const char* _data, uint64 _size)
+{
+	APT_ASSERT(_data);
+	(void)_size;
+
+ // views are aligned to the allocation granularity, see map()
+	uint64 addr = (uint64)_data;
+	APT_PLATFORM_VERIFY(UnmapViewOfFile((LPCVOID)(addr - addr % GetAllocationGranularity())));
+}
+
+} // namespace apt
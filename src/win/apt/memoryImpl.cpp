@@ -0,0 +1,97 @@
+#include <apt/memory.h>
+
+#include <apt/log.h>
+#include <apt/platform.h>
+#include <apt/win.h>
+
+using namespace apt;
+
+// Large pages require SeLockMemoryPrivilege ('Lock pages in memory' in the local security policy). Enable it once, return the large
+// page size or 0 if large pages aren't available.
+static size_t InitLargePages()
+{
+	size_t ret = (size_t)GetLargePageMinimum();
+	if (ret == 0 || kLargePageSize % ret != 0) {
+		return 0;
+	}
+
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+		return 0;
+	}
+	TOKEN_PRIVILEGES tp = {};
+	tp.PrivilegeCount = 1;
+	tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool enabled = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL)
+		&& GetLastError() == ERROR_SUCCESS // AdjustTokenPrivileges returns TRUE with ERROR_NOT_ALL_ASSIGNED if the privilege isn't held
+		;
+	APT_PLATFORM_VERIFY(CloseHandle(token));
+	if (!enabled) {
+		APT_LOG_DBG("Large pages unavailable (SeLockMemoryPrivilege not held), using regular pages for large allocations");
+		return 0;
+	}
+	return ret;
+}
+
+static size_t GetLargePageSize()
+{
+	static size_t s_largePageSize = InitLargePages();
+	return s_largePageSize;
+}
+
+static size_t GetPageSize()
+{
+	static size_t s_pageSize = []() {
+		SYSTEM_INFO sysinf;
+		GetSystemInfo(&sysinf);
+		return (size_t)sysinf.dwPageSize;
+	}();
+	return s_pageSize;
+}
+
+namespace apt { namespace internal {
+
+void* PlatformMallocLarge(size_t _size, bool _prefault, void*& base_)
+{
+ // large pages are always resident, hence _prefault is ignored
+	size_t largePageSize = GetLargePageSize();
+	if (largePageSize != 0) {
+		size_t size = (_size + largePageSize - 1) & ~(largePageSize - 1);
+		void* ret = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (ret && (size_t)ret % kLargePageSize == 0) {
+			base_ = ret;
+			return ret;
+		}
+		if (ret) {
+			APT_PLATFORM_VERIFY(VirtualFree(ret, 0, MEM_RELEASE));
+		}
+	 // large pages may fail due to fragmentation of physical memory, fall through to regular pages
+	}
+
+ // reserve an extra kLargePageSize to align the committed range
+	size_t size = (_size + GetPageSize() - 1) & ~(GetPageSize() - 1);
+	char* base = (char*)VirtualAlloc(NULL, size + kLargePageSize, MEM_RESERVE, PAGE_NOACCESS);
+	if (!base) {
+		return nullptr;
+	}
+	char* ret = (char*)(((size_t)base + kLargePageSize - 1) & ~(kLargePageSize - 1));
+	if (!VirtualAlloc(ret, size, MEM_COMMIT, PAGE_READWRITE)) {
+		APT_PLATFORM_VERIFY(VirtualFree(base, 0, MEM_RELEASE));
+		return nullptr;
+	}
+	if (_prefault) {
+		for (size_t i = 0; i < size; i += GetPageSize()) {
+			((volatile char*)ret)[i] = 0;
+		}
+	}
+	base_ = base;
+	return ret;
+}
+
+void PlatformFreeLarge(void* _base)
+{
+	APT_PLATFORM_VERIFY(VirtualFree(_base, 0, MEM_RELEASE));
+}
+
+} } // namespace apt::internal
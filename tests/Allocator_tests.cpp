@@ -0,0 +1,93 @@
+#include <catch.hpp>
+
+#include <apt/Allocator.h>
+#include <apt/Arena.h>
+#include <apt/MemoryPool.h>
+#include <apt/Octree.h>
+#include <apt/PersistentVector.h>
+#include <apt/Quadtree.h>
+
+#include <EASTL/list.h>
+#include <EASTL/vector.h>
+
+using namespace apt;
+
+TEST_CASE("MemoryPoolAllocator", "[Allocator]")
+{
+	typedef eastl::list<int, MemoryPoolAllocator> List;
+	MemoryPool pool(sizeof(List::node_type), alignof(List::node_type), 64);
+	{	List list(MemoryPoolAllocator(&pool, "MemoryPoolAllocator test"));
+		for (int i = 0; i < 100; ++i) {
+			list.push_back(i);
+		}
+		REQUIRE(pool.getUsedCount() == 100);
+		REQUIRE(pool.isFromPool(&list.back()));
+		list.pop_front();
+		REQUIRE(pool.getUsedCount() == 99);
+	}
+	REQUIRE(pool.getUsedCount() == 0);
+
+ // allocations larger than the object size fall back to the heap
+	eastl::vector<uint64, MemoryPoolAllocator> v(MemoryPoolAllocator(&pool, "MemoryPoolAllocator test"));
+	v.resize(100);
+	REQUIRE(!pool.isFromPool(v.data()));
+	REQUIRE(pool.getUsedCount() == 0);
+}
+
+TEST_CASE("ArenaAllocator", "[Allocator]")
+{
+	Arena arena;
+	eastl::vector<int, ArenaAllocator> v(ArenaAllocator(&arena, "ArenaAllocator test"));
+	v.reserve(100);
+	for (int i = 0; i < 100; ++i) {
+		v.push_back(i);
+	}
+	REQUIRE(arena.isFromArena(v.data()));
+
+	Quadtree<uint32, int, ArenaAllocator> quadtree(4, 0, ArenaAllocator(&arena));
+	REQUIRE(arena.isFromArena(&quadtree[0]));
+	REQUIRE(quadtree.getIndex(quadtree[5]) == 5);
+
+	Octree<uint32, int, ArenaAllocator> octree(3, 0, ArenaAllocator(&arena));
+	REQUIRE(arena.isFromArena(&octree[0]));
+
+	PersistentVector<int, ArenaAllocator> pv(16, ArenaAllocator(&arena));
+	for (int i = 0; i < 100; ++i) {
+		pv.push_back(i);
+	}
+	REQUIRE(arena.isFromArena(&pv[0]));
+	REQUIRE(arena.isFromArena(&pv[99]));
+	REQUIRE(pv[99] == 99);
+}
+
+TEST_CASE("ProxyAllocator", "[Allocator]")
+{
+	Arena arena;
+	ArenaAllocator arenaAllocator(&arena);
+	eastl::vector<char, ProxyAllocator> v{ ProxyAllocator(&arenaAllocator) };
+	v.resize(64);
+	REQUIRE(arena.isFromArena(v.data()));
+
+	eastl::vector<char, ProxyAllocator> heap; // default, allocates from the heap
+	heap.resize(64);
+	REQUIRE(!arena.isFromArena(heap.data()));
+	REQUIRE(heap.get_allocator() != v.get_allocator());
+}
+
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+TEST_CASE("TaggedAllocator", "[Allocator]")
+{
+	TaggedAllocator allocator("Allocator_tests");
+	MemoryInstrumentation::Stats before;
+	MemoryInstrumentation::GetStats(allocator.getTag(), before);
+	{	eastl::vector<char, TaggedAllocator> v(allocator);
+		v.resize(1000);
+		MemoryInstrumentation::Stats after;
+		MemoryInstrumentation::GetStats(allocator.getTag(), after);
+		REQUIRE(after.m_liveBytes >= before.m_liveBytes + 1000);
+	}
+	MemoryInstrumentation::Stats after;
+	MemoryInstrumentation::GetStats(allocator.getTag(), after);
+	REQUIRE(after.m_liveBytes == before.m_liveBytes);
+}
+#endif
@@ -0,0 +1,275 @@
+#include <catch.hpp>
+
+#include <apt/log.h>
+#include <apt/Morton.h>
+#include <apt/Octree.h>
+#include <apt/Quadtree.h>
+#include <apt/rand.h>
+#include <apt/Time.h>
+
+#include <EASTL/vector.h>
+
+using namespace apt;
+
+// Reference implementation, interleave 1 bit at a time.
+template <typename tCode>
+static tCode Interleave(const uint32* _coords, int _dim)
+{
+	tCode ret = 0;
+	for (int i = 0; i < (int)(sizeof(tCode) * CHAR_BIT); ++i) {
+		int axis = i % _dim;
+		int bit  = i / _dim;
+		ret |= (tCode)((_coords[axis] >> bit) & 1) << i;
+	}
+	return ret;
+}
+
+template <typename tCode>
+static void TestMorton()
+{
+	const uint32 max2 = (uint32)((uint64(1) << (sizeof(tCode) * CHAR_BIT / 2)) - 1);
+	const uint32 max3 = (uint32)((uint64(1) << (sizeof(tCode) * CHAR_BIT / 3)) - 1);
+	Rand<> rnd;
+	bool ok = true;
+	for (int i = 0; i < 10000; ++i) {
+		uint32 c2[2] = { rnd.raw() & max2, rnd.raw() & max2 };
+		tCode code2 = MortonEncode2<tCode>((tCode)c2[0], (tCode)c2[1]);
+		ok &= code2 == Interleave<tCode>(c2, 2);
+		ok &= MortonDecode2(code2) == uvec2(c2[0], c2[1]);
+
+		uint32 c3[3] = { rnd.raw() & max3, rnd.raw() & max3, rnd.raw() & max3 };
+		tCode code3 = MortonEncode3<tCode>((tCode)c3[0], (tCode)c3[1], (tCode)c3[2]);
+		ok &= code3 == Interleave<tCode>(c3, 3);
+		ok &= MortonDecode3(code3) == uvec3(c3[0], c3[1], c3[2]);
+	}
+	REQUIRE(ok);
+}
+
+TEST_CASE("Morton", "[Morton]")
+{
+	TestMorton<uint16>();
+	TestMorton<uint32>();
+	TestMorton<uint64>();
+
+	static_assert(MortonEncode2<uint32>(3, 0) == 5, "");
+	static_assert(MortonEncode3<uint64>(1, 1, 1) == 7, "");
+	static_assert(MortonCompact2<uint32>(0xffffffffu) == 0xffff, "");
+}
+
+TEST_CASE("Morton batch", "[Morton]")
+{
+	const uint kCount = 1000;
+	Rand<> rnd;
+	eastl::vector<uvec2>  c2(kCount);
+	eastl::vector<uvec3>  c3(kCount);
+	eastl::vector<uint64> codes(kCount);
+	for (uint i = 0; i < kCount; ++i) {
+		c2[i] = uvec2(rnd.raw(), rnd.raw());
+		c3[i] = uvec3(rnd.raw() & 0x1fffff, rnd.raw() & 0x1fffff, rnd.raw() & 0x1fffff);
+	}
+
+	bool ok = true;
+	MortonEncode2(c2.data(), codes.data(), kCount);
+	for (uint i = 0; i < kCount; ++i) {
+		ok &= codes[i] == MortonEncode2<uint64>(c2[i].x, c2[i].y);
+	}
+	eastl::vector<uvec2> d2(kCount);
+	MortonDecode2(codes.data(), d2.data(), kCount);
+	ok &= d2 == c2;
+
+	MortonEncode3(c3.data(), codes.data(), kCount);
+	for (uint i = 0; i < kCount; ++i) {
+		ok &= codes[i] == MortonEncode3<uint64>(c3[i].x, c3[i].y, c3[i].z);
+	}
+	eastl::vector<uvec3> d3(kCount);
+	MortonDecode3(codes.data(), d3.data(), kCount);
+	ok &= d3 == c3;
+	REQUIRE(ok);
+}
+
+template <typename tTree>
+static void TestFindLevel(int _levelCount)
+{
+	bool ok = true;
+	for (int level = 0; level < _levelCount; ++level) {
+		typename tTree::Index beg = tTree::GetLevelStartIndex(level);
+		typename tTree::Index end = beg + tTree::GetNodeCount(level) - 1;
+		ok &= tTree::FindLevel(beg) == level;
+		ok &= tTree::FindLevel(end) == level;
+	}
+	REQUIRE(ok);
+	REQUIRE(tTree::FindLevel(tTree::Index_Invalid) == -1);
+}
+
+TEST_CASE("Morton FindLevel", "[Morton]")
+{
+	TestFindLevel<Quadtree<uint16, int> >(8);
+	TestFindLevel<Quadtree<uint32, int> >(16);
+	TestFindLevel<Quadtree<uint64, int> >(32);
+	TestFindLevel<Octree<uint16, int> >(5);
+	TestFindLevel<Octree<uint32, int> >(10);
+	TestFindLevel<Octree<uint64, int> >(21);
+
+ // ToIndex/ToCartesian round trip at the deepest level
+	typedef Octree<uint64, int> Tree;
+	uint64 i = Tree::ToIndex(12345, 54321, 99999, 20);
+	REQUIRE(Tree::FindLevel(i) == 20);
+	REQUIRE(Tree::ToCartesian(i, 20) == uvec3(12345, 54321, 99999));
+}
+
+TEST_CASE("Morton encode", "[.benchmark]")
+{
+	const uint kCount = 1 << 20;
+	eastl::vector<uvec3>  coords(kCount);
+	eastl::vector<uint64> codes(kCount);
+	Rand<> rnd;
+	for (auto& c : coords) {
+		c = uvec3(rnd.raw() & 0x1fffff, rnd.raw() & 0x1fffff, rnd.raw() & 0x1fffff);
+	}
+
+	Timestamp t = Time::GetTimestamp();
+	for (uint i = 0; i < kCount; ++i) {
+		uint32 c[3] = { coords[i].x, coords[i].y, coords[i].z };
+		codes[i] = Interleave<uint64>(c, 3);
+	}
+	double msLoop = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	for (uint i = 0; i < kCount; ++i) {
+		codes[i] = MortonEncode3<uint64>(coords[i].x, coords[i].y, coords[i].z);
+	}
+	double msMagic = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	MortonEncode3(coords.data(), codes.data(), kCount);
+	double msBatch = (Time::GetTimestamp() - t).asMilliseconds();
+
+	APT_LOG("MortonEncode3 x%u: loop %.2fms, magic bits %.2fms, batch (bmi2 = %d) %.2fms", kCount, msLoop, msMagic, (int)MortonUseBmi2(), msBatch);
+}
+
+// Reference neighbor search via ToCartesian()/ToIndex().
+template <typename tTree>
+static typename tTree::Index FindNeighborRef(typename tTree::Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY)
+{
+	uvec2 offset = tTree::ToCartesian(_nodeIndex, _nodeLevel) + uvec2(_offsetX, _offsetY);
+	return tTree::ToIndex(offset.x, offset.y, _nodeLevel);
+}
+template <typename tTree>
+static typename tTree::Index FindNeighborRef(typename tTree::Index _nodeIndex, int _nodeLevel, int _offsetX, int _offsetY, int _offsetZ)
+{
+	uvec3 offset = tTree::ToCartesian(_nodeIndex, _nodeLevel) + uvec3(_offsetX, _offsetY, _offsetZ);
+	return tTree::ToIndex(offset.x, offset.y, offset.z, _nodeLevel);
+}
+
+template <typename tTree>
+static void TestFindNeighbor2(int _levelCount)
+{
+	typedef typename tTree::Index Index;
+	Rand<> rnd;
+	bool ok = true;
+	eastl::vector<Index> nodes;
+	for (int i = 0; i < 2000; ++i) {
+		int level = i % _levelCount;
+		int width = (int)tTree::GetWidth(level);
+		Index node = tTree::GetLevelStartIndex(level) + (Index)(rnd.raw() % tTree::GetNodeCount(level));
+		int ox = (int)(rnd.raw() % (2 * width + 1)) - width;
+		int oy = (i & 1) ? (int)(rnd.raw() % 3) - 1 : (int)(rnd.raw() % (2 * width + 1)) - width;
+		ok &= tTree::FindNeighbor(node, level, ox, oy) == FindNeighborRef<tTree>(node, level, ox, oy);
+		nodes.push_back(node);
+	}
+	REQUIRE(ok);
+
+	eastl::vector<Index> neighbors(nodes.size() * 4);
+	tTree::FindEdgeNeighbors(nodes.data(), neighbors.data(), (uint)nodes.size());
+	for (uint i = 0; i < nodes.size(); ++i) {
+		int level = tTree::FindLevel(nodes[i]);
+		ok &= neighbors[i * 4 + 0] == FindNeighborRef<tTree>(nodes[i], level, -1,  0);
+		ok &= neighbors[i * 4 + 1] == FindNeighborRef<tTree>(nodes[i], level,  1,  0);
+		ok &= neighbors[i * 4 + 2] == FindNeighborRef<tTree>(nodes[i], level,  0, -1);
+		ok &= neighbors[i * 4 + 3] == FindNeighborRef<tTree>(nodes[i], level,  0,  1);
+	}
+	REQUIRE(ok);
+}
+
+template <typename tTree>
+static void TestFindNeighbor3(int _levelCount)
+{
+	typedef typename tTree::Index Index;
+	Rand<> rnd;
+	bool ok = true;
+	eastl::vector<Index> nodes;
+	for (int i = 0; i < 2000; ++i) {
+		int level = i % _levelCount;
+		int width = (int)tTree::GetWidth(level);
+		Index node = tTree::GetLevelStartIndex(level) + (Index)(rnd.raw() % tTree::GetNodeCount(level));
+		int ox = (int)(rnd.raw() % (2 * width + 1)) - width;
+		int oy = (int)(rnd.raw() % (2 * width + 1)) - width;
+		int oz = (i & 1) ? (int)(rnd.raw() % 3) - 1 : (int)(rnd.raw() % (2 * width + 1)) - width;
+		ok &= tTree::FindNeighbor(node, level, ox, oy, oz) == FindNeighborRef<tTree>(node, level, ox, oy, oz);
+		nodes.push_back(node);
+	}
+	REQUIRE(ok);
+
+	eastl::vector<Index> neighbors(nodes.size() * 6);
+	tTree::FindFaceNeighbors(nodes.data(), neighbors.data(), (uint)nodes.size());
+	for (uint i = 0; i < nodes.size(); ++i) {
+		int level = tTree::FindLevel(nodes[i]);
+		for (int axis = 0; axis < 3; ++axis) {
+			for (int j = 0; j < 2; ++j) {
+				int offset[3] = {};
+				offset[axis] = j ? 1 : -1;
+				ok &= neighbors[i * 6 + axis * 2 + j] == FindNeighborRef<tTree>(nodes[i], level, offset[0], offset[1], offset[2]);
+			}
+		}
+	}
+	REQUIRE(ok);
+}
+
+TEST_CASE("Morton FindNeighbor", "[Morton]")
+{
+	TestFindNeighbor2<Quadtree<uint8,  int> >(4);
+	TestFindNeighbor2<Quadtree<uint16, int> >(8);
+	TestFindNeighbor2<Quadtree<uint32, int> >(16);
+	TestFindNeighbor2<Quadtree<uint64, int> >(32);
+	TestFindNeighbor3<Octree<uint8,  int> >(2);
+	TestFindNeighbor3<Octree<uint16, int> >(5);
+	TestFindNeighbor3<Octree<uint32, int> >(10);
+	TestFindNeighbor3<Octree<uint64, int> >(21);
+}
+
+TEST_CASE("Morton FindEdgeNeighbors", "[.benchmark]")
+{
+	typedef Quadtree<uint32, int> Tree;
+	const int kLevel = 12;
+	const uint kCount = 1 << 20;
+	eastl::vector<uint32> nodes(kCount);
+	eastl::vector<uint32> neighbors(kCount * 4);
+	Rand<> rnd;
+	for (auto& node : nodes) {
+		node = Tree::GetLevelStartIndex(kLevel) + (rnd.raw() % Tree::GetNodeCount(kLevel));
+	}
+
+	Timestamp t = Time::GetTimestamp();
+	for (uint i = 0; i < kCount; ++i) {
+		neighbors[i * 4 + 0] = FindNeighborRef<Tree>(nodes[i], kLevel, -1,  0);
+		neighbors[i * 4 + 1] = FindNeighborRef<Tree>(nodes[i], kLevel,  1,  0);
+		neighbors[i * 4 + 2] = FindNeighborRef<Tree>(nodes[i], kLevel,  0, -1);
+		neighbors[i * 4 + 3] = FindNeighborRef<Tree>(nodes[i], kLevel,  0,  1);
+	}
+	double msCartesian = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	for (uint i = 0; i < kCount; ++i) {
+		neighbors[i * 4 + 0] = Tree::FindNeighbor(nodes[i], kLevel, -1,  0);
+		neighbors[i * 4 + 1] = Tree::FindNeighbor(nodes[i], kLevel,  1,  0);
+		neighbors[i * 4 + 2] = Tree::FindNeighbor(nodes[i], kLevel,  0, -1);
+		neighbors[i * 4 + 3] = Tree::FindNeighbor(nodes[i], kLevel,  0,  1);
+	}
+	double msFindNeighbor = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	Tree::FindEdgeNeighbors(nodes.data(), neighbors.data(), kCount);
+	double msBatch = (Time::GetTimestamp() - t).asMilliseconds();
+
+	APT_LOG("Quadtree edge neighbors x%u: ToCartesian/ToIndex %.2fms, FindNeighbor %.2fms, FindEdgeNeighbors %.2fms", kCount, msCartesian, msFindNeighbor, msBatch);
+}
@@ -0,0 +1,141 @@
+#include <catch.hpp>
+
+#include <apt/log.h>
+#include <apt/MpmcQueue.h>
+#include <apt/Time.h>
+
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace apt;
+
+TEST_CASE("MpmcQueue", "[MpmcQueue]")
+{
+	MpmcQueue<int> queue(100);
+	REQUIRE(queue.capacity() == 128);
+	REQUIRE(queue.empty());
+
+	int v;
+	REQUIRE(!queue.tryPop(v));
+	for (int i = 0; i < 128; ++i) {
+		REQUIRE(queue.tryPush(i));
+	}
+	REQUIRE(!queue.tryPush(128));
+	REQUIRE(queue.size() == 128);
+	REQUIRE(queue.tryPop(v));
+	REQUIRE(v == 0);
+	REQUIRE(queue.tryPush(128)); // wrap
+
+	int out[200];
+	REQUIRE(queue.tryPop(out, 100) == 100);
+	REQUIRE(out[0] == 1);
+	REQUIRE(out[99] == 100);
+	REQUIRE(queue.tryPop(out, 200) == 28);
+	REQUIRE(out[27] == 128);
+	REQUIRE(queue.tryPop(out, 0) == 0);
+	REQUIRE(queue.empty());
+
+ // non-trivial type, remaining elements are destructed by ~MpmcQueue
+	MpmcQueue<eastl::string> strings(4);
+	REQUIRE(strings.tryPush(eastl::string("a long string which doesn't fit in the small string buffer")));
+	strings.push("b");
+	eastl::string s;
+	strings.pop(s);
+	REQUIRE(s == "a long string which doesn't fit in the small string buffer");
+}
+
+TEST_CASE("MpmcQueue producers/consumers", "[MpmcQueue]")
+{
+	const int kProducerCount = 4;
+	const int kConsumerCount = 4;
+	const int kCount = 100000; // per producer
+
+	MpmcQueue<int> queue(256);
+	std::atomic<int> popCount(0);
+	std::vector<std::atomic<int> > seen(kProducerCount * kCount);
+	for (auto& n : seen) {
+		n = 0;
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < kProducerCount; ++i) {
+		threads.push_back(std::thread([&, i]() {
+			for (int j = 0; j < kCount; ++j) {
+				queue.push(i * kCount + j);
+			}
+		}));
+	}
+	for (int i = 0; i < kConsumerCount; ++i) {
+		threads.push_back(std::thread([&, i]() {
+			int values[16];
+			while (popCount.load() < kProducerCount * kCount) {
+				uint n = (i & 1) ? queue.tryPop(values, 16) : (uint)queue.tryPop(values[0]);
+				for (uint j = 0; j < n; ++j) {
+					++seen[values[j]];
+				}
+				popCount += (int)n;
+			}
+		}));
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	bool ok = true;
+	for (auto& n : seen) {
+		ok &= n.load() == 1;
+	}
+	REQUIRE(ok);
+	REQUIRE(queue.empty());
+}
+
+TEST_CASE("MpmcQueue throughput/latency", "[.benchmark]")
+{
+	const int kCount = 1000000; // total per run
+	const int kMaxThreads = APT_MAX((int)std::thread::hardware_concurrency() / 2, 1);
+
+	for (int producerCount = 1; producerCount <= kMaxThreads; producerCount *= 2) {
+		for (int consumerCount = 1; consumerCount <= kMaxThreads; consumerCount *= 2) {
+			MpmcQueue<sint64> queue(1024);
+			std::atomic<int> popCount(0);
+			std::atomic<sint64> totalLatency(0);
+			std::vector<std::thread> threads;
+			Timestamp t = Time::GetTimestamp();
+			for (int i = 0; i < producerCount; ++i) {
+				threads.push_back(std::thread([&, i]() {
+					for (int j = i; j < kCount; j += producerCount) {
+						queue.push(Time::GetTimestamp().getRaw());
+					}
+				}));
+			}
+			for (int i = 0; i < consumerCount; ++i) {
+				threads.push_back(std::thread([&]() {
+					sint64 values[32];
+					sint64 latency = 0;
+					while (popCount.load(std::memory_order_relaxed) < kCount) {
+						uint n = queue.tryPop(values, 32);
+						if (n == 0) {
+							std::this_thread::yield();
+							continue;
+						}
+						sint64 now = Time::GetTimestamp().getRaw();
+						for (uint j = 0; j < n; ++j) {
+							latency += now - values[j];
+						}
+						popCount += (int)n;
+					}
+					totalLatency += latency;
+				}));
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			double ms = (Time::GetTimestamp() - t).asMilliseconds();
+			APT_LOG("MpmcQueue %dP/%dC: %.2f Mops/s, mean latency %.2fus", producerCount, consumerCount, (double)kCount / ms / 1000.0, Timestamp(totalLatency.load() / kCount).asMicroseconds());
+		}
+	}
+}
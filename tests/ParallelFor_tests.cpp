@@ -0,0 +1,48 @@
+#include <catch.hpp>
+
+#include <apt/ParallelFor.h>
+
+#include <EASTL/vector.h>
+
+#include <atomic>
+
+using namespace apt;
+
+TEST_CASE("ParallelFor", "[ParallelFor]")
+{
+	for (uint threadCount : { 1u, 2u, 3u, 8u, 0u }) {
+		for (uint count : { 0u, 1u, 7u, 1000u }) {
+			eastl::vector<std::atomic<int> > visits(count);
+			for (auto& v : visits) {
+				v.store(0);
+			}
+			ParallelFor(count, [&](uint _i) {
+					visits[_i].fetch_add(1, std::memory_order_relaxed);
+				},
+				threadCount);
+			bool ok = true;
+			for (auto& v : visits) {
+				ok &= v.load() == 1;
+			}
+			REQUIRE(ok);
+		}
+	}
+}
+
+TEST_CASE("ParallelFor uneven", "[ParallelFor]")
+{
+ // all the work is in the first range, other threads must steal it
+	const uint kCount = 256;
+	std::atomic<uint64> sum(0);
+	ParallelFor(kCount, [&](uint _i) {
+			if (_i < kCount / 4) {
+				volatile uint64 x = 0;
+				for (uint j = 0; j < 10000; ++j) {
+					x = x + j;
+				}
+			}
+			sum.fetch_add(_i, std::memory_order_relaxed);
+		},
+		4);
+	REQUIRE(sum.load() == (uint64)kCount * (kCount - 1) / 2);
+}
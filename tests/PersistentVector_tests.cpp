@@ -0,0 +1,206 @@
+#include <catch.hpp>
+
+#include <apt/log.h>
+#include <apt/ConcurrentPersistentVector.h>
+#include <apt/PersistentVector.h>
+#include <apt/Time.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace apt;
+
+template <typename tVector>
+static void TestPersistentVector(tVector& _v)
+{
+	for (int i = 0; i < 1000; ++i) {
+		_v.push_back(i);
+	}
+	REQUIRE(_v.size() == 1000);
+	REQUIRE(_v.capacity() % _v.getBlockSize() == 0);
+
+	int* first = &_v[0];
+	for (int i = 1000; i < 2000; ++i) {
+		_v.push_back(i);
+	}
+	REQUIRE(&_v[0] == first); // elements never move
+
+	bool ok = true;
+	for (int i = 0; i < 2000; ++i) {
+		ok &= _v[i] == i;
+	}
+	REQUIRE(ok);
+
+	int i = 0;
+	for (auto it = _v.begin(); it != _v.end(); ++it, ++i) {
+		ok &= *it == i;
+	}
+	REQUIRE(ok);
+	REQUIRE(i == 2000);
+
+	for (int j = 0; j < 500; ++j) {
+		_v.pop_back();
+	}
+	REQUIRE(_v.back() == 1499);
+
+	uint total = 0;
+	uint chunkCount = 0;
+	_v.forEachChunk([&](int* _data, uint _count) {
+		for (uint j = 0; j < _count; ++j) {
+			ok &= _data[j] == (int)(total + j);
+		}
+		total += _count;
+		++chunkCount;
+	});
+	REQUIRE(ok);
+	REQUIRE(total == 1500);
+	REQUIRE(chunkCount == (1500 + _v.getBlockSize() - 1) / _v.getBlockSize());
+
+	_v.clear();
+	chunkCount = 0;
+	_v.forEachChunk([&](int*, uint) { ++chunkCount; });
+	REQUIRE(chunkCount == 0);
+}
+
+TEST_CASE("PersistentVector", "[PersistentVector]")
+{
+	PersistentVector<int> v(100);
+	TestPersistentVector(v);
+
+	PersistentVector<int, eastl::allocator, 128> vpow2;
+	REQUIRE(vpow2.getBlockSize() == 128);
+	TestPersistentVector(vpow2);
+
+	const PersistentVector<int, eastl::allocator, 128>& cv = vpow2;
+	cv.forEachChunk([](const int*, uint) {});
+}
+
+TEST_CASE("ConcurrentPersistentVector", "[PersistentVector]")
+{
+	const int kThreadCount = 4;
+	const int kCount = 20000;
+
+	struct Item { int m_thread; int m_value; };
+	ConcurrentPersistentVector<Item, eastl::allocator, 64> v(kThreadCount * kCount / 64 + 1);
+
+ // writers append while a reader checks that the committed prefix is always fully constructed and grows monotonically
+	std::atomic<int> done(0);
+	std::atomic<int> errors(0);
+	std::thread reader([&]() {
+		uint prevSize = 0;
+		while (done.load() < kThreadCount) {
+			uint n = 0;
+			v.forEachChunk([&](const Item* _data, uint _count) {
+				for (uint i = 0; i < _count; ++i) {
+					if (_data[i].m_value != _data[i].m_thread * kCount + _data[i].m_value % kCount || _data[i].m_value < 0) {
+						++errors;
+					}
+				}
+				n += _count;
+			});
+			if (n < prevSize) {
+				++errors;
+			}
+			prevSize = n;
+		}
+	});
+	std::vector<std::thread> writers;
+	for (int i = 0; i < kThreadCount; ++i) {
+		writers.push_back(std::thread([&, i]() {
+			for (int j = 0; j < kCount; ++j) {
+				uint index = v.push_back(Item{ i, i * kCount + j });
+				if (v[index].m_value != i * kCount + j) {
+					++errors;
+				}
+			}
+			++done;
+		}));
+	}
+	for (auto& writer : writers) {
+		writer.join();
+	}
+	reader.join();
+	REQUIRE(errors.load() == 0);
+	REQUIRE(v.size() == kThreadCount * kCount);
+	REQUIRE(v.getReservedCount() == kThreadCount * kCount);
+
+ // each value appears exactly once, per-thread order is preserved
+	std::vector<int> seen(kThreadCount * kCount, 0);
+	std::vector<int> last(kThreadCount, -1);
+	bool ok = true;
+	for (uint i = 0; i < v.size(); ++i) {
+		const Item& item = v[i];
+		++seen[item.m_value];
+		ok &= item.m_value > last[item.m_thread];
+		last[item.m_thread] = item.m_value;
+	}
+	for (int n : seen) {
+		ok &= n == 1;
+	}
+	REQUIRE(ok);
+
+	v.clear();
+	REQUIRE(v.size() == 0);
+	v.push_back(Item{ 0, 1 });
+	REQUIRE(v.size() == 1);
+}
+
+TEST_CASE("ConcurrentPersistentVector max size", "[PersistentVector]")
+{
+	typedef ConcurrentPersistentVector<int, eastl::allocator, 4> Vector;
+	Vector v(2);
+	for (int i = 0; i < 8; ++i) {
+		REQUIRE(v.push_back(i) == (uint)i);
+	}
+	REQUIRE(v.push_back(8) == Vector::kInvalidIndex);
+	REQUIRE(v.push_back(9) == Vector::kInvalidIndex);
+	REQUIRE(v.size() == 8);
+	REQUIRE(v.getReservedCount() == 8);
+	REQUIRE(v[7] == 7);
+
+	v.clear();
+	REQUIRE(v.push_back(0) == 0);
+	REQUIRE(v.size() == 1);
+}
+
+TEST_CASE("PersistentVector iteration", "[.benchmark]")
+{
+	const uint kCount = 16 * 1024 * 1024;
+
+	auto run = [](auto& _v, const char* _name) {
+		for (uint i = 0; i < kCount; ++i) {
+			_v.push_back((float)(i & 0xff));
+		}
+
+		float sum = 0.0f;
+		Timestamp t = Time::GetTimestamp();
+		for (uint i = 0; i < kCount; ++i) {
+			sum += _v[i];
+		}
+		APT_LOG("%-24s index    %.2fms (%f)", _name, (Time::GetTimestamp() - t).asMilliseconds(), sum);
+
+		sum = 0.0f;
+		t = Time::GetTimestamp();
+		for (auto it = _v.begin(); it != _v.end(); ++it) {
+			sum += *it;
+		}
+		APT_LOG("%-24s iterator %.2fms (%f)", _name, (Time::GetTimestamp() - t).asMilliseconds(), sum);
+
+		sum = 0.0f;
+		t = Time::GetTimestamp();
+		_v.forEachChunk([&sum](const float* _data, uint _count) {
+			for (uint i = 0; i < _count; ++i) {
+				sum += _data[i];
+			}
+		});
+		APT_LOG("%-24s chunk    %.2fms (%f)", _name, (Time::GetTimestamp() - t).asMilliseconds(), sum);
+	};
+
+	{	PersistentVector<float> v(1024);
+		run(v, "runtime block size");
+	}
+	{	PersistentVector<float, eastl::allocator, 1024> v;
+		run(v, "kBlockSize");
+	}
+}
@@ -0,0 +1,352 @@
+#include <catch.hpp>
+
+#include <apt/log.h>
+#include <apt/math.h>
+#include <apt/ConcurrentMemoryPool.h>
+#include <apt/Pool.h>
+#include <apt/ThreadCachedMemoryPool.h>
+#include <apt/Time.h>
+
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using namespace apt;
+
+struct PoolTestObject
+{
+	uint64 m_value;
+	uint64 m_pad[3];
+};
+
+TEST_CASE("MemoryPool batch alloc/free and trim", "[Pool]")
+{
+	const uint kBlockSize = 64;
+	MemoryPool pool(sizeof(PoolTestObject), alignof(PoolTestObject), kBlockSize);
+
+	eastl::vector<void*> objects(kBlockSize * 10);
+	pool.allocBatch(objects.data(), (uint)objects.size());
+	REQUIRE(pool.getBlockCount() == 10);
+	REQUIRE(pool.getUsedCount() == objects.size());
+	REQUIRE(pool.validate());
+	bool fromPool = true;
+	bool aligned = true;
+	for (void* object : objects) {
+		fromPool &= pool.isFromPool(object);
+		aligned  &= (uint)object % alignof(PoolTestObject) == 0;
+	}
+	REQUIRE(fromPool);
+	REQUIRE(aligned);
+	REQUIRE(!pool.isFromPool(&pool));
+
+ // free all but 1 object, all but 1 block become empty
+	void* survivor = objects[kBlockSize * 5];
+	objects.erase(objects.begin() + kBlockSize * 5);
+	pool.freeBatch(objects.data(), (uint)objects.size());
+	REQUIRE(pool.getUsedCount() == 1);
+	REQUIRE(pool.validate());
+
+	REQUIRE(pool.trim(2) == 7);
+	REQUIRE(pool.getBlockCount() == 3);
+	REQUIRE(pool.validate());
+	REQUIRE(pool.isFromPool(survivor));
+
+ // allocations are serviced from the partially used block first
+	void* obj = pool.alloc();
+	REQUIRE(pool.getUsedCount() == 2);
+	REQUIRE(pool.trim() == 2);
+	REQUIRE(pool.getBlockCount() == 1);
+	REQUIRE(pool.isFromPool(obj));
+	REQUIRE(pool.validate());
+
+	pool.free(obj);
+	pool.free(survivor);
+	REQUIRE(pool.trim() == 1);
+	REQUIRE(pool.getCapacity() == 0);
+	REQUIRE(pool.validate());
+
+ // pool is still usable after trimming all blocks
+	obj = pool.alloc();
+	REQUIRE(pool.getBlockCount() == 1);
+	pool.free(obj);
+}
+
+TEST_CASE("MemoryPool::FindPool", "[Pool]")
+{
+	MemoryPool poolA(16, 16, 8);
+	MemoryPool poolB(64, 16, 8);
+
+	eastl::vector<void*> objectsA(100);
+	eastl::vector<void*> objectsB(100);
+	poolA.allocBatch(objectsA.data(), (uint)objectsA.size());
+	poolB.allocBatch(objectsB.data(), (uint)objectsB.size());
+
+	bool foundA = true;
+	bool foundB = true;
+	for (uint i = 0; i < objectsA.size(); ++i) {
+		foundA &= MemoryPool::FindPool(objectsA[i]) == &poolA;
+		foundB &= MemoryPool::FindPool(objectsB[i]) == &poolB;
+	}
+	REQUIRE(foundA);
+	REQUIRE(foundB);
+	REQUIRE(MemoryPool::FindPool(&poolA) == nullptr);
+	REQUIRE(MemoryPool::FindPool(nullptr) == nullptr);
+
+ // route frees via FindPool
+	for (uint i = 0; i < objectsA.size(); ++i) {
+		MemoryPool::FindPool(objectsB[i])->free(objectsB[i]);
+		MemoryPool::FindPool(objectsA[i])->free(objectsA[i]);
+	}
+	REQUIRE(poolA.getUsedCount() == 0);
+	REQUIRE(poolB.getUsedCount() == 0);
+	REQUIRE(poolA.validate());
+	REQUIRE(poolB.validate());
+
+ // trimmed blocks are removed from the directory
+	void* obj = poolA.alloc();
+	poolA.free(obj);
+	poolA.trim();
+	REQUIRE(MemoryPool::FindPool(obj) == nullptr);
+
+ // swap updates the owning pool
+	obj = poolB.alloc();
+	swap(poolA, poolB);
+	REQUIRE(MemoryPool::FindPool(obj) == &poolA);
+	poolA.free(obj);
+}
+
+TEST_CASE("MemoryPool::FindPool concurrent", "[Pool]")
+{
+	const int kThreadCount = 4;
+
+	MemoryPool poolA(16, 16, 8);
+	eastl::vector<void*> objectsA(100);
+	poolA.allocBatch(objectsA.data(), (uint)objectsA.size());
+
+	std::atomic<bool> done(false);
+	std::atomic<int> errorCount(0); // Catch assertions aren't thread safe
+	eastl::vector<std::thread> threads;
+
+ // look up live objects while another thread (de)allocates blocks
+	for (int i = 0; i < kThreadCount; ++i) {
+		threads.emplace_back([&] {
+			while (!done.load()) {
+				for (void* obj : objectsA) {
+					if (MemoryPool::FindPool(obj) != &poolA) {
+						++errorCount;
+					}
+				}
+			}
+		});
+	}
+	{
+		MemoryPool poolB(32, 16, 4);
+		eastl::vector<void*> objectsB(200);
+		for (int i = 0; i < 200; ++i) {
+			poolB.allocBatch(objectsB.data(), (uint)objectsB.size());
+			poolB.freeBatch(objectsB.data(), (uint)objectsB.size());
+			poolB.trim();
+		}
+	}
+	done = true;
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	REQUIRE(errorCount == 0);
+	poolA.freeBatch(objectsA.data(), (uint)objectsA.size());
+}
+
+TEST_CASE("ThreadCachedMemoryPool cross-thread alloc/free", "[Pool]")
+{
+	const int kThreadCount = 8;
+	const int kAllocCount  = 10000;
+
+	Pool<PoolTestObject, ThreadCachedMemoryPool> pool(256);
+	eastl::vector<PoolTestObject*> objects[kThreadCount];
+	eastl::vector<std::thread> threads;
+	std::atomic<int> errorCount(0); // Catch assertions aren't thread safe
+
+ // allocate on each thread
+	for (int i = 0; i < kThreadCount; ++i) {
+		threads.emplace_back([&pool, &objects, i] {
+			for (int j = 0; j < kAllocCount; ++j) {
+				PoolTestObject* obj = pool.alloc();
+				obj->m_value = (uint64)j;
+				objects[i].push_back(obj);
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+	REQUIRE(pool.getUsedCount() == kThreadCount * kAllocCount);
+
+ // free on a different thread to the one which allocated
+	for (int i = 0; i < kThreadCount; ++i) {
+		threads.emplace_back([&pool, &objects, &errorCount, i] {
+			auto& list = objects[(i + 1) % kThreadCount];
+			for (int j = 0; j < (int)list.size(); ++j) {
+				if (list[j]->m_value != (uint64)j) {
+					++errorCount;
+				}
+				pool.free(list[j]);
+			}
+			pool.flush();
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	REQUIRE(errorCount == 0);
+	REQUIRE(pool.getUsedCount() == 0);
+	REQUIRE(pool.getRefillCount() > 0);
+	REQUIRE(pool.getSpillCount() > 0);
+	REQUIRE(pool.validate());
+}
+
+TEST_CASE("ConcurrentMemoryPool contention", "[Pool]")
+{
+	const int kThreadCount = 8;
+	const int kIterations  = 20000;
+	const int kBatchSize   = 16;
+
+	ConcurrentPool<PoolTestObject> pool(64, 4096);
+	std::atomic<int> errorCount(0);
+
+ // objects are passed between threads via a shared lock-free 'mailbox' array so that most frees happen on a different thread to the alloc
+	std::atomic<PoolTestObject*> mailbox[kThreadCount * kBatchSize];
+	for (auto& slot : mailbox) {
+		slot.store(nullptr);
+	}
+
+	eastl::vector<std::thread> threads;
+	for (int i = 0; i < kThreadCount; ++i) {
+		threads.emplace_back([&pool, &mailbox, &errorCount, i] {
+			uint64 tag = (uint64)i << 32;
+			for (int j = 0; j < kIterations; ++j) {
+				PoolTestObject* obj = pool.alloc();
+				obj->m_value = tag | (uint64)j;
+				obj = mailbox[(j * 7 + i) % APT_ARRAY_COUNT(mailbox)].exchange(obj);
+				if (obj) {
+					if (!pool.isFromPool(obj)) {
+						++errorCount;
+					}
+					obj->m_value = ~uint64(0);
+					pool.free(obj);
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (auto& slot : mailbox) {
+		if (PoolTestObject* obj = slot.load()) {
+			pool.free(obj);
+		}
+	}
+
+	REQUIRE(errorCount == 0);
+	REQUIRE(pool.getUsedCount() == 0);
+	REQUIRE(pool.validate());
+}
+
+TEST_CASE("ConcurrentMemoryPool max block count", "[Pool]")
+{
+	const uint kBlockSize     = 4;
+	const uint kMaxBlockCount = 2;
+	ConcurrentPool<PoolTestObject> pool(kBlockSize, kMaxBlockCount);
+
+	PoolTestObject* objects[kBlockSize * kMaxBlockCount];
+	for (auto& obj : objects) {
+		obj = pool.alloc();
+		REQUIRE(obj != nullptr);
+	}
+
+ // the pool is exhausted, alloc() fails without growing the block table
+	REQUIRE(pool.alloc() == nullptr);
+	REQUIRE(pool.alloc() == nullptr);
+	REQUIRE(pool.getCapacity() == kBlockSize * kMaxBlockCount);
+	REQUIRE(pool.getUsedCount() == kBlockSize * kMaxBlockCount);
+	REQUIRE(pool.validate());
+
+ // freed objects can be reused
+	pool.free(objects[0]);
+	objects[0] = pool.alloc();
+	REQUIRE(objects[0] != nullptr);
+	REQUIRE(pool.alloc() == nullptr);
+
+	for (auto obj : objects) {
+		pool.free(obj);
+	}
+	REQUIRE(pool.getUsedCount() == 0);
+	REQUIRE(pool.validate());
+}
+
+namespace {
+
+// Pool wrapped in a mutex, the baseline for the benchmark below.
+template <typename tType>
+struct LockedPool
+{
+	Pool<tType> m_pool;
+	std::mutex  m_mutex;
+
+	LockedPool(uint _blockSize): m_pool(_blockSize) {}
+	tType* alloc()            { std::lock_guard<std::mutex> lock(m_mutex); return m_pool.alloc(); }
+	void   free(tType* _obj)  { std::lock_guard<std::mutex> lock(m_mutex); m_pool.free(_obj); }
+};
+
+template <typename tPool>
+double PoolThroughput(int _threadCount, int _iterations)
+{
+	const int kLiveCount = 64;
+	tPool pool(256);
+	eastl::vector<std::thread> threads;
+	Timestamp t0 = Time::GetTimestamp();
+	for (int i = 0; i < _threadCount; ++i) {
+		threads.emplace_back([&pool, _iterations] {
+			PoolTestObject* live[kLiveCount] = {};
+			for (int j = 0; j < _iterations; ++j) {
+				PoolTestObject*& slot = live[j % kLiveCount];
+				if (slot) {
+					pool.free(slot);
+				}
+				slot = pool.alloc();
+			}
+			for (auto obj : live) {
+				if (obj) {
+					pool.free(obj);
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	double seconds = (Time::GetTimestamp() - t0).asSeconds();
+	return (double)_threadCount * _iterations / seconds / 1e6;
+}
+
+} // namespace
+
+TEST_CASE("Pool throughput", "[.benchmark][Pool]")
+{
+	const int kIterations = 1000000;
+	int threadCount = 1;
+	int maxThreadCount = (int)APT_MAX(std::thread::hardware_concurrency(), 1u);
+	for (;;) {
+		APT_LOG("Pool throughput, %d thread(s) (Mops/s):", threadCount);
+		APT_LOG("   Pool + mutex:            %.2f", PoolThroughput<LockedPool<PoolTestObject> >(threadCount, kIterations));
+		APT_LOG("   ThreadCachedMemoryPool:  %.2f", PoolThroughput<Pool<PoolTestObject, ThreadCachedMemoryPool> >(threadCount, kIterations));
+		APT_LOG("   ConcurrentMemoryPool:    %.2f", PoolThroughput<ConcurrentPool<PoolTestObject> >(threadCount, kIterations));
+		if (threadCount == maxThreadCount) {
+			break;
+		}
+		threadCount = APT_MIN(threadCount * 2, maxThreadCount);
+	}
+}
@@ -0,0 +1,620 @@
+#include <catch.hpp>
+
+#include <apt/log.h>
+#include <apt/Octree.h>
+#include <apt/Quadtree.h>
+#include <apt/rand.h>
+#include <apt/Time.h>
+
+#include <EASTL/vector.h>
+
+#include <atomic>
+
+using namespace apt;
+
+TEST_CASE("Quadtree", "[Quadtree]")
+{
+	typedef Quadtree<uint32, int> Tree;
+	Tree tree(4, -1);
+	REQUIRE(tree.getTotalNodeCount() == 1 + 4 + 16 + 64);
+	REQUIRE(Tree::FindLevel(0) == 0);
+	REQUIRE(Tree::FindLevel(4) == 1);
+	REQUIRE(Tree::FindLevel(5) == 2);
+	REQUIRE(tree.getFirstChildIndex(1, 1) == 5);
+	REQUIRE(tree.getParentIndex(8, 2) == 1);
+	REQUIRE(Tree::ToIndex(1, 0, 1) == 3);
+	REQUIRE(Tree::ToCartesian(3, 1) == uvec2(1, 0));
+
+	int visitCount = 0;
+	tree.traverse([&](uint32 _nodeIndex, int _nodeLevel) {
+			++visitCount;
+			return _nodeLevel < 2;
+		});
+	REQUIRE(visitCount == 1 + 4 + 16);
+}
+
+TEST_CASE("Quadtree traverseParallel", "[Quadtree]")
+{
+	typedef Quadtree<uint32, int> Tree;
+	const int kLevelCount = 6;
+	Tree tree(kLevelCount, 0);
+	eastl::vector<std::atomic<int> > visits(tree.getTotalNodeCount());
+	for (auto& v : visits) {
+		v.store(0);
+	}
+	for (int grainLevel = 0; grainLevel < kLevelCount; ++grainLevel) {
+		tree.traverseParallel([&](uint32 _nodeIndex, int _nodeLevel) {
+				visits[_nodeIndex].fetch_add(1, std::memory_order_relaxed);
+				tree[_nodeIndex] += _nodeLevel; // nodes are visited once, write is safe
+				return _nodeLevel < kLevelCount - 2;
+			},
+			grainLevel, 4);
+	}
+	bool ok = true;
+	for (uint32 i = 0; i < (uint32)visits.size(); ++i) {
+		int level = Tree::FindLevel(i);
+		int expected = level < kLevelCount - 1 ? kLevelCount : 0;
+		ok &= visits[i].load() == expected;
+		ok &= tree[i] == expected * level;
+	}
+	REQUIRE(ok);
+}
+
+TEST_CASE("Quadtree<bool>", "[Quadtree]")
+{
+	typedef Quadtree<uint32, bool> Tree;
+	Tree tree(6);
+	REQUIRE(tree.getBitsCount() == (Tree::GetTotalNodeCount(6) + 3 + 63) / 64);
+	for (int i = 0; i < 6; ++i) {
+		REQUIRE(tree.countSet(i) == 0);
+	}
+
+ // set a single leaf and its ancestors
+	const int kLeafLevel = 5;
+	uint32 leaf = Tree::ToIndex(13, 22, kLeafLevel);
+	for (uint32 i = leaf, level = kLeafLevel; i != Tree::Index_Invalid; i = tree.getParentIndex(i, level--)) {
+		tree.set(i, true);
+	}
+	REQUIRE(tree[leaf]);
+	REQUIRE(!tree[leaf + 1]);
+	for (int i = 0; i < 6; ++i) {
+		REQUIRE(tree.countSet(i) == 1);
+	}
+	uint32 parent = tree.getParentIndex(leaf, kLeafLevel);
+	REQUIRE(tree.getChildMask(parent, kLeafLevel - 1) == (1u << (leaf - tree.getFirstChildIndex(parent, kLeafLevel - 1))));
+	REQUIRE(tree.getChildMask(leaf, kLeafLevel) == 0);
+
+ // traverse() only visits set nodes
+	eastl::vector<uint32> visited;
+	tree.traverse([&](uint32 _nodeIndex, int _nodeLevel) {
+			REQUIRE(Tree::FindLevel(_nodeIndex) == _nodeLevel);
+			visited.push_back(_nodeIndex);
+			return true;
+		});
+	REQUIRE(visited.size() == 6);
+	REQUIRE(visited.back() == leaf);
+
+	visited.clear();
+	tree.forEachSet(kLeafLevel, [&](uint32 _nodeIndex) { visited.push_back(_nodeIndex); });
+	REQUIRE(visited.size() == 1);
+	REQUIRE(visited[0] == leaf);
+
+	REQUIRE(tree.findValidNeighbor(leaf, kLeafLevel, 0, 1) == parent);              // (13,23) is in the same parent
+	REQUIRE(tree.findValidNeighbor(leaf, kLeafLevel, 1, 0) == Tree::ToIndex(3, 5, 3)); // (14,22) shares the ancestor at level 3
+
+	tree.set(leaf, false);
+	REQUIRE(!tree[leaf]);
+	REQUIRE(tree.countSet(kLeafLevel) == 0);
+}
+
+TEST_CASE("Quadtree<bool> init", "[Quadtree]")
+{
+	typedef Quadtree<uint32, bool> Tree;
+	Tree tree(5, true);
+	bool ok = true;
+	for (int i = 0; i < 5; ++i) {
+		ok &= tree.countSet(i) == Tree::GetNodeCount(i);
+	}
+	REQUIRE(ok);
+
+ // clear every other leaf, check forEachSet() across word boundaries
+	tree.forEachSet(4, [&](uint32 _nodeIndex) {
+			if (_nodeIndex & 1) {
+				tree.set(_nodeIndex, false);
+			}
+		});
+	REQUIRE(tree.countSet(4) == Tree::GetNodeCount(4) / 2);
+	uint32 count = 0;
+	tree.forEachSet(4, [&](uint32 _nodeIndex) {
+			ok &= (_nodeIndex & 1) == 0;
+			++count;
+		});
+	REQUIRE(ok);
+	REQUIRE(count == Tree::GetNodeCount(4) / 2);
+
+	int visitCount = 0;
+	tree.traverse([&](uint32, int) { ++visitCount; return true; });
+	REQUIRE(visitCount == (int)(Tree::GetTotalNodeCount(4) + Tree::GetNodeCount(4) / 2));
+}
+
+TEST_CASE("Octree<bool>", "[Octree]")
+{
+	typedef Octree<uint32, bool> Tree;
+	Tree tree(4);
+	const int kLeafLevel = 3;
+	uint32 leaf = Tree::ToIndex(3, 5, 7, kLeafLevel);
+	for (uint32 i = leaf, level = kLeafLevel; i != Tree::Index_Invalid; i = tree.getParentIndex(i, level--)) {
+		tree.set(i, true);
+	}
+	uint32 parent = tree.getParentIndex(leaf, kLeafLevel);
+	REQUIRE(tree.getChildMask(parent, kLeafLevel - 1) == (1u << (leaf - tree.getFirstChildIndex(parent, kLeafLevel - 1))));
+
+	eastl::vector<uint32> visited;
+	tree.traverse([&](uint32 _nodeIndex, int) { visited.push_back(_nodeIndex); return true; });
+	REQUIRE(visited.size() == 4);
+	REQUIRE(visited.back() == leaf);
+	REQUIRE(tree.countSet(kLeafLevel) == 1);
+
+	Tree full(4, true);
+	bool ok = true;
+	for (int i = 0; i < 4; ++i) {
+		ok &= full.countSet(i) == Tree::GetNodeCount(i);
+	}
+	REQUIRE(ok);
+}
+
+TEST_CASE("Octree<bool> traverseParallel", "[Octree]")
+{
+	typedef Octree<uint32, bool> Tree;
+	const int kLevelCount = 5;
+	Tree tree(kLevelCount);
+	for (uint32 z = 0; z < 16; z += 3) {
+		uint32 leaf = Tree::ToIndex(z, 15 - z, z / 2, kLevelCount - 1);
+		for (uint32 i = leaf, level = kLevelCount - 1; i != Tree::Index_Invalid; i = tree.getParentIndex(i, level--)) {
+			tree.set(i, true);
+		}
+	}
+	uint32 serialCount = 0;
+	tree.traverse([&](uint32, int) { ++serialCount; return true; });
+	for (int grainLevel = 0; grainLevel < kLevelCount; ++grainLevel) {
+		std::atomic<uint32> count(0);
+		std::atomic<bool> ok(true);
+		tree.traverseParallel([&](uint32 _nodeIndex, int) {
+				if (!tree[_nodeIndex]) {
+					ok = false; // REQUIRE isn't thread safe
+				}
+				count.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			},
+			grainLevel);
+		REQUIRE(ok.load());
+		REQUIRE(count.load() == serialCount);
+	}
+}
+
+TEST_CASE("Quadtree linearize", "[Quadtree]")
+{
+	typedef Quadtree<uint32, uint32> Tree;
+	const int kLevelCount = 7;
+	Tree tree(kLevelCount);
+	for (uint32 i = 0; i < Tree::GetTotalNodeCount(kLevelCount); ++i) {
+		tree[i] = i;
+	}
+	for (int level = 0; level < kLevelCount; ++level) {
+		const uint32 width = Tree::GetWidth(level);
+		for (uint threadCount : { 1u, 4u }) {
+			eastl::vector<uint32> linear(tree.getNodeCount(level), ~0u);
+			tree.linearize(level, linear.data(), threadCount);
+			bool ok = true;
+			for (uint32 y = 0; y < width; ++y) {
+				for (uint32 x = 0; x < width; ++x) {
+					ok &= linear[y * width + x] == Tree::ToIndex(x, y, level);
+				}
+			}
+			REQUIRE(ok);
+
+		 // round trip
+			Tree copy(kLevelCount, 0);
+			copy.delinearize(level, linear.data(), threadCount);
+			REQUIRE(eastl::equal(tree.getLevel(level), tree.getLevel(level) + tree.getNodeCount(level), copy.getLevel(level)));
+		}
+	}
+
+	typedef Quadtree<uint32, bool> Bits;
+	Bits bits(kLevelCount);
+	const int kLeafLevel = kLevelCount - 1;
+	const uint32 width = Bits::GetWidth(kLeafLevel);
+	eastl::vector<bool> linear(bits.getNodeCount(kLeafLevel));
+	for (uint32 i = 0; i < (uint32)linear.size(); ++i) {
+		linear[i] = (i % 3) == 0;
+	}
+	bits.delinearize(kLeafLevel, linear.data());
+	bool ok = true;
+	for (uint32 y = 0; y < width; ++y) {
+		for (uint32 x = 0; x < width; ++x) {
+			ok &= bits[Bits::ToIndex(x, y, kLeafLevel)] == linear[y * width + x];
+		}
+	}
+	REQUIRE(ok);
+	eastl::vector<bool> roundTrip(linear.size());
+	bits.linearize(kLeafLevel, roundTrip.data(), 4);
+	REQUIRE(roundTrip == linear);
+}
+
+TEST_CASE("Octree linearize", "[Octree]")
+{
+	typedef Octree<uint32, uint32> Tree;
+	const int kLevelCount = 6;
+	Tree tree(kLevelCount);
+	for (uint32 i = 0; i < Tree::GetTotalNodeCount(kLevelCount); ++i) {
+		tree[i] = i;
+	}
+	for (int level = 0; level < kLevelCount; ++level) {
+		const uint32 width = Tree::GetWidth(level);
+		for (uint threadCount : { 1u, 4u }) {
+			eastl::vector<uint32> linear(tree.getNodeCount(level), ~0u);
+			tree.linearize(level, linear.data(), threadCount);
+			bool ok = true;
+			for (uint32 z = 0; z < width; ++z) {
+				for (uint32 y = 0; y < width; ++y) {
+					for (uint32 x = 0; x < width; ++x) {
+						ok &= linear[(z * width + y) * width + x] == Tree::ToIndex(x, y, z, level);
+					}
+				}
+			}
+			REQUIRE(ok);
+
+			Tree copy(kLevelCount, 0);
+			copy.delinearize(level, linear.data(), threadCount);
+			REQUIRE(eastl::equal(tree.getLevel(level), tree.getLevel(level) + tree.getNodeCount(level), copy.getLevel(level)));
+		}
+	}
+
+	typedef Octree<uint32, bool> Bits;
+	Bits bits(kLevelCount);
+	const int kLeafLevel = kLevelCount - 1;
+	eastl::vector<bool> linear(bits.getNodeCount(kLeafLevel));
+	for (uint32 i = 0; i < (uint32)linear.size(); ++i) {
+		linear[i] = (i % 5) < 2;
+	}
+	bits.delinearize(kLeafLevel, linear.data());
+	uvec3 c(3, 17, 30);
+	REQUIRE(bits[Bits::ToIndex(c.x, c.y, c.z, kLeafLevel)] == linear[(c.z * 32 + c.y) * 32 + c.x]);
+	eastl::vector<bool> roundTrip(linear.size());
+	bits.linearize(kLeafLevel, roundTrip.data());
+	REQUIRE(roundTrip == linear);
+}
+
+TEST_CASE("Octree linearize 256^3", "[.benchmark]")
+{
+	typedef Octree<uint32, uint32> Tree;
+	const int kLevelCount = 9;
+	const int kLeafLevel = kLevelCount - 1;
+	Tree tree(kLevelCount, 1);
+	const uint32 width = Tree::GetWidth(kLeafLevel);
+	eastl::vector<uint32> linear(tree.getNodeCount(kLeafLevel));
+
+	Timestamp t = Time::GetTimestamp();
+	const uint32* level = tree.getLevel(kLeafLevel);
+	for (uint32 i = 0; i < (uint32)linear.size(); ++i) {
+		uvec3 c = Tree::ToCartesian(Tree::GetLevelStartIndex(kLeafLevel) + i, kLeafLevel);
+		linear[(c.z * width + c.y) * width + c.x] = level[i];
+	}
+	double msToCartesian = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	tree.linearize(kLeafLevel, linear.data());
+	double msLinearize = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	tree.linearize(kLeafLevel, linear.data(), 0);
+	double msLinearizeMt = (Time::GetTimestamp() - t).asMilliseconds();
+
+	APT_LOG("Octree linearize %u^3: ToCartesian %.2fms, linearize %.2fms, linearize (all threads) %.2fms", width, msToCartesian, msLinearize, msLinearizeMt);
+}
+
+// Check that each parent node of _tree is the reduction of its children via _op, as per reduce().
+template <typename tTree, typename tOp>
+static bool IsReduced(const tTree& _tree, tOp&& _op)
+{
+	typedef typename tTree::Index Index;
+	const Index kChildCount = tTree::GetNodeCount(1);
+	bool ret = true;
+	for (int level = 0; level < _tree.getLevelCount() - 1; ++level) {
+		for (Index i = tTree::GetLevelStartIndex(level); i < tTree::GetLevelStartIndex(level + 1); ++i) {
+			Index firstChild = _tree.getFirstChildIndex(i, level);
+			auto value = _tree[firstChild];
+			for (Index j = 1; j < kChildCount; ++j) {
+				value = _op(value, _tree[firstChild + j]);
+			}
+			ret &= _tree[i] == value;
+		}
+	}
+	return ret;
+}
+
+template <typename tTree>
+static void TestReduce(int _levelCount)
+{
+	typedef typename tTree::Index Index;
+	auto minOp = [](int _a, int _b) { return APT_MIN(_a, _b); };
+	auto sumOp = [](int _a, int _b) { return _a + _b; };
+	tTree tree(_levelCount, 0);
+	Rand<> rnd;
+	const int leafLevel = _levelCount - 1;
+	int* leaves = tree.getLevel(leafLevel);
+	for (Index i = 0; i < tree.getNodeCount(leafLevel); ++i) {
+		leaves[i] = (int)(rnd.raw() & 0xffff);
+	}
+	tree.reduce(sumOp);
+	REQUIRE(IsReduced(tree, sumOp));
+	tree.reduce(minOp, 4);
+	REQUIRE(IsReduced(tree, minOp));
+
+ // incremental update
+	eastl::vector<Index> dirty;
+	for (int i = 0; i < 20; ++i) {
+		Index leaf = tree.GetLevelStartIndex(leafLevel) + (Index)(rnd.raw() % tree.getNodeCount(leafLevel));
+		tree[leaf] = -(int)(rnd.raw() & 0xff);
+		dirty.push_back(leaf);
+	}
+	dirty.push_back(dirty.front()); // duplicates are allowed
+	tree.reduceDirty(minOp, dirty.data(), (uint)dirty.size());
+	REQUIRE(IsReduced(tree, minOp));
+}
+
+template <typename tTree>
+static void TestReduceBool(int _levelCount)
+{
+	typedef typename tTree::Index Index;
+	auto anyOp = [](uint64 _a, uint64 _b) { return _a | _b; };
+	auto allOp = [](uint64 _a, uint64 _b) { return _a & _b; };
+	auto anyRef = [](bool _a, bool _b) { return _a || _b; };
+	auto allRef = [](bool _a, bool _b) { return _a && _b; };
+	tTree tree(_levelCount);
+	Rand<> rnd;
+	const int leafLevel = _levelCount - 1;
+	for (Index i = tree.GetLevelStartIndex(leafLevel); i < tree.GetLevelStartIndex(leafLevel) + tree.getNodeCount(leafLevel); ++i) {
+		tree.set(i, (rnd.raw() & 7) != 0);
+	}
+	for (uint threadCount : { 1u, 4u }) {
+		tree.reduce(anyOp, threadCount);
+		REQUIRE(IsReduced(tree, anyRef));
+		tree.reduce(allOp, threadCount);
+		REQUIRE(IsReduced(tree, allRef));
+	}
+
+	eastl::vector<Index> dirty;
+	for (int i = 0; i < 50; ++i) {
+		Index leaf = tree.GetLevelStartIndex(leafLevel) + (Index)(rnd.raw() % tree.getNodeCount(leafLevel));
+		tree.set(leaf, true);
+		dirty.push_back(leaf);
+	}
+	tree.reduceDirty(allOp, dirty.data(), (uint)dirty.size());
+	REQUIRE(IsReduced(tree, allRef));
+}
+
+TEST_CASE("Quadtree reduce", "[Quadtree]")
+{
+	TestReduce<Quadtree<uint32, int> >(8);
+	TestReduceBool<Quadtree<uint32, bool> >(2);
+	TestReduceBool<Quadtree<uint32, bool> >(8);
+}
+
+TEST_CASE("Octree reduce", "[Octree]")
+{
+	TestReduce<Octree<uint32, int> >(6);
+	TestReduceBool<Octree<uint32, bool> >(2);
+	TestReduceBool<Octree<uint32, bool> >(6);
+}
+
+TEST_CASE("Quadtree reduce 4096^2", "[.benchmark]")
+{
+	typedef Quadtree<uint32, float> Tree;
+	const int kLevelCount = 13;
+	Tree tree(kLevelCount, 1.0f);
+	auto maxOp = [](float _a, float _b) { return APT_MAX(_a, _b); };
+
+ // per-parent loop via traverse()-style index arithmetic
+	Timestamp t = Time::GetTimestamp();
+	for (int level = kLevelCount - 2; level >= 0; --level) {
+		for (uint32 i = Tree::GetLevelStartIndex(level); i < Tree::GetLevelStartIndex(level + 1); ++i) {
+			uint32 firstChild = tree.getFirstChildIndex(i, level);
+			float value = tree[firstChild];
+			for (uint32 j = 1; j < 4; ++j) {
+				value = maxOp(value, tree[firstChild + j]);
+			}
+			tree[i] = value;
+		}
+	}
+	double msNaive = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	tree.reduce(maxOp);
+	double msReduce = (Time::GetTimestamp() - t).asMilliseconds();
+
+	t = Time::GetTimestamp();
+	tree.reduce(maxOp, 0);
+	double msReduceMt = (Time::GetTimestamp() - t).asMilliseconds();
+
+	APT_LOG("Quadtree reduce %u^2: naive %.2fms, reduce %.2fms, reduce (all threads) %.2fms", Tree::GetWidth(kLevelCount - 1), msNaive, msReduce, msReduceMt);
+}
+
+// Reference intersection tests for the spatial queries, the arithmetic matches SpatialQuery.h.
+template <typename tVec>
+static bool AabbOverlap(const tVec& _nmin, const tVec& _nmax, const tVec& _qmin, const tVec& _qmax)
+{
+	bool ret = true;
+	for (int i = 0; i < (int)(sizeof(tVec) / sizeof(float)); ++i) {
+		ret &= _nmin[i] <= _qmax[i] && _qmin[i] <= _nmax[i];
+	}
+	return ret;
+}
+template <typename tVec>
+static bool SphereOverlap(const tVec& _nmin, const tVec& _nmax, const tVec& _center, float _radius)
+{
+	float d2 = 0.0f;
+	for (int i = 0; i < (int)(sizeof(tVec) / sizeof(float)); ++i) {
+		float d = APT_MAX(APT_MAX(_nmin[i] - _center[i], _center[i] - _nmax[i]), 0.0f);
+		d2 += d * d;
+	}
+	return d2 <= _radius * _radius;
+}
+template <typename tVec, typename tPlane>
+static bool PlanesOverlap(const tVec& _nmin, const tVec& _nmax, const tPlane* _planes, int _planeCount)
+{
+	const int kDim = (int)(sizeof(tVec) / sizeof(float));
+	bool ret = true;
+	for (int j = 0; j < _planeCount; ++j) {
+		float dist = _planes[j][kDim];
+		float radius = 0.0f;
+		for (int i = 0; i < kDim; ++i) {
+			dist += (_nmin[i] + _nmax[i]) * 0.5f * _planes[j][i];
+			radius += (_planes[j][i] < 0.0f ? -_planes[j][i] : _planes[j][i]) * (_nmax[i] - _nmin[i]) * 0.5f;
+		}
+		ret &= -radius <= dist;
+	}
+	return ret;
+}
+
+// Compare the query functions against testing every node at each level. _isPresent(_nodeIndex) filters the reference results.
+template <typename tTree, typename tVec, typename tPlane, typename tIsPresent>
+static void TestQueries(const tTree& _tree, tIsPresent&& _isPresent)
+{
+	typedef typename tTree::Index Index;
+	const int kDim = (int)(sizeof(tVec) / sizeof(float));
+	const tVec rootMin(-16.0f), rootMax(48.0f); // power of 2 node sizes, node bounds are exact
+	Rand<> rnd;
+	eastl::vector<Index> result(tTree::GetNodeCount(_tree.getLevelCount() - 1));
+	eastl::vector<Index> expected;
+	bool ok = true;
+	for (int iter = 0; iter < 200; ++iter) {
+		int level = iter % _tree.getLevelCount();
+		tVec a, b, center;
+		tPlane planes[6];
+		for (int i = 0; i < kDim; ++i) {
+			a[i] = rnd.get<float>(-24.0f, 56.0f);
+			b[i] = rnd.get<float>(-24.0f, 56.0f);
+			center[i] = rnd.get<float>(-24.0f, 56.0f);
+		}
+		tVec qmin = linalg::min(a, b), qmax = linalg::max(a, b);
+		float radius = rnd.get<float>(0.0f, 32.0f);
+		for (auto& plane : planes) {
+			tVec n, p;
+			for (int i = 0; i < kDim; ++i) {
+				n[i] = rnd.get<float>(-1.0f, 1.0f);
+				p[i] = rnd.get<float>(-16.0f, 48.0f);
+			}
+			plane = tPlane(n, -dot(n, p));
+		}
+		int planeCount = iter % 7;
+
+		Index levelStart = tTree::GetLevelStartIndex(level);
+		tVec nodeSize = (rootMax - rootMin) / (float)tTree::GetWidth(level);
+		for (int query = 0; query < 3; ++query) {
+			expected.clear();
+			for (Index i = levelStart; i < levelStart + tTree::GetNodeCount(level); ++i) {
+				if (!_isPresent(i)) {
+					continue;
+				}
+				tVec nmin = rootMin + tVec(tTree::ToCartesian(i, level)) * nodeSize;
+				tVec nmax = nmin + nodeSize;
+				if ((query == 0 && AabbOverlap(nmin, nmax, qmin, qmax)) ||
+				    (query == 1 && SphereOverlap(nmin, nmax, center, radius)) ||
+				    (query == 2 && PlanesOverlap(nmin, nmax, planes, planeCount))) {
+					expected.push_back(i);
+				}
+			}
+			Index count = 0;
+			switch (query) {
+				case 0:  count = _tree.queryAabb(rootMin, rootMax, qmin, qmax, level, result.data(), (Index)result.size()); break;
+				case 1:  count = _tree.querySphere(rootMin, rootMax, center, radius, level, result.data(), (Index)result.size()); break;
+				default: count = _tree.queryFrustum(rootMin, rootMax, planes, planeCount, level, result.data(), (Index)result.size()); break;
+			};
+			ok &= count == (Index)expected.size();
+			ok &= eastl::equal(expected.begin(), expected.end(), result.begin());
+		}
+	}
+	REQUIRE(ok);
+
+ // truncated results
+	const int leafLevel = _tree.getLevelCount() - 1;
+	Index total = _tree.queryAabb(rootMin, rootMax, rootMin, rootMax, leafLevel, result.data(), (Index)result.size());
+	eastl::vector<Index> truncated(total / 2 + 1, 0);
+	REQUIRE(_tree.queryAabb(rootMin, rootMax, rootMin, rootMax, leafLevel, truncated.data(), (Index)truncated.size() - 1) == total);
+	REQUIRE(eastl::equal(truncated.begin(), truncated.end() - 1, result.begin()));
+	REQUIRE(truncated.back() == 0);
+}
+
+TEST_CASE("Quadtree spatial queries", "[Quadtree]")
+{
+	Quadtree<uint32, int> tree(7);
+	TestQueries<Quadtree<uint32, int>, vec2, vec3>(tree, [](uint32) { return true; });
+
+	Quadtree<uint32, bool> bits(7);
+	Rand<> rnd;
+	for (int i = 0; i < 300; ++i) {
+		uint32 leaf = Quadtree<uint32, bool>::ToIndex(rnd.raw() & 63, rnd.raw() & 63, 6);
+		for (uint32 j = leaf, level = 6; j != Quadtree<uint32, bool>::Index_Invalid; j = bits.getParentIndex(j, level--)) {
+			bits.set(j, true);
+		}
+	}
+	TestQueries<Quadtree<uint32, bool>, vec2, vec3>(bits, [&](uint32 _nodeIndex) { return bits[_nodeIndex]; });
+}
+
+TEST_CASE("Octree spatial queries", "[Octree]")
+{
+	Octree<uint32, int> tree(5);
+	TestQueries<Octree<uint32, int>, vec3, vec4>(tree, [](uint32) { return true; });
+
+	Octree<uint32, bool> bits(5);
+	Rand<> rnd;
+	for (int i = 0; i < 300; ++i) {
+		uint32 leaf = Octree<uint32, bool>::ToIndex(rnd.raw() & 15, rnd.raw() & 15, rnd.raw() & 15, 4);
+		for (uint32 j = leaf, level = 4; j != Octree<uint32, bool>::Index_Invalid; j = bits.getParentIndex(j, level--)) {
+			bits.set(j, true);
+		}
+	}
+	TestQueries<Octree<uint32, bool>, vec3, vec4>(bits, [&](uint32 _nodeIndex) { return bits[_nodeIndex]; });
+}
+
+TEST_CASE("Octree querySphere", "[.benchmark]")
+{
+	typedef Octree<uint32, int> Tree;
+	const int kLevelCount = 8;
+	Tree tree(kLevelCount);
+	const vec3 rootMin(0.0f), rootMax(1024.0f);
+	eastl::vector<uint32> result(Tree::GetNodeCount(kLevelCount - 1));
+	Rand<> rnd;
+	const int kQueryCount = 1000;
+	eastl::vector<vec4> spheres(kQueryCount);
+	for (auto& sphere : spheres) {
+		sphere = vec4(rnd.get<float>(0.0f, 1024.0f), rnd.get<float>(0.0f, 1024.0f), rnd.get<float>(0.0f, 1024.0f), rnd.get<float>(8.0f, 64.0f));
+	}
+
+ // traverse() + per-node bounds from ToCartesian()/getNodeWidth()
+	uint64 countTraverse = 0;
+	Timestamp t = Time::GetTimestamp();
+	for (const vec4& sphere : spheres) {
+		tree.traverse([&](uint32 _nodeIndex, int _nodeLevel) {
+				vec3 size = (rootMax - rootMin) * ((float)tree.getNodeWidth(_nodeLevel) / (float)tree.getNodeWidth(0));
+				vec3 nmin = rootMin + vec3(Tree::ToCartesian(_nodeIndex, _nodeLevel)) * size;
+				if (!SphereOverlap(nmin, nmin + size, sphere.xyz(), sphere.w)) {
+					return false;
+				}
+				countTraverse += _nodeLevel == kLevelCount - 1;
+				return true;
+			});
+	}
+	double msTraverse = (Time::GetTimestamp() - t).asMilliseconds();
+
+	uint64 countQuery = 0;
+	t = Time::GetTimestamp();
+	for (const vec4& sphere : spheres) {
+		countQuery += tree.querySphere(rootMin, rootMax, sphere.xyz(), sphere.w, kLevelCount - 1, result.data(), (uint32)result.size());
+	}
+	double msQuery = (Time::GetTimestamp() - t).asMilliseconds();
+
+	REQUIRE(countQuery == countTraverse);
+	APT_LOG("Octree sphere query x%d (%llu leaves): traverse %.2fms, querySphere %.2fms", kQueryCount, countQuery, msTraverse, msQuery);
+}
@@ -0,0 +1,178 @@
+#include <catch.hpp>
+
+#include <apt/log.h>
+#include <apt/RingBuffer.h>
+#include <apt/SpscRingBuffer.h>
+#include <apt/Time.h>
+
+#include <EASTL/string.h>
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+using namespace apt;
+
+TEST_CASE("RingBuffer", "[RingBuffer]")
+{
+	RingBuffer<int> rb(5);
+	REQUIRE(rb.capacity() == 5);
+	REQUIRE(rb.empty());
+	for (int i = 0; i < 8; ++i) {
+		rb.push_back(i);
+	}
+	REQUIRE(rb.size() == 5);
+	REQUIRE(rb.front() == 3);
+	REQUIRE(rb.back() == 7);
+	for (uint i = 0; i < rb.size(); ++i) {
+		REQUIRE(rb[i] == (int)i + 3);
+	}
+
+ // const access is const
+	const RingBuffer<int>& crb = rb;
+	APT_STATIC_ASSERT((std::is_same<decltype(crb[0]), const int&>::value));
+	APT_STATIC_ASSERT((std::is_same<decltype(crb.front()), const int&>::value));
+	REQUIRE(crb[0] == 3);
+
+ // spans cover all items in order
+	RingBuffer<int>::Span spans[2];
+	rb.getSpans(spans[0], spans[1]);
+	REQUIRE(spans[0].m_size + spans[1].m_size == 5);
+	int expected = 3;
+	for (auto& span : spans) {
+		for (uint i = 0; i < span.m_size; ++i) {
+			REQUIRE(span.m_data[i] == expected++);
+		}
+	}
+
+ // reserve preserves order
+	rb.reserve(20);
+	REQUIRE(rb.size() == 5);
+	for (uint i = 0; i < rb.size(); ++i) {
+		REQUIRE(rb[i] == (int)i + 3);
+	}
+	rb.getSpans(spans[0], spans[1]);
+	REQUIRE(spans[0].m_size == 5);
+	REQUIRE(spans[1].m_size == 0);
+
+ // shrinking removes the oldest items
+	rb.reserve(2);
+	REQUIRE(rb.size() == 2);
+	REQUIRE(rb.front() == 6);
+	REQUIRE(rb.back() == 7);
+
+	rb.pop_front();
+	REQUIRE(rb.front() == 7);
+	rb.clear();
+	REQUIRE(rb.empty());
+}
+
+TEST_CASE("RingBuffer non-trivial type", "[RingBuffer]")
+{
+	RingBuffer<eastl::string> rb(3);
+	const char* kLong = "a long string which doesn't fit in the small string buffer";
+	for (int i = 0; i < 10; ++i) {
+		eastl::string s(kLong);
+		s.append(1, (char)('0' + i));
+		if (i & 1) {
+			rb.push_back(std::move(s));
+		} else {
+			rb.emplace_back(s.c_str());
+		}
+	}
+	REQUIRE(rb.size() == 3);
+	REQUIRE(rb.front().back() == '7');
+	REQUIRE(rb.back().back() == '9');
+	rb.reserve(8);
+	REQUIRE(rb[1].back() == '8');
+	const RingBuffer<eastl::string>& crb = rb;
+	RingBuffer<eastl::string>::ConstSpan spans[2];
+	crb.getSpans(spans[0], spans[1]);
+	REQUIRE(spans[0].m_size == 3);
+}
+
+TEST_CASE("SpscRingBuffer", "[RingBuffer]")
+{
+	SpscRingBuffer<int> buf(100);
+	REQUIRE(buf.capacity() == 128);
+	REQUIRE(buf.empty());
+
+	int v;
+	REQUIRE(!buf.tryPop(v));
+	for (int i = 0; i < 128; ++i) {
+		REQUIRE(buf.tryPush(i));
+	}
+	REQUIRE(!buf.tryPush(128));
+	REQUIRE(buf.tryPop(v));
+	REQUIRE(v == 0);
+
+ // bulk ops across the wrap point
+	int data[64];
+	REQUIRE(buf.tryPop(data, 64) == 64);
+	REQUIRE(data[0] == 1);
+	REQUIRE(data[63] == 64);
+	for (int i = 0; i < 64; ++i) {
+		data[i] = 128 + i;
+	}
+	REQUIRE(buf.tryPush(data, 64) == 64);
+	REQUIRE(buf.tryPush(data, 64) == 1); // partial
+	REQUIRE(buf.size() == 128);
+	int out[128];
+	REQUIRE(buf.tryPop(out, 200) == 128);
+	bool ok = true;
+	for (int i = 0; i < 127; ++i) {
+		ok &= out[i] == 65 + i;
+	}
+	REQUIRE(ok);
+	REQUIRE(out[127] == 128);
+	REQUIRE(buf.empty());
+
+ // non-trivial type
+	SpscRingBuffer<eastl::string> strings(4);
+	eastl::string s[3] = { "a", "b", "a long string which doesn't fit in the small string buffer" };
+	REQUIRE(strings.tryPush(s, 3) == 3);
+	REQUIRE(strings.tryPush(eastl::string("d")));
+	REQUIRE(!strings.tryPush(eastl::string("e")));
+	eastl::string t[4];
+	REQUIRE(strings.tryPop(t, 4) == 4);
+	REQUIRE(t[2] == s[2]);
+	REQUIRE(t[3] == "d");
+	strings.tryPush(s[0]); // destructed by ~SpscRingBuffer
+}
+
+TEST_CASE("SpscRingBuffer producer/consumer", "[RingBuffer]")
+{
+	const uint64 kCount = 1000000;
+	SpscRingBuffer<uint64>* buf = new SpscRingBuffer<uint64>(1024);
+	REQUIRE((uint)buf % APT_DCACHE_LINE_SIZE == 0);
+
+	std::thread producer([buf, kCount]() {
+		uint64 data[37];
+		uint64 next = 0;
+		while (next < kCount) {
+			uint n = (uint)APT_MIN((uint64)37, kCount - next);
+			for (uint i = 0; i < n; ++i) {
+				data[i] = next + i;
+			}
+			uint pushed = 0;
+			while (pushed < n) {
+				pushed += buf->tryPush(data + pushed, n - pushed);
+			}
+			next += n;
+		}
+	});
+
+	uint64 expected = 0;
+	bool ok = true;
+	uint64 data[29];
+	while (expected < kCount) {
+		uint n = buf->tryPop(data, 29);
+		for (uint i = 0; i < n; ++i) {
+			ok &= data[i] == expected++;
+		}
+	}
+	producer.join();
+	REQUIRE(ok);
+	REQUIRE(buf->empty());
+	delete buf;
+}
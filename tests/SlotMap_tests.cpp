@@ -0,0 +1,89 @@
+#include <catch.hpp>
+
+#include <apt/SlotMap.h>
+
+#include <EASTL/string.h>
+
+#include <vector>
+
+using namespace apt;
+
+TEST_CASE("SlotMap", "[SlotMap]")
+{
+	SlotMap<int> map;
+	REQUIRE(map.empty());
+	REQUIRE(!map.isValid(SlotMap<int>::kInvalidHandle));
+	REQUIRE(map.find(SlotMap<int>::kInvalidHandle) == nullptr);
+
+	std::vector<SlotMap<int>::Handle> handles;
+	for (int i = 0; i < 100; ++i) {
+		handles.push_back(map.insert(i));
+	}
+	REQUIRE(map.size() == 100);
+	for (int i = 0; i < 100; ++i) {
+		REQUIRE(map[handles[i]] == i);
+	}
+
+ // erase every other value, remaining handles are still valid
+	for (int i = 0; i < 100; i += 2) {
+		REQUIRE(map.erase(handles[i]));
+	}
+	REQUIRE(map.size() == 50);
+	REQUIRE(!map.erase(handles[0])); // already erased
+	bool ok = true;
+	for (int i = 0; i < 100; ++i) {
+		int* v = map.find(handles[i]);
+		ok &= (i & 1) ? (v && *v == i) : (v == nullptr);
+	}
+	REQUIRE(ok);
+
+ // dense iteration only visits live values, getHandle() maps back
+	int sum = 0;
+	for (int v : map) {
+		sum += v;
+	}
+	REQUIRE(sum == 2500);
+	for (uint i = 0; i < map.size(); ++i) {
+		REQUIRE(map[map.getHandle(i)] == map.data()[i]);
+	}
+
+ // slots are reused with a new generation, stale handles remain invalid
+	SlotMap<int>::Handle h = map.insert(1000);
+	REQUIRE(h != handles[98]);
+	REQUIRE(map.find(handles[98]) == nullptr);
+	REQUIRE(map[h] == 1000);
+
+	map.clear();
+	REQUIRE(map.empty());
+	REQUIRE(!map.isValid(h));
+	REQUIRE(!map.isValid(handles[1]));
+	h = map.insert(5);
+	REQUIRE(map[h] == 5);
+}
+
+TEST_CASE("SlotMap 64 bit handles", "[SlotMap]")
+{
+	SlotMap<eastl::string, uint64> map;
+	uint64 a = map.emplace("a long string which doesn't fit in the small string buffer");
+	uint64 b = map.insert(eastl::string("b"));
+	REQUIRE((a >> 32) == 1); // generation
+	map.erase(a);
+	REQUIRE(map[b] == "b");
+	uint64 c = map.insert(eastl::string("c"));
+	REQUIRE((c & 0xffffffff) == (a & 0xffffffff)); // slot reused
+	REQUIRE((c >> 32) == 2);
+	REQUIRE(!map.isValid(a));
+}
+
+TEST_CASE("SlotMap generation wrap", "[SlotMap]")
+{
+	SlotMap<int> map;
+	SlotMap<int>::Handle first = map.insert(0);
+	SlotMap<int>::Handle h = first;
+	for (int i = 0; i < 255; ++i) {
+		map.erase(h);
+		h = map.insert(i);
+		REQUIRE(h != SlotMap<int>::kInvalidHandle);
+	}
+	REQUIRE(h == first); // 8 bit generation wrapped (skipping 0)
+}
@@ -0,0 +1,132 @@
+#include <catch.hpp>
+
+#include <apt/Octree.h>
+#include <apt/rand.h>
+#include <apt/SparseOctree.h>
+
+#include <EASTL/vector.h>
+
+using namespace apt;
+
+TEST_CASE("SparseOctree", "[SparseOctree]")
+{
+	typedef SparseOctree<uint64, int> Tree;
+	const int kLevelCount = 21; // dense storage would need ~2^63 nodes
+	Tree tree(kLevelCount, -1);
+	REQUIRE(tree.getMaterializedCount() == 0);
+	REQUIRE(tree.find(0) == nullptr);
+
+ // materializing a leaf materializes its ancestors
+	const int kLeafLevel = kLevelCount - 1;
+	uint64 leafA = Tree::ToIndex(1000, 2000, 3000, kLeafLevel);
+	tree[leafA] = 1;
+	REQUIRE(tree.getMaterializedCount() == kLevelCount);
+	REQUIRE(*tree.find(leafA) == 1);
+	REQUIRE(*tree.find(0) == -1);
+
+	uint64 leafB = Tree::ToIndex(1001, 2000, 3000, kLeafLevel); // sibling of leafA
+	tree[leafB] = 2;
+	REQUIRE(tree.getMaterializedCount() == kLevelCount + 1);
+	uint64 parent = tree.getParentIndex(leafA, kLeafLevel);
+	REQUIRE(parent == tree.getParentIndex(leafB, kLeafLevel));
+	REQUIRE(CountBits(tree.getChildMask(parent)) == 2);
+
+	uint64 leafC = Tree::ToIndex(1u << 19, 0, 1u << 19, kLeafLevel); // different octant at level 1
+	tree[leafC] = 3;
+	REQUIRE(tree.getMaterializedCount() == 2 * kLevelCount);
+
+ // traverse() visits only materialized nodes, with the correct level
+	eastl::vector<uint64> leaves;
+	uint64 visitCount = 0;
+	bool ok = true;
+	tree.traverse([&](uint64 _nodeIndex, int _nodeLevel) {
+			ok &= Tree::FindLevel(_nodeIndex) == _nodeLevel;
+			ok &= tree.find(_nodeIndex) != nullptr;
+			if (_nodeLevel == kLeafLevel) {
+				leaves.push_back(_nodeIndex);
+			}
+			++visitCount;
+			return true;
+		});
+	REQUIRE(ok);
+	REQUIRE(visitCount == tree.getMaterializedCount());
+	REQUIRE(leaves.size() == 3);
+
+ // neighbor search finds the sibling, or a materialized ancestor
+	REQUIRE(tree.findValidNeighbor(leafA, kLeafLevel, 1, 0, 0) == leafB);
+	REQUIRE(tree.findValidNeighbor(leafA, kLeafLevel, 0, 0, 1) == parent);
+	REQUIRE(tree.findValidNeighbor(leafA, kLeafLevel, -2000, 0, 0) == Tree::Index_Invalid);
+
+ // erase a subtree
+	uint64 level1 = Tree::ToIndex(1, 0, 1, 1);
+	REQUIRE(tree.erase(level1) == kLevelCount - 1);
+	REQUIRE(tree.find(leafC) == nullptr);
+	REQUIRE(tree.getMaterializedCount() == kLevelCount + 1);
+	REQUIRE(CountBits(tree.getChildMask(0)) == 1);
+	REQUIRE(tree.erase(leafB) == 1);
+	REQUIRE(CountBits(tree.getChildMask(parent)) == 1);
+
+	tree.clear();
+	REQUIRE(tree.getMaterializedCount() == 0);
+}
+
+TEST_CASE("SparseOctree default allocator", "[SparseOctree]")
+{
+ // the hash map's bucket array is reallocated via the aligned EASTL allocator path on each rehash, it must be released via delete[]
+	typedef SparseOctree<uint32, int> Tree;
+	const int kLevelCount = 8;
+	const int kLeafLevel  = kLevelCount - 1;
+	Tree tree(kLevelCount);
+	for (int pass = 0; pass < 2; ++pass) {
+		for (uint32 i = 0; i < 1000; ++i) {
+			tree[Tree::ToIndex(i % 128, (i / 128) * 7, i % 17, kLeafLevel)] = (int)i;
+		}
+		REQUIRE(tree.getMaterializedCount() > 1000);
+		REQUIRE(*tree.find(Tree::ToIndex(999 % 128, (999 / 128) * 7, 999 % 17, kLeafLevel)) == 999);
+		tree.clear();
+		REQUIRE(tree.getMaterializedCount() == 0);
+	}
+}
+
+TEST_CASE("SparseOctree spatial queries", "[SparseOctree]")
+{
+ // compare against a bitmap octree with the same nodes set
+	const int kLevelCount = 6;
+	SparseOctree<uint32, int> tree(kLevelCount);
+	Octree<uint32, bool> bits(kLevelCount);
+	Rand<> rnd;
+	for (int i = 0; i < 500; ++i) {
+		uint32 leaf = bits.ToIndex(rnd.raw() & 31, rnd.raw() & 31, rnd.raw() & 31, kLevelCount - 1);
+		tree[leaf] = i;
+		for (uint32 j = leaf, level = kLevelCount - 1; j != bits.Index_Invalid; j = bits.getParentIndex(j, level--)) {
+			bits.set(j, true);
+		}
+	}
+
+	const vec3 rootMin(-1.0f), rootMax(1.0f);
+	eastl::vector<uint32> expected(bits.getNodeCount(kLevelCount - 1));
+	eastl::vector<uint32> result(expected.size());
+	bool ok = true;
+	for (int i = 0; i < 100; ++i) {
+		int level = i % kLevelCount;
+		vec3 center(rnd.get<float>(-1.0f, 1.0f), rnd.get<float>(-1.0f, 1.0f), rnd.get<float>(-1.0f, 1.0f));
+		float radius = rnd.get<float>(0.0f, 0.5f);
+		uint32 count = bits.querySphere(rootMin, rootMax, center, radius, level, expected.data(), (uint32)expected.size());
+		ok &= tree.querySphere(rootMin, rootMax, center, radius, level, result.data(), (uint32)result.size()) == count;
+		ok &= eastl::equal(expected.begin(), expected.begin() + count, result.begin());
+
+		vec3 extent(radius);
+		count = bits.queryAabb(rootMin, rootMax, center - extent, center + extent, level, expected.data(), (uint32)expected.size());
+		ok &= tree.queryAabb(rootMin, rootMax, center - extent, center + extent, level, result.data(), (uint32)result.size()) == count;
+		ok &= eastl::equal(expected.begin(), expected.begin() + count, result.begin());
+
+		vec4 planes[2] = { vec4(1.0f, 0.0f, 0.0f, radius), vec4(0.0f, -1.0f, 0.0f, radius) };
+		count = bits.queryFrustum(rootMin, rootMax, planes, 2, level, expected.data(), (uint32)expected.size());
+		ok &= tree.queryFrustum(rootMin, rootMax, planes, 2, level, result.data(), (uint32)result.size()) == count;
+		ok &= eastl::equal(expected.begin(), expected.begin() + count, result.begin());
+	}
+	REQUIRE(ok);
+
+	tree.clear();
+	REQUIRE(tree.queryAabb(rootMin, rootMax, rootMin, rootMax, 0, result.data(), (uint32)result.size()) == 0);
+}
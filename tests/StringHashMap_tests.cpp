@@ -0,0 +1,157 @@
+#include <catch.hpp>
+
+#include <apt/log.h>
+#include <apt/StringHashMap.h>
+#include <apt/Time.h>
+
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <EASTL/vector_map.h>
+
+#include <cstdio>
+
+using namespace apt;
+
+static eastl::vector<StringHash> MakeKeys(int _count)
+{
+	eastl::vector<StringHash> ret;
+	for (int i = 0; i < _count; ++i) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "key%d", i);
+		ret.push_back(StringHash(buf));
+	}
+	return ret;
+}
+
+TEST_CASE("StringHashMap", "[StringHashMap]")
+{
+	StringHashMap<int> map;
+	REQUIRE(map.empty());
+	REQUIRE(map.find("missing") == map.end());
+	REQUIRE(map.begin() == map.end());
+	REQUIRE(map.erase("missing") == 0);
+
+	map["a"] = 1;
+	REQUIRE(map.insert(eastl::make_pair(StringHash("b"), 2)).second);
+	REQUIRE(!map.insert(eastl::make_pair(StringHash("b"), 3)).second); // already present, not overwritten
+	REQUIRE(map.size() == 2);
+	REQUIRE(map.find("a")->second == 1);
+	REQUIRE(map["b"] == 2);
+	REQUIRE(map.contains("a"));
+	REQUIRE(!map.contains("c"));
+
+	REQUIRE(map.erase("a") == 1);
+	REQUIRE(map.size() == 1);
+	REQUIRE(map.find("a") == map.end());
+	REQUIRE(map.find("b")->second == 2);
+
+ // many keys (grows the table several times, probe sequences span multiple groups)
+	auto keys = MakeKeys(10000);
+	map.clear();
+	for (int i = 0; i < (int)keys.size(); ++i) {
+		map[keys[i]] = i;
+	}
+	REQUIRE(map.size() == keys.size());
+	REQUIRE(map.size() <= map.capacity() - map.capacity() / 8);
+	bool ok = true;
+	for (int i = 0; i < (int)keys.size(); ++i) {
+		auto it = map.find(keys[i]);
+		ok &= it != map.end() && it->second == i;
+	}
+	REQUIRE(ok);
+
+ // iteration visits each value once
+	sint64 sum = 0;
+	uint count = 0;
+	for (auto& it : map) {
+		sum += it.second;
+		++count;
+	}
+	REQUIRE(count == map.size());
+	REQUIRE(sum == (sint64)keys.size() * ((sint64)keys.size() - 1) / 2);
+
+ // erase via iterator while iterating
+	for (auto it = map.begin(); it != map.end();) {
+		if (it->second & 1) {
+			it = map.erase(it);
+		} else {
+			++it;
+		}
+	}
+	REQUIRE(map.size() == keys.size() / 2);
+	ok = true;
+	for (int i = 0; i < (int)keys.size(); ++i) {
+		ok &= map.contains(keys[i]) == ((i & 1) == 0);
+	}
+	REQUIRE(ok);
+}
+
+TEST_CASE("StringHashMap tombstones", "[StringHashMap]")
+{
+ // repeated insert/erase must not grow the table unboundedly
+	auto keys = MakeKeys(100000);
+	StringHashMap<int> map;
+	for (int i = 0; i < 100; ++i) {
+		map[keys[i]] = i;
+	}
+	uint capacity = map.capacity();
+	for (int i = 100; i < (int)keys.size(); ++i) {
+		map.erase(keys[i - 100]);
+		map[keys[i]] = i;
+	}
+	REQUIRE(map.size() == 100);
+	REQUIRE(map.capacity() <= capacity * 2);
+	bool ok = true;
+	for (int i = (int)keys.size() - 100; i < (int)keys.size(); ++i) {
+		ok &= map[keys[i]] == i;
+	}
+	REQUIRE(ok);
+}
+
+TEST_CASE("StringHashMap non-trivial values", "[StringHashMap]")
+{
+	StringHashMap<eastl::string> map;
+	map.reserve(100);
+	uint capacity = map.capacity();
+	auto keys = MakeKeys(100);
+	for (int i = 0; i < (int)keys.size(); ++i) {
+		map[keys[i]] = eastl::string(64, (char)('a' + i % 26));
+	}
+	REQUIRE(map.capacity() == capacity);
+	map.erase(keys[0]);
+
+	StringHashMap<eastl::string> moved(std::move(map));
+	REQUIRE(map.empty());
+	REQUIRE(moved.size() == 99);
+	REQUIRE(moved[keys[1]] == eastl::string(64, 'b'));
+}
+
+TEST_CASE("StringHashMap vs vector_map", "[.benchmark]")
+{
+	for (int n : { 64, 1024, 65536 }) {
+		auto keys = MakeKeys(n);
+		StringHashMap<int> map;
+		eastl::vector_map<StringHash, int> vmap;
+		for (int i = 0; i < n; ++i) {
+			map[keys[i]] = i;
+			vmap[keys[i]] = i;
+		}
+
+		const int kLookups = 4000000;
+		sint64 sum = 0;
+		Timestamp t = Time::GetTimestamp();
+		for (int i = 0; i < kLookups; ++i) {
+			sum += map.find(keys[i % n])->second;
+		}
+		double msMap = (Time::GetTimestamp() - t).asMilliseconds();
+
+		t = Time::GetTimestamp();
+		for (int i = 0; i < kLookups; ++i) {
+			sum -= vmap.find(keys[i % n])->second;
+		}
+		double msVmap = (Time::GetTimestamp() - t).asMilliseconds();
+
+		REQUIRE(sum == 0);
+		APT_LOG("n = %d: StringHashMap %.2fns/lookup, vector_map %.2fns/lookup", n, msMap * 1e6 / kLookups, msVmap * 1e6 / kLookups);
+	}
+}
@@ -0,0 +1,124 @@
+#include <catch.hpp>
+
+#include <apt/File.h>
+#include <apt/Octree.h>
+#include <apt/Quadtree.h>
+#include <apt/rand.h>
+#include <apt/TreeSnapshot.h>
+
+using namespace apt;
+
+template <typename tTree>
+static void InitTree(tTree& tree_)
+{
+	Rand<> rnd;
+	for (typename tTree::Index i = 0; i < (typename tTree::Index)tree_.getTotalNodeCount(); ++i)
+	{
+		tree_[i] = (typename tTree::Node)rnd.get<int>(0, 255);
+	}
+}
+
+template <typename tTree>
+static bool Equal(const tTree& _tree, TreeSnapshot& _snapshot)
+{
+	for (int i = 0; i < _tree.getLevelCount(); ++i)
+	{
+		const typename tTree::Node* level = _snapshot.getLevel<typename tTree::Node>(i);
+		if (!level || memcmp(level, _tree.getLevel(i), sizeof(typename tTree::Node) * (size_t)tTree::GetNodeCount(i)) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename tTree>
+static void TestSnapshot(const char* _path, int _levelCount, uint64 _compressedLevels)
+{
+	tTree tree(_levelCount);
+	InitTree(tree);
+	REQUIRE(TreeSnapshot::Write(tree, _path, _compressedLevels));
+
+	TreeSnapshot snapshot;
+	for (int mode = 0; mode < TreeSnapshot::Mode_Count; ++mode)
+	{
+		REQUIRE(snapshot.load(_path, (TreeSnapshot::Mode)mode));
+		REQUIRE(snapshot.isType<tTree>());
+		REQUIRE(snapshot.getLevelCount() == _levelCount);
+		for (int i = 0; i < _levelCount; ++i)
+		{
+			REQUIRE(snapshot.isLevelCompressed(i) == ((_compressedLevels >> i) & 1));
+		}
+		REQUIRE(Equal(tree, snapshot));
+
+	 // uncompressed levels are used in place, hence aligned
+		for (int i = 0; i < _levelCount; ++i)
+		{
+			if (!snapshot.isLevelCompressed(i))
+			{
+				REQUIRE((uint64)snapshot.getLevel<typename tTree::Node>(i) % TreeSnapshot::kDataAlignment == 0);
+			}
+		}
+
+		tTree copy(_levelCount);
+		REQUIRE(snapshot.read(copy));
+		REQUIRE(memcmp(copy.getLevel(0), tree.getLevel(0), sizeof(typename tTree::Node) * tree.getTotalNodeCount()) == 0);
+	}
+	snapshot.unload();
+	REQUIRE(!snapshot.isLoaded());
+}
+
+TEST_CASE("TreeSnapshot", "[TreeSnapshot]")
+{
+	const char* kPath = "TreeSnapshot_tests.bin";
+
+	SECTION("Quadtree")
+	{
+		TestSnapshot<Quadtree<uint32, float> >(kPath, 8, 0);
+		TestSnapshot<Quadtree<uint32, float> >(kPath, 8, 0xc0); // compress the 2 finest levels
+	}
+
+	SECTION("Octree")
+	{
+		TestSnapshot<Octree<uint32, uint16> >(kPath, 6, 0);
+		TestSnapshot<Octree<uint32, uint16> >(kPath, 6, 0x15);
+	}
+
+	SECTION("Type")
+	{
+		typedef Quadtree<uint32, float> Tree;
+		Tree tree(4);
+		InitTree(tree);
+		REQUIRE(TreeSnapshot::Write(tree, kPath));
+		TreeSnapshot snapshot;
+		REQUIRE(snapshot.load(kPath));
+		REQUIRE(snapshot.isType<Tree>());
+		REQUIRE((snapshot.isType<Quadtree<uint32, uint32> >())); // node type isn't recorded, only the size
+		REQUIRE_FALSE((snapshot.isType<Quadtree<uint64, float> >()));
+		REQUIRE_FALSE((snapshot.isType<Quadtree<uint32, double> >()));
+		REQUIRE_FALSE((snapshot.isType<Octree<uint32, float> >()));
+
+		Tree wrongLevelCount(5);
+		REQUIRE_FALSE(snapshot.read(wrongLevelCount));
+	}
+
+	SECTION("Invalid")
+	{
+		File f;
+		f.setData(nullptr, 256);
+		REQUIRE(File::Write(f, kPath));
+		TreeSnapshot snapshot;
+		REQUIRE(!snapshot.load(kPath));
+		REQUIRE(!snapshot.isLoaded());
+
+	 // truncated file
+		Quadtree<uint32, float> tree(6);
+		InitTree(tree);
+		REQUIRE(TreeSnapshot::Write(tree, kPath));
+		File truncated;
+		REQUIRE(File::Read(f, kPath));
+		truncated.setData(f.getData(), f.getDataSize() / 2);
+		REQUIRE(File::Write(truncated, kPath));
+		REQUIRE(!snapshot.load(kPath));
+	}
+}
@@ -0,0 +1,287 @@
+#include <catch.hpp>
+
+#include <apt/memory.h>
+#include <apt/Arena.h>
+#include <apt/log.h>
+#include <apt/MemoryInstrumentation.h>
+#include <apt/SlabAllocator.h>
+#include <apt/Time.h>
+
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace apt;
+
+TEST_CASE("Arena alloc/rewind", "[memory]")
+{
+	Arena arena(256);
+
+	void* a = arena.alloc(10, 1);
+	void* b = arena.alloc(16, 64);
+	REQUIRE((uint)b % 64 == 0);
+	REQUIRE((char*)b >= (char*)a + 10);
+
+	Arena::Marker marker = arena.getMarker();
+	uint usedSize = arena.getUsedSize();
+	void* c = arena.alloc(100);
+	void* d = arena.alloc(1024); // larger than the chunk size, gets a dedicated chunk
+	REQUIRE(arena.isFromArena(c));
+	REQUIRE(arena.isFromArena(d));
+	REQUIRE(arena.getUsedSize() > usedSize);
+
+	arena.rewind(marker);
+	REQUIRE(arena.getUsedSize() == usedSize);
+	REQUIRE(arena.alloc(100) == c); // memory is reused after rewind
+
+	uint capacity = arena.getCapacity();
+	arena.reset();
+	REQUIRE(arena.getUsedSize() == 0);
+	REQUIRE(arena.getCapacity() == capacity); // chunks are retained
+
+ // realloc of the most recent allocation is in place
+	char* e = (char*)arena.alloc(8);
+	REQUIRE(arena.realloc(e, 8, 64) == e);
+}
+
+TEST_CASE("ArenaScope redirection", "[memory]")
+{
+	Arena arena;
+	void* heapPtr = APT_MALLOC(32);
+	REQUIRE(!arena.isFromArena(heapPtr));
+
+ // Catch allocates internally, hence results are stored and checked outside of the scope
+	void* p = nullptr;
+	void* q = nullptr;
+	void* r = nullptr;
+	bool  preserved = false;
+	bool  vectorFromArena = false;
+	{	APT_ARENA_SCOPE(&arena);
+
+		p = APT_MALLOC(32);
+		memset(p, 0xab, 32);
+		p = APT_REALLOC(p, 4096);
+		preserved = ((uint8*)p)[31] == 0xab;
+		APT_FREE(p);
+
+		q = APT_MALLOC_ALIGNED(64, 128);
+		APT_FREE_ALIGNED(q);
+
+		eastl::vector<int> v;
+		for (int i = 0; i < 1000; ++i) {
+			v.push_back(i);
+		}
+		vectorFromArena = arena.isFromArena(v.data());
+
+		{	APT_ARENA_SCOPE(nullptr); // suspend redirection
+			r = APT_MALLOC(32);
+		}
+
+		APT_FREE(heapPtr); // allocations made outside the scope are freed normally
+	}
+	REQUIRE(Arena::GetThreadArena() == nullptr);
+	REQUIRE(arena.isFromArena(p));
+	REQUIRE(preserved); // realloc preserved the contents
+	REQUIRE(arena.isFromArena(q));
+	REQUIRE((uint)q % 128 == 0);
+	REQUIRE(vectorFromArena);
+	REQUIRE(!arena.isFromArena(r));
+	APT_FREE(r);
+}
+
+#if APT_ENABLE_MEMORY_INSTRUMENTATION
+TEST_CASE("MemoryInstrumentation tags", "[memory]")
+{
+	int tag = MemoryInstrumentation::FindOrAddTag("memory_tests");
+	REQUIRE(MemoryInstrumentation::FindOrAddTag("memory_tests") == tag);
+
+	MemoryInstrumentation::Stats before;
+	MemoryInstrumentation::GetStats(tag, before);
+
+	void* p;
+	void* q;
+	{	APT_MEMORY_TAG("memory_tests");
+		p = APT_MALLOC(100);
+		q = APT_MALLOC_ALIGNED(3000, 64);
+	}
+	REQUIRE((uint)q % 64 == 0);
+
+	MemoryInstrumentation::Stats after;
+	MemoryInstrumentation::GetStats(tag, after);
+	REQUIRE(after.m_liveBytes  == before.m_liveBytes + 3100);
+	REQUIRE(after.m_liveCount  == before.m_liveCount + 2);
+	REQUIRE(after.m_allocCount == before.m_allocCount + 2);
+	REQUIRE(after.m_peakBytes  >= after.m_liveBytes);
+	REQUIRE(after.m_histogram[6]  == before.m_histogram[6] + 1);  // 100 bytes
+	REQUIRE(after.m_histogram[11] == before.m_histogram[11] + 1); // 3000 bytes
+
+ // realloc/free outside the scope are attributed to the original tag
+	p = APT_REALLOC(p, 200);
+	MemoryInstrumentation::GetStats(tag, after);
+	REQUIRE(after.m_liveBytes == before.m_liveBytes + 3200);
+	APT_FREE(p);
+	APT_FREE_ALIGNED(q);
+	MemoryInstrumentation::GetStats(tag, after);
+	REQUIRE(after.m_liveBytes == before.m_liveBytes);
+	REQUIRE(after.m_liveCount == before.m_liveCount);
+}
+#endif
+
+TEST_CASE("EASTL aligned allocations", "[memory]")
+{
+ // the default EASTL allocator releases aligned allocations via delete[]
+	eastl::allocator allocator;
+	for (size_t align = 1; align <= EASTL_SYSTEM_ALLOCATOR_MIN_ALIGNMENT; align *= 2) {
+		void* p = allocator.allocate(100, align, 0);
+		REQUIRE(p);
+		REQUIRE((size_t)p % align == 0);
+		memset(p, 0xff, 100);
+		allocator.deallocate(p, 100);
+	}
+}
+
+TEST_CASE("Large allocations", "[memory]")
+{
+	const size_t kSize = APT_LARGE_ALLOC_THRESHOLD + 1000;
+
+ // above the threshold, allocations are aligned to the large page size
+	char* p = (char*)APT_MALLOC_LARGE(kSize);
+	REQUIRE(p);
+	REQUIRE((uint)p % kLargePageSize == 0);
+	p[0] = 1;
+	p[kSize - 1] = 2;
+	REQUIRE(p[0] + p[kSize - 1] == 3);
+	APT_FREE_LARGE(p);
+
+ // below the threshold, allocations are forwarded to APT_MALLOC
+	p = (char*)APT_MALLOC_LARGE(64);
+	REQUIRE(p);
+	APT_FREE_LARGE(p);
+
+	{	LargeAllocScope scope(LargeAlloc_Always, true);
+		p = (char*)APT_MALLOC_LARGE(64);
+		REQUIRE((uint)p % kLargePageSize == 0);
+		APT_FREE_LARGE(p);
+
+		{	LargeAllocScope nested(LargeAlloc_Never);
+			REQUIRE(LargeAllocScope::GetPolicy() == LargeAlloc_Never);
+			p = (char*)APT_MALLOC_LARGE(kSize);
+			REQUIRE(p);
+			APT_FREE_LARGE(p);
+		}
+		REQUIRE(LargeAllocScope::GetPolicy() == LargeAlloc_Always);
+		REQUIRE(LargeAllocScope::GetPrefault());
+	}
+	REQUIRE(LargeAllocScope::GetPolicy() == LargeAlloc_Auto);
+
+	APT_FREE_LARGE(nullptr);
+}
+
+TEST_CASE("SlabAllocator", "[memory]")
+{
+	REQUIRE(SlabAllocator::GetSizeClassSize(1)    == 16);
+	REQUIRE(SlabAllocator::GetSizeClassSize(16)   == 16);
+	REQUIRE(SlabAllocator::GetSizeClassSize(17)   == 32);
+	REQUIRE(SlabAllocator::GetSizeClassSize(129)  == 160);
+	REQUIRE(SlabAllocator::GetSizeClassSize(257)  == 320);
+	REQUIRE(SlabAllocator::GetSizeClassSize(1024) == 1024);
+
+	void* heapPtr = malloc(16);
+	REQUIRE(!SlabAllocator::IsFromSlab(heapPtr));
+	free(heapPtr);
+
+	eastl::vector<uint8*> ptrs;
+	for (uint size = 1; size <= SlabAllocator::kMaxSize; size += 7) {
+		uint8* p = (uint8*)SlabAllocator::Alloc(size);
+		REQUIRE(p != nullptr);
+		REQUIRE((uint)p % 16 == 0);
+		REQUIRE(SlabAllocator::IsFromSlab(p));
+		REQUIRE(SlabAllocator::GetBlockSize(p) >= size);
+		memset(p, (int)(size & 0xff), size);
+		ptrs.push_back(p);
+	}
+	bool valid = true;
+	for (uint i = 0, size = 1; i < ptrs.size(); ++i, size += 7) {
+		for (uint j = 0; j < size; ++j) {
+			valid &= ptrs[i][j] == (uint8)(size & 0xff);
+		}
+		SlabAllocator::Free(ptrs[i]);
+	}
+	REQUIRE(valid); // blocks don't overlap
+
+ // freed blocks are reused
+	void* a = SlabAllocator::Alloc(40);
+	SlabAllocator::Free(a);
+	REQUIRE(SlabAllocator::Alloc(40) == a);
+	SlabAllocator::Free(a);
+	SlabAllocator::FlushThreadCache();
+}
+
+TEST_CASE("SlabAllocator cross-thread", "[memory]")
+{
+	const int kThreadCount = 4;
+	const int kCount = 10000;
+
+ // each thread allocates a set of blocks and frees those allocated by the previous thread
+	std::vector<void*> blocks[kThreadCount];
+	std::atomic<int> ready(0);
+	std::atomic<int> errors(0);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < kThreadCount; ++i) {
+		threads.push_back(std::thread([&, i]() {
+			std::vector<void*>& mine = blocks[i];
+			mine.reserve(kCount);
+			for (int j = 0; j < kCount; ++j) {
+				uint size = (uint)(j % SlabAllocator::kMaxSize) + 1;
+				void* p = SlabAllocator::Alloc(size);
+				if (!p) {
+					++errors;
+					continue;
+				}
+				memset(p, i, size);
+				mine.push_back(p);
+			}
+			++ready;
+			while (ready.load() < kThreadCount) {
+				std::this_thread::yield();
+			}
+			for (void* p : blocks[(i + 1) % kThreadCount]) {
+				if (*(uint8*)p != (uint8)((i + 1) % kThreadCount)) {
+					++errors;
+				}
+				SlabAllocator::Free(p);
+			}
+		}));
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	REQUIRE(errors.load() == 0);
+}
+
+TEST_CASE("SlabAllocator throughput", "[.benchmark]")
+{
+	const int kCount = 1000000;
+	const int kLive  = 1024;
+	void* live[kLive] = {};
+
+	auto run = [&](const char* _name, void* (*_alloc)(uint), void (*_free)(void*)) {
+		uint32 rng = 1;
+		Timestamp t = Time::GetTimestamp();
+		for (int i = 0; i < kCount; ++i) {
+			rng = rng * 1664525u + 1013904223u;
+			int j = (rng >> 8) % kLive;
+			_free(live[j]);
+			live[j] = _alloc((rng >> 20) % 256 + 1); // mostly small node/string sizes
+		}
+		for (int i = 0; i < kLive; ++i) {
+			_free(live[i]);
+			live[i] = nullptr;
+		}
+		APT_LOG("%-16s %.2fms", _name, (Time::GetTimestamp() - t).asMilliseconds());
+	};
+	run("malloc",        [](uint _size) { return malloc(_size); },              [](void* _ptr) { free(_ptr); });
+	run("SlabAllocator", [](uint _size) { return SlabAllocator::Alloc(_size); }, [](void* _ptr) { SlabAllocator::Free(_ptr); });
+}